@@ -0,0 +1,397 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Arbiter.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "arbiter.h"
+#include "engine.h"
+
+/// Slot number meaning no slot.
+#define NO_SLOT UINT8_MAX
+
+/// Longest slot name kept for log messages (including the terminator).
+#define MAX_NAME_BYTES 32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A slot.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char name[MAX_NAME_BYTES];              ///< Name.
+    int32_t priority;                       ///< Priority (higher wins).
+    uint64_t activation;                    ///< When it was activated (higher = more recently).
+    const pattern_Pattern_t *patternPtr;    ///< Pattern (if active).
+    uint8_t heapIndex;                      ///< Position in Heap (NO_SLOT if not active).
+    arbiter_FinishedFunc_t finishedFunc;    ///< Function to call when its pattern finishes.
+    void *contextPtr;                       ///< Context to pass to finishedFunc.
+}
+Slot_t;
+
+/// The slots.
+static Slot_t Slots[ENGINE_MAX_SLOTS];
+static uint8_t NumSlots = 0;
+
+/// Max-heap of the active slots, ordered by Wins().  Heap[0] is the slot that should be played.
+static uint8_t Heap[ENGINE_MAX_SLOTS];
+static uint8_t HeapSize = 0;
+
+/// Counter used to order activations.
+static uint64_t ActivationCount = 0;
+
+/// The slot the engine was last told to play (NO_SLOT if it was told to stop).
+static uint8_t PlayingSlot = NO_SLOT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether one slot should be played rather than another.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Wins
+(
+    uint8_t slot,
+    uint8_t otherSlot
+)
+{
+    const Slot_t *slotPtr = &Slots[slot];
+    const Slot_t *otherPtr = &Slots[otherSlot];
+
+    if (slotPtr->priority != otherPtr->priority)
+    {
+        return (slotPtr->priority > otherPtr->priority);
+    }
+
+    return (slotPtr->activation > otherPtr->activation);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Puts a slot at a position in the heap.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void Place
+(
+    uint8_t index,
+    uint8_t slot
+)
+{
+    Heap[index] = slot;
+    Slots[slot].heapIndex = index;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restores the heap order around an entry whose slot may have changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Sift
+(
+    uint8_t index
+)
+{
+    uint8_t slot = Heap[index];
+
+    // Up, while it wins against its parent.
+    while ((index > 0) && Wins(slot, Heap[(index - 1) / 2]))
+    {
+        uint8_t parent = (index - 1) / 2;
+        Place(index, Heap[parent]);
+        index = parent;
+    }
+
+    // Down, while one of its children wins against it.
+    for (;;)
+    {
+        uint8_t child = (2 * index) + 1;
+        if (child >= HeapSize)
+        {
+            break;
+        }
+        if (((child + 1) < HeapSize) && Wins(Heap[child + 1], Heap[child]))
+        {
+            child++;
+        }
+        if (!Wins(Heap[child], slot))
+        {
+            break;
+        }
+        Place(index, Heap[child]);
+        index = child;
+    }
+
+    Place(index, slot);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a slot to the heap, if it isn't already there.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Activate
+(
+    uint8_t slot
+)
+{
+    if (Slots[slot].heapIndex != NO_SLOT)
+    {
+        return;
+    }
+
+    Slots[slot].activation = ++ActivationCount;
+    Place(HeapSize, slot);
+    HeapSize++;
+    Sift(HeapSize - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Removes a slot from the heap, if it is there.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Deactivate
+(
+    uint8_t slot
+)
+{
+    uint8_t index = Slots[slot].heapIndex;
+    if (index == NO_SLOT)
+    {
+        return;
+    }
+
+    Slots[slot].heapIndex = NO_SLOT;
+    HeapSize--;
+    if (index < HeapSize)
+    {
+        Place(index, Heap[HeapSize]);
+        Sift(index);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tells the engine to play the slot that has come out on top, if it has changed (or if the slot
+ * that has changed is the one on top).
+ */
+//--------------------------------------------------------------------------------------------------
+static void Arbitrate
+(
+    uint8_t changedSlot     ///< Slot whose pattern has changed (NO_SLOT if none has).
+)
+{
+    uint8_t topSlot = (HeapSize > 0) ? Heap[0] : NO_SLOT;
+
+    if (topSlot == NO_SLOT)
+    {
+        if (PlayingSlot != NO_SLOT)
+        {
+            engine_Stop();
+        }
+    }
+    else if ((topSlot != PlayingSlot) || (topSlot == changedSlot))
+    {
+        if (topSlot != PlayingSlot)
+        {
+            LE_DEBUG("Playing '%s'", Slots[topSlot].name);
+        }
+        engine_Update(topSlot, Slots[topSlot].patternPtr);
+    }
+
+    PlayingSlot = topSlot;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a slot.  Slots are numbered in the order they are added, from 0.
+ *
+ * @return The slot number.
+ *
+ * @note Exits the process if there are too many slots.
+ */
+//--------------------------------------------------------------------------------------------------
+uint8_t arbiter_AddSlot
+(
+    const char *namePtr,                    ///< Name (used in log messages).
+    int32_t priority,                       ///< Priority (higher wins).
+    arbiter_FinishedFunc_t finishedFunc,    ///< Function to call when its pattern finishes (or
+                                            ///  NULL).
+    void *contextPtr                        ///< Context to pass to finishedFunc.
+)
+{
+    if (NumSlots >= ENGINE_MAX_SLOTS)
+    {
+        LE_FATAL("Too many slots (at most %d)", ENGINE_MAX_SLOTS);
+    }
+
+    Slot_t *slotPtr = &Slots[NumSlots];
+    le_utf8_Copy(slotPtr->name, namePtr, sizeof(slotPtr->name), NULL);
+    slotPtr->priority = priority;
+    slotPtr->patternPtr = NULL;
+    slotPtr->heapIndex = NO_SLOT;
+    slotPtr->finishedFunc = finishedFunc;
+    slotPtr->contextPtr = contextPtr;
+
+    return NumSlots++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the name of a slot.
+ */
+//--------------------------------------------------------------------------------------------------
+const char *arbiter_GetName
+(
+    uint8_t slot                            ///< Slot.
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    return Slots[slot].name;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activates a slot, or restarts it if it is active, playing its pattern from the beginning.  The
+ * pattern must stay valid until the slot's pattern is changed or the slot is released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Play
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    Slots[slot].patternPtr = patternPtr;
+    engine_Forget(slot);
+    Activate(slot);
+    Arbitrate(slot);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activates a slot, playing its pattern from a position saved by the engine's checkpoint
+ * function.  The pattern must stay valid until the slot's pattern is changed or the slot is
+ * released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Resume
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    Slots[slot].patternPtr = patternPtr;
+    engine_Forget(slot);
+    Activate(slot);
+
+    if (Heap[0] == slot)
+    {
+        engine_Resume(slot, patternPtr, positionPtr);
+        PlayingSlot = slot;
+    }
+    else
+    {
+        Arbitrate(NO_SLOT);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Changes the pattern of an active slot to one with the same shape, which carries on from the
+ * same position (see engine_Update()).  If the slot isn't active, it is activated instead.  The
+ * pattern must stay valid until the slot's pattern is changed or the slot is released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Update
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    Slots[slot].patternPtr = patternPtr;
+    if (Slots[slot].heapIndex == NO_SLOT)
+    {
+        engine_Forget(slot);
+        Activate(slot);
+    }
+    Arbitrate(slot);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deactivates a slot.  The next time it is activated, it starts from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Release
+(
+    uint8_t slot                            ///< Slot.
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    Deactivate(slot);
+    Slots[slot].patternPtr = NULL;
+    engine_Forget(slot);
+    Arbitrate(NO_SLOT);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Changes the priority of a slot.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_SetPriority
+(
+    uint8_t slot,                           ///< Slot.
+    int32_t priority                        ///< Priority (higher wins).
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    Slots[slot].priority = priority;
+    if (Slots[slot].heapIndex != NO_SLOT)
+    {
+        Sift(Slots[slot].heapIndex);
+        Arbitrate(NO_SLOT);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Releases a slot whose pattern has finished, and tells its requester (matches
+ * engine_FinishedFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_HandleFinished
+(
+    uint8_t slot                            ///< Slot.
+)
+{
+    LE_ASSERT(slot < NumSlots);
+
+    if (Slots[slot].heapIndex == NO_SLOT)
+    {
+        // Already released.
+        return;
+    }
+
+    LE_DEBUG("'%s' has finished", Slots[slot].name);
+    arbiter_Release(slot);
+
+    if (Slots[slot].finishedFunc != NULL)
+    {
+        Slots[slot].finishedFunc(Slots[slot].contextPtr);
+    }
+}
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file arbiter.h
+ *
+ * Arbiter.  Several requesters (e.g., a fault monitor and a user interaction app) can each ask
+ * for a pattern to be played, each in a slot of its own with a priority.  The arbiter always has
+ * the edge engine play the highest priority active slot.  If two slots have the same priority,
+ * the one that became active most recently wins.  A slot that is preempted carries on from where
+ * it was when it gets the output back (see engine.h).  A slot whose pattern comes to its end is
+ * released, as if its requester had withdrawn it, and the requester is told.
+ *
+ * The active slots are kept in a binary heap, so each change costs O(log n), and the engine only
+ * hears about changes that affect what it should be playing.  Nothing is done per edge.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ARBITER_H_INCLUDE_GUARD
+#define ARBITER_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pattern.h"
+#include "sequencer.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called when a slot's pattern has finished.  By then, the slot has been released.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*arbiter_FinishedFunc_t)
+(
+    void *contextPtr                        ///< Context given to arbiter_AddSlot().
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a slot.  Slots are numbered in the order they are added, from 0.
+ *
+ * @return The slot number.
+ *
+ * @note Exits the process if there are too many slots.
+ */
+//--------------------------------------------------------------------------------------------------
+uint8_t arbiter_AddSlot
+(
+    const char *namePtr,                    ///< Name (used in log messages).
+    int32_t priority,                       ///< Priority (higher wins).
+    arbiter_FinishedFunc_t finishedFunc,    ///< Function to call when its pattern finishes (or
+                                            ///  NULL).
+    void *contextPtr                        ///< Context to pass to finishedFunc.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the name of a slot.
+ */
+//--------------------------------------------------------------------------------------------------
+const char *arbiter_GetName
+(
+    uint8_t slot                            ///< Slot.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activates a slot, or restarts it if it is active, playing its pattern from the beginning.  The
+ * pattern must stay valid until the slot's pattern is changed or the slot is released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Play
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activates a slot, playing its pattern from a position saved by the engine's checkpoint
+ * function.  The pattern must stay valid until the slot's pattern is changed or the slot is
+ * released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Resume
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Changes the pattern of an active slot to one with the same shape, which carries on from the
+ * same position (see engine_Update()).  If the slot isn't active, it is activated instead.  The
+ * pattern must stay valid until the slot's pattern is changed or the slot is released.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Update
+(
+    uint8_t slot,                           ///< Slot.
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deactivates a slot.  The next time it is activated, it starts from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_Release
+(
+    uint8_t slot                            ///< Slot.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Changes the priority of a slot.
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_SetPriority
+(
+    uint8_t slot,                           ///< Slot.
+    int32_t priority                        ///< Priority (higher wins).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Releases a slot whose pattern has finished, and tells its requester (matches
+ * engine_FinishedFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void arbiter_HandleFinished
+(
+    uint8_t slot                            ///< Slot.
+);
+
+#endif // ARBITER_H_INCLUDE_GUARD
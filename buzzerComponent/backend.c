@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output backend registry and utilities shared by the backends.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+
+/// All the backends, by name.
+static const backend_Ops_t *const Backends[] =
+{
+    &backend_ClkoutSysfs,
+    &backend_ClkoutUring,
+    &backend_ClkoutI2c,
+    &backend_Pwm,
+    &backend_Gpio,
+    &backend_Null,
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds a backend by name.
+ *
+ * @return The backend, or NULL if there is no backend with that name.
+ */
+//--------------------------------------------------------------------------------------------------
+const backend_Ops_t *backend_Find
+(
+    const char *namePtr         ///< Backend name.
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Backends); i++)
+    {
+        if (strcmp(Backends[i]->namePtr, namePtr) == 0)
+        {
+            return Backends[i];
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Utility for backends: writes a string to the start of a sysfs attribute, retrying if
+ * interrupted.
+ *
+ * @return true if the whole string was written.
+ */
+//--------------------------------------------------------------------------------------------------
+bool backend_WriteAttr
+(
+    int fd,                     ///< File descriptor of the attribute.
+    const char *strPtr,         ///< String to write.
+    size_t len                  ///< Length of the string.
+)
+{
+    // sysfs attributes are always written from the start of the file, so use pwrite() to avoid
+    // having to seek back to the start before each write.
+    ssize_t written;
+    do
+    {
+        written = pwrite(fd, strPtr, len, 0);
+    }
+    while ((written == -1) && (errno == EINTR));
+
+    return (written == (ssize_t)len);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the CLOCK_MONOTONIC time.  Every monotonic time reading in the component (deadlines, edge
+ * and write timings, and the null backend's records) comes from here, so they are all on the same
+ * clock.
+ *
+ * @return The time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef BUZZER_VIRTUAL_CLOCK
+uint64_t backend_GetMonotonicNs
+(
+    void
+)
+{
+    struct timespec now;
+    LE_ASSERT(clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+#endif
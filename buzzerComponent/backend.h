@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file backend.h
+ *
+ * Output backends.  A backend is the piece of hardware (and the interface used to reach it) that
+ * actually makes the buzzer sound.  Each backend provides a table of operations, so the rest of
+ * the component doesn't need to know which one it is driving.
+ *
+ * Some backends can output a choice of tone frequencies.  Others can only switch the buzzer on
+ * and off (e.g., a GPIO driving an active buzzer, which makes its own tone), in which case any
+ * non-zero frequency turns the buzzer on.
+ *
+ * Some backends can also be handed a batch of changes to make at given times, which they make by
+ * themselves (e.g., the kernel makes timed writes), so the caller doesn't have to wake up for
+ * each one.
+ *
+ * Backends read their own settings (e.g., device paths) from environment variables when they are
+ * opened.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BACKEND_H_INCLUDE_GUARD
+#define BACKEND_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+/// Frequency returned by a backend's get operation when it can't tell what is being output.
+#define BACKEND_FREQ_UNKNOWN UINT32_MAX
+
+/// Most changes that can be scheduled at a time.
+#define BACKEND_MAX_SCHEDULED 64
+
+// Board identifiers, for comparing with MANGOH_BOARD (set in Component.cdef) in #if.
+#define BOARD_ID_(board) BOARD_ID_##board
+#define BOARD_ID(board) BOARD_ID_(board)
+#define BOARD_ID_YELLOW 1
+
+#if BOARD_ID(MANGOH_BOARD) == BOARD_ID_YELLOW
+
+/// Non-zero frequencies the RTC CLKOUT can produce (the PCF85063's), in ascending order, as
+/// X(hz, cof) for each, where cof is the value of the COF bits in the RTC's Control_2 register.
+/// Apart from 1 Hz, they are all powers of 2.
+#define BACKEND_CLKOUT_FREQS(X) \
+    X(1,     6) \
+    X(1024,  5) \
+    X(2048,  4) \
+    X(4096,  3) \
+    X(8192,  2) \
+    X(16384, 1) \
+    X(32768, 0)
+
+/// Value of the COF bits that disables the RTC CLKOUT (held low).
+#define BACKEND_CLKOUT_OFF_COF 7
+
+#else
+#error "The buzzer is driven by the RTC CLKOUT on the mangOH Yellow only"
+#endif
+
+/// Turns an entry of BACKEND_CLKOUT_FREQS() into an element of an array of frequencies.
+#define BACKEND_CLKOUT_HZ(hz, cof) hz,
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A change to make at a given time.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t timeNs;            ///< CLOCK_MONOTONIC time at which to make the change.
+    uint32_t freqHz;            ///< Frequency to set.
+}
+backend_Edge_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backend capabilities.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const uint32_t *freqsPtr;   ///< Non-zero frequencies that can be output, in ascending order.
+    size_t numFreqs;            ///< Number of entries in freqsPtr (0 = can only switch on/off).
+    uint64_t minToggleNs;       ///< Shortest time between two changes that can be sustained.
+}
+backend_Caps_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backend operations.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *namePtr;        ///< Name used to select the backend.
+
+    /// Opens the backend.  Returns LE_OK, or an error code if the hardware can't be used.
+    le_result_t (*open)(void);
+
+    /// Sets the output frequency (0 = off).  The frequency must be supported.  Exits the process
+    /// if the hardware can't be written, as the buzzer would be stuck in an unknown state.
+    void (*set)(uint32_t freqHz);
+
+    /// Reads the output frequency back from the hardware, or returns BACKEND_FREQ_UNKNOWN.
+    /// NULL if the backend can't be read back.
+    uint32_t (*get)(void);
+
+    /// Makes the hardware repeat an on/off cycle by itself, until the next call to set.  Returns
+    /// LE_OK, or LE_OUT_OF_RANGE if the hardware can't produce that cycle (in which case the output
+    /// is left in an unknown state).  NULL if the backend can't do this.
+    le_result_t (*setCycle)(uint64_t periodNs, uint64_t onNs);
+
+    /// Makes a batch of changes (at most BACKEND_MAX_SCHEDULED, in time order) by itself, each at
+    /// its time, until they are unscheduled.  Only one batch can be scheduled at a time, and
+    /// nothing else may be done until it is unscheduled.  Returns LE_OK, or LE_NOT_IMPLEMENTED if
+    /// the backend can't do this after all (in which case nothing is scheduled).  NULL if the
+    /// backend can't do this.
+    le_result_t (*schedule)(const backend_Edge_t *edgesPtr, size_t numEdges);
+
+    /// Cancels the scheduled changes that haven't been made yet, waiting for any that are being
+    /// made.  Returns the number of changes that were made (always the first ones).  NULL if the
+    /// backend can't schedule changes.
+    size_t (*unschedule)(void);
+
+    /// Closes the backend.  The output is left off.
+    void (*close)(void);
+
+    backend_Caps_t caps;        ///< Capabilities.
+}
+backend_Ops_t;
+
+/// RTC CLKOUT, through the rtc-pcf85063 driver's sysfs interface.
+extern const backend_Ops_t backend_ClkoutSysfs;
+
+/// RTC CLKOUT, through the rtc-pcf85063 driver's sysfs interface, written asynchronously using
+/// io_uring.
+extern const backend_Ops_t backend_ClkoutUring;
+
+/// RTC CLKOUT, written directly through an i2c-dev device (BUZZER_I2C_DEV).
+extern const backend_Ops_t backend_ClkoutI2c;
+
+/// Linux PWM channel, through sysfs (BUZZER_PWM_CHIP, BUZZER_PWM_CHANNEL and BUZZER_PWM_PATH).
+extern const backend_Ops_t backend_Pwm;
+
+/// GPIO line, through the GPIO character device (BUZZER_GPIO_CHIP and BUZZER_GPIO_LINE).
+extern const backend_Ops_t backend_Gpio;
+
+/// No hardware.  Records the most recent changes in memory (see backend_GetNullRecord()), and
+/// makes scheduled changes exactly on time.
+extern const backend_Ops_t backend_Null;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A change recorded by the null backend.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t timeNs;            ///< CLOCK_MONOTONIC time of the change.
+    uint32_t freqHz;            ///< Frequency set.
+}
+backend_Record_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds a backend by name.
+ *
+ * @return The backend, or NULL if there is no backend with that name.
+ */
+//--------------------------------------------------------------------------------------------------
+const backend_Ops_t *backend_Find
+(
+    const char *namePtr         ///< Backend name.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets one of the changes recorded by the null backend.
+ *
+ * @return LE_OK, or LE_NOT_FOUND if the change is too old to still be recorded, or hasn't
+ *         happened yet.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_GetNullRecord
+(
+    uint64_t index,             ///< Index of the change (0 = the first change since opening).
+    backend_Record_t *recordPtr ///< [OUT] The change.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the total number of changes recorded by the null backend since it was opened.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t backend_GetNullRecordCount
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Utility for backends: writes a string to the start of a sysfs attribute, retrying if
+ * interrupted.
+ *
+ * @return true if the whole string was written.
+ */
+//--------------------------------------------------------------------------------------------------
+bool backend_WriteAttr
+(
+    int fd,                     ///< File descriptor of the attribute.
+    const char *strPtr,         ///< String to write.
+    size_t len                  ///< Length of the string.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the CLOCK_MONOTONIC time.  Every monotonic time reading in the component (deadlines, edge
+ * and write timings, and the null backend's records) comes from here, so they are all on the same
+ * clock.
+ *
+ * If the component is built with BUZZER_VIRTUAL_CLOCK defined, this isn't defined here, and must
+ * be supplied by whatever the component is linked with instead (e.g., a simulated clock, see
+ * test/sim.h).
+ *
+ * @return The time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t backend_GetMonotonicNs
+(
+    void
+);
+
+#endif // BACKEND_H_INCLUDE_GUARD
@@ -0,0 +1,711 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output backends for the RTC chip's CLKOUT signal, which drives the mangOH Yellow's buzzer.
+ *
+ * The sysfs backend sets the CLKOUT frequency through the rtc-pcf85063 driver's sysfs interface.
+ *
+ * The I2C backend writes the PCF85063's CLKOUT control bits directly through an i2c-dev device,
+ * bypassing the sysfs and RTC driver layers.  That is much quicker, but the RTC driver doesn't
+ * know about it, so the driver's view of the CLKOUT frequency becomes stale.
+ *
+ * The io_uring backend writes through sysfs like the sysfs backend, but hands each write to the
+ * kernel without waiting for it (see uring.h), so the caller isn't held up by the RTC driver's
+ * I2C transfer.  Writes are checked when the next one is made (or the output is read back or
+ * closed).  Only one is in flight at a time, so they can't overtake each other.  Handing a write
+ * over costs a few microseconds, so this only pays off if the write itself is slower than that
+ * (as it is through the RTC driver).  If io_uring isn't available, the backend can't be opened
+ * (and the sysfs backend is used instead).
+ *
+ * If the kernel can time writes, the io_uring backend can also be handed a batch of changes,
+ * which the kernel makes at their times as a chain of timed writes, while the caller sleeps.
+ *
+ * The sysfs file can be replaced by setting BUZZER_CLKOUT_PATH (e.g., to a file on a tmpfs, to
+ * compare the cost of the sysfs and io_uring backends without the hardware).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+#include "uring.h"
+
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// Turn a numeric macro into a string literal at compile time.
+#define STRINGIZE_(x) #x
+#define STRINGIZE(x) STRINGIZE_(x)
+
+// The frequencies are selected by board in backend.h, which stops the build on other boards.
+#if BOARD_ID(MANGOH_BOARD) == BOARD_ID_YELLOW
+
+/// Path to the RTC CLKOUT control file in sysfs, used if BUZZER_CLKOUT_PATH isn't set.
+#define DEFAULT_FREQ_PATH "/sys/bus/i2c/drivers/rtc-pcf85063/8-0051/clkout_freq"
+
+/// i2c-dev device used if BUZZER_I2C_DEV isn't set.  This is the bus that DEFAULT_FREQ_PATH is on.
+#define DEFAULT_I2C_DEV "/dev/i2c-8"
+
+/// I2C address of the RTC (the same device as in DEFAULT_FREQ_PATH).
+#define PCF85063_I2C_ADDR 0x51
+
+#endif
+
+/// Address of the PCF85063's Control_2 register, which contains the CLKOUT frequency bits (COF).
+#define PCF85063_REG_CONTROL_2 0x01
+
+/// Mask of the COF bits in Control_2.
+#define PCF85063_COF_MASK 0x07
+
+/// Number of entries in the io_uring: enough for a batch of scheduled changes (a wait and a write
+/// each).  The kernel takes the entries as soon as they are submitted, so the ring is empty again
+/// by the time anything else is queued.
+#define URING_ENTRIES (2 * BACKEND_MAX_SCHEDULED)
+
+/// Tag of immediate io_uring writes.  Scheduled changes are tagged with twice their index (see
+/// uring_QueueTimedWrite()).
+#define TAG_WRITE (URING_CANCEL_TAG - 1)
+
+/// Mask of the flag bits (AF and TF) in Control_2.  Writing 0 clears a flag, and writing 1 leaves
+/// it alone, so these bits are always written as 1 to avoid losing an alarm or timer event.
+#define PCF85063_FLAGS_MASK 0x48
+
+/// Entry in the table of frequencies that the RTC CLKOUT can produce.
+/// The contents to write to the CLKOUT control file are pre-rendered, so that no formatting is
+/// done when toggling the buzzer.
+typedef struct
+{
+    uint32_t freqHz;        ///< Frequency.
+    const char *strPtr;     ///< Frequency rendered as a string.
+    size_t len;             ///< Length of the string.
+    uint8_t cof;            ///< Value of the COF bits in the Control_2 register.
+}
+Freq_t;
+
+#define FREQ(hz, cof) { hz, STRINGIZE(hz), sizeof(STRINGIZE(hz)) - 1, cof },
+
+/// Frequencies supported by the CLKOUT (see BACKEND_CLKOUT_FREQS()), starting with 0 (disabled).
+/// Apart from 0 and 1 Hz, they are all powers of 2, so the entry for a frequency can be found
+/// without searching (see FindFreq()).
+static const Freq_t Freqs[] =
+{
+    FREQ(0, BACKEND_CLKOUT_OFF_COF)
+    BACKEND_CLKOUT_FREQS(FREQ)
+};
+
+/// Non-zero frequencies supported by the CLKOUT, for the backend capabilities.
+static const uint32_t CapsFreqs[] = { BACKEND_CLKOUT_FREQS(BACKEND_CLKOUT_HZ) };
+
+/// File descriptor of the RTC CLKOUT control file (-1 if not open).
+static int FreqFd = -1;
+
+/// Path of the RTC CLKOUT control file.
+static const char *FreqPath = DEFAULT_FREQ_PATH;
+
+/// Length of the immediate io_uring write in flight (0 if none).
+static size_t UringPendingLen = 0;
+
+/// Changes scheduled through io_uring, and how many of them have been made.
+static const Freq_t *Scheduled[BACKEND_MAX_SCHEDULED];
+static size_t ScheduledCount = 0;
+static size_t MadeCount;
+
+/// Which of the scheduled changes' requests (a wait and a write each) are done, and how many.
+static bool RequestDone[2 * BACKEND_MAX_SCHEDULED];
+static size_t DoneCount;
+
+/// File descriptor of the i2c-dev device (-1 if not open).
+static int I2cFd = -1;
+
+/// Path of the i2c-dev device.
+static const char *I2cDevPathPtr = DEFAULT_I2C_DEV;
+
+/// Last value read from the Control_2 register, with the flags set and the COF bits cleared.
+static uint8_t Control2 = PCF85063_FLAGS_MASK;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Looks up a frequency in the table of supported frequencies.  The index is worked out from the
+ * frequency's power of 2 (2^10 Hz is entry 2, up to 2^15 Hz at entry 7).
+ *
+ * @return A pointer to the table entry.
+ */
+//--------------------------------------------------------------------------------------------------
+static const Freq_t *FindFreq
+(
+    uint32_t freqHz
+)
+{
+    size_t index = (freqHz <= 1) ? freqHz : ((size_t)__builtin_ctz(freqHz) - 8);
+
+    if ((index >= NUM_ARRAY_MEMBERS(Freqs)) || (Freqs[index].freqHz != freqHz))
+    {
+        LE_FATAL("Unsupported CLKOUT frequency (%" PRIu32 " Hz)", freqHz);
+    }
+
+    return &Freqs[index];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the sysfs backend.
+ *
+ * @return LE_OK or LE_NOT_FOUND.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SysfsOpen
+(
+    void
+)
+{
+    const char *pathPtr = getenv("BUZZER_CLKOUT_PATH");
+    if ((pathPtr != NULL) && (pathPtr[0] != '\0'))
+    {
+        FreqPath = pathPtr;
+    }
+
+    FreqFd = open(FreqPath, O_RDWR | O_CLOEXEC);
+    if (FreqFd == -1)
+    {
+        LE_ERROR("Opening file (%s) failed (%m)", FreqPath);
+        return LE_NOT_FOUND;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the CLKOUT frequency through sysfs.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SysfsSet
+(
+    uint32_t freqHz
+)
+{
+    const Freq_t *entryPtr = FindFreq(freqHz);
+
+    if (!backend_WriteAttr(FreqFd, entryPtr->strPtr, entryPtr->len))
+    {
+        LE_FATAL("Write to file (%s) failed (%m)", FreqPath);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the CLKOUT frequency back through sysfs.
+ *
+ * @return The frequency, or BACKEND_FREQ_UNKNOWN.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t SysfsGet
+(
+    void
+)
+{
+    char buff[16];
+    ssize_t len;
+
+    do
+    {
+        len = pread(FreqFd, buff, sizeof(buff) - 1, 0);
+    }
+    while ((len == -1) && (errno == EINTR));
+
+    if (len <= 0)
+    {
+        LE_WARN("Read from file (%s) failed (%m)", FreqPath);
+        return BACKEND_FREQ_UNKNOWN;
+    }
+    buff[len] = '\0';
+
+    char *endPtr;
+    errno = 0;
+    unsigned long freqHz = strtoul(buff, &endPtr, 10);
+    if ((endPtr == buff) || (errno != 0) || (freqHz >= BACKEND_FREQ_UNKNOWN))
+    {
+        LE_WARN("Unexpected contents in file (%s)", FreqPath);
+        return BACKEND_FREQ_UNKNOWN;
+    }
+
+    return (uint32_t)freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the sysfs backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SysfsClose
+(
+    void
+)
+{
+    SysfsSet(0);
+    close(FreqFd);
+    FreqFd = -1;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the io_uring backend.
+ *
+ * @return LE_OK, or an error code if the file can't be opened or io_uring isn't available.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t UringOpen
+(
+    void
+)
+{
+    le_result_t result = SysfsOpen();
+    if (result != LE_OK)
+    {
+        return result;
+    }
+
+    result = uring_Open(URING_ENTRIES);
+    if (result != LE_OK)
+    {
+        close(FreqFd);
+        FreqFd = -1;
+        return result;
+    }
+
+    UringPendingLen = 0;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks the result of an io_uring request.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UringHandleCompletion
+(
+    uint64_t tag,
+    int32_t result
+)
+{
+    if (tag == URING_CANCEL_TAG)
+    {
+        // Whether or not it found anything to cancel, the request it was for completes anyway.
+        return;
+    }
+
+    size_t len;
+    if (tag == TAG_WRITE)
+    {
+        len = UringPendingLen;
+        UringPendingLen = 0;
+    }
+    else
+    {
+        LE_ASSERT(tag < (2 * ScheduledCount));
+        RequestDone[tag] = true;
+        DoneCount++;
+
+        // Waits are expected to time out, and both waits and writes are cancelled when the rest
+        // of the batch is.
+        if ((result == -ECANCELED) || (((tag & 1) == 0) && (result == -ETIME)))
+        {
+            return;
+        }
+        if ((tag & 1) == 0)
+        {
+            LE_FATAL("Waiting to write to file (%s) failed (%s)", FreqPath, strerror(-result));
+        }
+        len = Scheduled[tag / 2]->len;
+        MadeCount++;
+    }
+
+    if (result != (int32_t)len)
+    {
+        LE_FATAL("Write to file (%s) failed (%s)",
+                 FreqPath, (result < 0) ? strerror(-result) : "short write");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks the results of the io_uring requests that are done, and optionally waits for the
+ * immediate write in flight to be done.
+ *
+ * @return true if no immediate write is in flight any more.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool UringReap
+(
+    bool wait
+)
+{
+    for (;;)
+    {
+        uint64_t tag;
+        int32_t result;
+
+        while (uring_GetCompletion(&tag, &result))
+        {
+            UringHandleCompletion(tag, result);
+        }
+
+        if (UringPendingLen == 0)
+        {
+            return true;
+        }
+        if (!wait)
+        {
+            return false;
+        }
+        if (uring_Submit(1) != LE_OK)
+        {
+            LE_FATAL("Waiting for write to file (%s) failed", FreqPath);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the CLKOUT frequency through sysfs, without waiting for the write to be done.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UringSet
+(
+    uint32_t freqHz
+)
+{
+    const Freq_t *entryPtr = FindFreq(freqHz);
+
+    // Normally the previous write is long done.  If the hardware can't keep up, this waits for
+    // it, just as a plain write would.
+    if (!UringReap(false))
+    {
+        LE_DEBUG("Waiting for previous write to file (%s)", FreqPath);
+        UringReap(true);
+    }
+
+    // The strings are constant, so they outlive the write.
+    if ((uring_QueueWrite(FreqFd, entryPtr->strPtr, entryPtr->len, TAG_WRITE) != LE_OK) ||
+        (uring_Submit(0) != LE_OK))
+    {
+        LE_FATAL("Write to file (%s) failed", FreqPath);
+    }
+    UringPendingLen = entryPtr->len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedules a batch of changes to the CLKOUT frequency, as a chain of timed io_uring writes.
+ *
+ * @return LE_OK, or LE_NOT_IMPLEMENTED if the kernel can't time writes.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t UringSchedule
+(
+    const backend_Edge_t *edgesPtr,
+    size_t numEdges
+)
+{
+    LE_ASSERT((ScheduledCount == 0) && (numEdges <= BACKEND_MAX_SCHEDULED));
+
+    // The immediate write must be made first, or the first change could overtake it.
+    UringReap(true);
+
+    for (size_t i = 0; i < numEdges; i++)
+    {
+        const Freq_t *entryPtr = FindFreq(edgesPtr[i].freqHz);
+
+        // The ring has room for a whole batch, and whether the kernel can time writes doesn't
+        // change, so only the first one can fail.
+        le_result_t result = uring_QueueTimedWrite(FreqFd, entryPtr->strPtr, entryPtr->len,
+                                                   edgesPtr[i].timeNs, 2 * i);
+        if (result != LE_OK)
+        {
+            LE_ASSERT(i == 0);
+            return result;
+        }
+
+        Scheduled[i] = entryPtr;
+        RequestDone[2 * i] = false;
+        RequestDone[(2 * i) + 1] = false;
+    }
+
+    ScheduledCount = numEdges;
+    MadeCount = 0;
+    DoneCount = 0;
+
+    if (uring_Submit(0) != LE_OK)
+    {
+        LE_FATAL("Scheduling writes to file (%s) failed", FreqPath);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancels the scheduled changes that haven't been made yet, waiting for any that are being made.
+ *
+ * @return The number of changes that were made.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t UringUnschedule
+(
+    void
+)
+{
+    size_t oldest = 0;
+
+    if (ScheduledCount == 0)
+    {
+        return 0;
+    }
+
+    UringReap(false);
+
+    while (DoneCount < (2 * ScheduledCount))
+    {
+        while (RequestDone[oldest])
+        {
+            oldest++;
+        }
+
+        // Cancelling a wait cancels the rest of the chain after it.  A write can't be cancelled
+        // once it has started, so that is waited for, and then the wait after it is cancelled.
+        if (((oldest & 1) == 0) && (uring_QueueCancel(oldest) != LE_OK))
+        {
+            LE_FATAL("Cancelling writes to file (%s) failed", FreqPath);
+        }
+        if (uring_Submit(1) != LE_OK)
+        {
+            LE_FATAL("Waiting for writes to file (%s) failed", FreqPath);
+        }
+
+        UringReap(false);
+    }
+
+    ScheduledCount = 0;
+
+    return MadeCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the CLKOUT frequency back through sysfs, once the write in flight is done.
+ *
+ * @return The frequency, or BACKEND_FREQ_UNKNOWN.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t UringGet
+(
+    void
+)
+{
+    UringReap(true);
+
+    return SysfsGet();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the io_uring backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UringClose
+(
+    void
+)
+{
+    UringReap(true);
+    uring_Close();
+    SysfsClose();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the PCF85063's Control_2 register through the i2c-dev device, in a single combined
+ * transaction.
+ *
+ * @return LE_OK or LE_IO_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadControl2
+(
+    uint8_t *valuePtr
+)
+{
+    uint8_t reg = PCF85063_REG_CONTROL_2;
+    struct i2c_msg msgs[2] =
+    {
+        { .addr = PCF85063_I2C_ADDR, .flags = 0,        .len = 1, .buf = &reg },
+        { .addr = PCF85063_I2C_ADDR, .flags = I2C_M_RD, .len = 1, .buf = valuePtr },
+    };
+    struct i2c_rdwr_ioctl_data transfer = { .msgs = msgs, .nmsgs = 2 };
+
+    if (ioctl(I2cFd, I2C_RDWR, &transfer) != 2)
+    {
+        LE_WARN("Read from I2C device (%s) failed (%m)", I2cDevPathPtr);
+        return LE_IO_ERROR;
+    }
+
+    // Keep the other bits, so they aren't changed when the COF bits are written.
+    Control2 = (*valuePtr & ~PCF85063_COF_MASK) | PCF85063_FLAGS_MASK;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the I2C backend, and reads the Control_2 register to make sure the RTC is there.
+ *
+ * @return LE_OK, or an error code if the device can't be used.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t I2cOpen
+(
+    void
+)
+{
+    const char *pathPtr = getenv("BUZZER_I2C_DEV");
+    if ((pathPtr != NULL) && (pathPtr[0] != '\0'))
+    {
+        I2cDevPathPtr = pathPtr;
+    }
+
+    I2cFd = open(I2cDevPathPtr, O_RDWR | O_CLOEXEC);
+    if (I2cFd == -1)
+    {
+        LE_ERROR("Opening I2C device (%s) failed (%m)", I2cDevPathPtr);
+        return LE_NOT_FOUND;
+    }
+
+    // The RTC driver has claimed the address, so it has to be forced.
+    uint8_t control2;
+    if ((ioctl(I2cFd, I2C_SLAVE_FORCE, PCF85063_I2C_ADDR) != 0) ||
+        (ReadControl2(&control2) != LE_OK))
+    {
+        LE_ERROR("RTC not accessible on I2C device (%s) (%m)", I2cDevPathPtr);
+        close(I2cFd);
+        I2cFd = -1;
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the CLKOUT frequency by writing the Control_2 register directly.
+ */
+//--------------------------------------------------------------------------------------------------
+static void I2cSet
+(
+    uint32_t freqHz
+)
+{
+    uint8_t buff[2] = { PCF85063_REG_CONTROL_2, Control2 | FindFreq(freqHz)->cof };
+    ssize_t written;
+
+    do
+    {
+        written = write(I2cFd, buff, sizeof(buff));
+    }
+    while ((written == -1) && (errno == EINTR));
+
+    if (written != sizeof(buff))
+    {
+        LE_FATAL("Write to I2C device (%s) failed (%m)", I2cDevPathPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the CLKOUT frequency back from the Control_2 register.
+ *
+ * @return The frequency, or BACKEND_FREQ_UNKNOWN.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t I2cGet
+(
+    void
+)
+{
+    uint8_t control2;
+    if (ReadControl2(&control2) == LE_OK)
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Freqs); i++)
+        {
+            if (Freqs[i].cof == (control2 & PCF85063_COF_MASK))
+            {
+                return Freqs[i].freqHz;
+            }
+        }
+    }
+
+    return BACKEND_FREQ_UNKNOWN;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the I2C backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void I2cClose
+(
+    void
+)
+{
+    I2cSet(0);
+    close(I2cFd);
+    I2cFd = -1;
+}
+
+const backend_Ops_t backend_ClkoutSysfs =
+{
+    .namePtr = "clkout",
+    .open = SysfsOpen,
+    .set = SysfsSet,
+    .get = SysfsGet,
+    .close = SysfsClose,
+    .caps =
+    {
+        .freqsPtr = CapsFreqs,
+        .numFreqs = NUM_ARRAY_MEMBERS(CapsFreqs),
+        .minToggleNs = 2000000,     // sysfs, RTC driver and a 100 kHz I2C transfer.
+    },
+};
+
+const backend_Ops_t backend_ClkoutUring =
+{
+    .namePtr = "clkout-uring",
+    .open = UringOpen,
+    .set = UringSet,
+    .get = UringGet,
+    .close = UringClose,
+    .schedule = UringSchedule,
+    .unschedule = UringUnschedule,
+    .caps =
+    {
+        .freqsPtr = CapsFreqs,
+        .numFreqs = NUM_ARRAY_MEMBERS(CapsFreqs),
+        .minToggleNs = 2000000,     // The hardware is no quicker, even if the caller is.
+    },
+};
+
+const backend_Ops_t backend_ClkoutI2c =
+{
+    .namePtr = "clkout-i2c",
+    .open = I2cOpen,
+    .set = I2cSet,
+    .get = I2cGet,
+    .close = I2cClose,
+    .caps =
+    {
+        .freqsPtr = CapsFreqs,
+        .numFreqs = NUM_ARRAY_MEMBERS(CapsFreqs),
+        .minToggleNs = 1000000,     // A 100 kHz I2C transfer.
+    },
+};
@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output backend for a GPIO line, through the GPIO character device (/dev/gpiochip*).
+ *
+ * The GPIO line is expected to drive an active buzzer (one that makes its own tone), so the
+ * buzzer is turned on by driving the line high and off by driving it low.
+ *
+ * The chip and line are set by the BUZZER_GPIO_CHIP (default /dev/gpiochip0) and
+ * BUZZER_GPIO_LINE (default 0) environment variables.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+/// GPIO chip used if BUZZER_GPIO_CHIP isn't set.
+#define DEFAULT_GPIO_CHIP "/dev/gpiochip0"
+
+/// File descriptor of the line handle (-1 if not open).
+static int LineFd = -1;
+
+/// Path of the GPIO chip.
+static const char *ChipPathPtr = DEFAULT_GPIO_CHIP;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the GPIO backend, requesting the line as an output, initially low.
+ *
+ * @return LE_OK, or an error code if the line can't be used.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GpioOpen
+(
+    void
+)
+{
+    const char *pathPtr = getenv("BUZZER_GPIO_CHIP");
+    if ((pathPtr != NULL) && (pathPtr[0] != '\0'))
+    {
+        ChipPathPtr = pathPtr;
+    }
+
+    const char *lineStr = getenv("BUZZER_GPIO_LINE");
+    uint32_t line = ((lineStr != NULL) && (lineStr[0] != '\0')) ?
+                    (uint32_t)strtoul(lineStr, NULL, 10) : 0;
+
+    int chipFd = open(ChipPathPtr, O_RDWR | O_CLOEXEC);
+    if (chipFd == -1)
+    {
+        LE_ERROR("Opening GPIO chip (%s) failed (%m)", ChipPathPtr);
+        return LE_NOT_FOUND;
+    }
+
+    struct gpiohandle_request request;
+    memset(&request, 0, sizeof(request));
+    request.lineoffsets[0] = line;
+    request.lines = 1;
+    request.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    request.default_values[0] = 0;
+    snprintf(request.consumer_label, sizeof(request.consumer_label), "buzzer");
+
+    int result = ioctl(chipFd, GPIO_GET_LINEHANDLE_IOCTL, &request);
+    close(chipFd);
+
+    if (result != 0)
+    {
+        LE_ERROR("Requesting line %" PRIu32 " of GPIO chip (%s) failed (%m)", line, ChipPathPtr);
+        return LE_NOT_POSSIBLE;
+    }
+
+    LineFd = request.fd;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the buzzer on or off.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GpioSet
+(
+    uint32_t freqHz
+)
+{
+    struct gpiohandle_data data;
+    memset(&data, 0, sizeof(data));
+    data.values[0] = (freqHz != 0);
+
+    if (ioctl(LineFd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) != 0)
+    {
+        LE_FATAL("Setting GPIO line on chip (%s) failed (%m)", ChipPathPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads back whether the buzzer is on.
+ *
+ * @return 1 if it's on, 0 if it's off, or BACKEND_FREQ_UNKNOWN.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GpioGet
+(
+    void
+)
+{
+    struct gpiohandle_data data;
+
+    if (ioctl(LineFd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) != 0)
+    {
+        LE_WARN("Reading GPIO line on chip (%s) failed (%m)", ChipPathPtr);
+        return BACKEND_FREQ_UNKNOWN;
+    }
+
+    return (data.values[0] != 0) ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the GPIO backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GpioClose
+(
+    void
+)
+{
+    GpioSet(0);
+    close(LineFd);
+    LineFd = -1;
+}
+
+const backend_Ops_t backend_Gpio =
+{
+    .namePtr = "gpio",
+    .open = GpioOpen,
+    .set = GpioSet,
+    .get = GpioGet,
+    .close = GpioClose,
+    .caps =
+    {
+        .freqsPtr = NULL,
+        .numFreqs = 0,
+        .minToggleNs = 10000,
+    },
+};
@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Null output backend.  Doesn't drive any hardware, but records the most recent changes in
+ * memory, so the timing of the output can be checked and benchmarked without the hardware
+ * getting in the way.
+ *
+ * Scheduled changes are made exactly on time, as ideal hardware would.  Nothing needs to be done
+ * to make them: a change counts as made (and is recorded, with its time) as soon as the clock has
+ * reached its time, so this works the same on the real and a simulated clock.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+
+/// Number of changes recorded.
+#define NUM_RECORDS 1024
+
+/// Circular buffer of the most recent changes.
+static backend_Record_t Records[NUM_RECORDS];
+
+/// Number of changes since the backend was opened.
+static uint64_t RecordCount = 0;
+
+/// The frequency being "output" (before any scheduled changes).
+static uint32_t FreqHz = 0;
+
+/// The changes scheduled, and how many there are.
+static backend_Edge_t Scheduled[BACKEND_MAX_SCHEDULED];
+static size_t ScheduledCount = 0;
+
+/// Frequencies accepted (the same as the RTC CLKOUT, so patterns behave the same).
+static const uint32_t CapsFreqs[] = { BACKEND_CLKOUT_FREQS(BACKEND_CLKOUT_HZ) };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the null backend.
+ *
+ * @return LE_OK.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t NullOpen
+(
+    void
+)
+{
+    RecordCount = 0;
+    FreqHz = 0;
+    ScheduledCount = 0;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a change of frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Record
+(
+    uint64_t timeNs,
+    uint32_t freqHz
+)
+{
+    backend_Record_t *recordPtr = &Records[RecordCount % NUM_RECORDS];
+
+    recordPtr->timeNs = timeNs;
+    recordPtr->freqHz = freqHz;
+    RecordCount++;
+
+    FreqHz = freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counts the scheduled changes that have been made: those whose time has come.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t CountMade
+(
+    void
+)
+{
+    uint64_t nowNs = backend_GetMonotonicNs();
+    size_t count = 0;
+
+    while ((count < ScheduledCount) && (Scheduled[count].timeNs <= nowNs))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a change of frequency, made now.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NullSet
+(
+    uint32_t freqHz
+)
+{
+    Record(backend_GetMonotonicNs(), freqHz);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the frequency being "output".
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t NullGet
+(
+    void
+)
+{
+    size_t madeCount = CountMade();
+
+    return (madeCount > 0) ? Scheduled[madeCount - 1].freqHz : FreqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedules a batch of changes.
+ *
+ * @return LE_OK.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t NullSchedule
+(
+    const backend_Edge_t *edgesPtr,
+    size_t numEdges
+)
+{
+    LE_ASSERT((ScheduledCount == 0) && (numEdges <= BACKEND_MAX_SCHEDULED));
+
+    memcpy(Scheduled, edgesPtr, numEdges * sizeof(Scheduled[0]));
+    ScheduledCount = numEdges;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancels the scheduled changes whose time hasn't come yet, and records those that have been made.
+ *
+ * @return The number of changes that were made.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t NullUnschedule
+(
+    void
+)
+{
+    size_t madeCount = CountMade();
+
+    for (size_t i = 0; i < madeCount; i++)
+    {
+        Record(Scheduled[i].timeNs, Scheduled[i].freqHz);
+    }
+    ScheduledCount = 0;
+
+    return madeCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the null backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NullClose
+(
+    void
+)
+{
+    NullSet(0);
+}
+
+const backend_Ops_t backend_Null =
+{
+    .namePtr = "null",
+    .open = NullOpen,
+    .set = NullSet,
+    .get = NullGet,
+    .schedule = NullSchedule,
+    .unschedule = NullUnschedule,
+    .close = NullClose,
+    .caps =
+    {
+        .freqsPtr = CapsFreqs,
+        .numFreqs = NUM_ARRAY_MEMBERS(CapsFreqs),
+        .minToggleNs = 1000,
+    },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets one of the changes recorded by the null backend.
+ *
+ * @return LE_OK, or LE_NOT_FOUND if the change is too old to still be recorded, or hasn't
+ *         happened yet.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_GetNullRecord
+(
+    uint64_t index,             ///< Index of the change (0 = the first change since opening).
+    backend_Record_t *recordPtr ///< [OUT] The change.
+)
+{
+    // Scheduled changes that have been made come after the recorded ones, until they are
+    // recorded themselves.
+    if ((index >= RecordCount) && (index < RecordCount + CountMade()))
+    {
+        recordPtr->timeNs = Scheduled[index - RecordCount].timeNs;
+        recordPtr->freqHz = Scheduled[index - RecordCount].freqHz;
+        return LE_OK;
+    }
+
+    if ((index >= RecordCount) || (RecordCount - index > NUM_RECORDS))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    *recordPtr = Records[index % NUM_RECORDS];
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the total number of changes recorded by the null backend since it was opened.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t backend_GetNullRecordCount
+(
+    void
+)
+{
+    return RecordCount + CountMade();
+}
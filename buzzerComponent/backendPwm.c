@@ -0,0 +1,333 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output backend for a Linux PWM channel, through the PWM sysfs interface (/sys/class/pwm).
+ *
+ * The PWM channel is expected to gate an active buzzer (one that makes its own tone), so the
+ * buzzer is turned on by holding the output high (100% duty cycle) and off by disabling the
+ * channel.  Toggling the buzzer is therefore a single write to the "enable" attribute.
+ *
+ * A steady on/off cycle can also be handed over to the PWM hardware itself, by programming the
+ * cycle as the PWM period and duty cycle.  The buzzer then needs no attention at all until the
+ * cycle is changed.  The period is programmed back to the "held on" configuration the next time
+ * the buzzer is turned on.
+ *
+ * The chip and channel are set by the BUZZER_PWM_CHIP (default 0) and BUZZER_PWM_CHANNEL
+ * (default 0) environment variables.  The PWM sysfs directory can be replaced by setting
+ * BUZZER_PWM_PATH (e.g., to a directory of plain files, to run the backend without the hardware).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+
+/// PWM sysfs directory, used if BUZZER_PWM_PATH isn't set.
+#define DEFAULT_PWM_PATH "/sys/class/pwm"
+
+/// Period programmed while the buzzer is held on.  Any period will do, as the duty cycle is 100%.
+#define ON_PERIOD_NS 1000000
+
+/// Period and duty cycle currently programmed (PeriodNs = 0 if unknown).
+static uint64_t PeriodNs;
+static uint64_t DutyCycleNs;
+
+/// File descriptors of the channel's attributes (-1 if not open).
+static int PeriodFd = -1;
+static int DutyCycleFd = -1;
+static int EnableFd = -1;
+
+/// Path of the channel's directory in sysfs.
+static char ChannelPath[PATH_MAX];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens one of the channel's attributes.
+ *
+ * @return The file descriptor, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static int OpenAttr
+(
+    const char *namePtr
+)
+{
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", ChannelPath, namePtr) >= (int)sizeof(path))
+    {
+        LE_ERROR("Path of PWM channel (%s) too long", ChannelPath);
+        return -1;
+    }
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd == -1)
+    {
+        LE_ERROR("Opening file (%s) failed (%m)", path);
+    }
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the channel's attributes.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseAttrs
+(
+    void
+)
+{
+    int *fdPtrs[] = { &PeriodFd, &DutyCycleFd, &EnableFd };
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(fdPtrs); i++)
+    {
+        if (*fdPtrs[i] != -1)
+        {
+            close(*fdPtrs[i]);
+            *fdPtrs[i] = -1;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Writes a number to one of the channel's attributes.
+ *
+ * @return true if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool WriteNumAttr
+(
+    int fd,
+    uint64_t value
+)
+{
+    char str[24];
+    int len = snprintf(str, sizeof(str), "%" PRIu64, value);
+
+    return backend_WriteAttr(fd, str, (size_t)len);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Programs the period and duty cycle.  The duty cycle can never be longer than the period, so the
+ * two are written in whichever order keeps that true at every step.  This way the channel doesn't
+ * have to be disabled (and the output doesn't glitch) while it is reconfigured.  If the current
+ * period is unknown, the duty cycle is cleared first.
+ *
+ * @return true if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Program
+(
+    uint64_t periodNs,
+    uint64_t dutyCycleNs
+)
+{
+    bool ok;
+
+    if (PeriodNs == 0)
+    {
+        ok = WriteNumAttr(DutyCycleFd, 0) &&
+             WriteNumAttr(PeriodFd, periodNs) && WriteNumAttr(DutyCycleFd, dutyCycleNs);
+    }
+    else if (dutyCycleNs <= PeriodNs)
+    {
+        ok = WriteNumAttr(DutyCycleFd, dutyCycleNs) && WriteNumAttr(PeriodFd, periodNs);
+    }
+    else
+    {
+        ok = WriteNumAttr(PeriodFd, periodNs) && WriteNumAttr(DutyCycleFd, dutyCycleNs);
+    }
+
+    if (!ok)
+    {
+        // Don't know which writes took effect.
+        PeriodNs = 0;
+        return false;
+    }
+
+    PeriodNs = periodNs;
+    DutyCycleNs = dutyCycleNs;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads an unsigned integer setting from an environment variable.
+ *
+ * @return The value, or the default value if the variable is not set.
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned long GetEnvNum
+(
+    const char *namePtr,
+    unsigned long defaultValue
+)
+{
+    const char *valueStr = getenv(namePtr);
+
+    return ((valueStr != NULL) && (valueStr[0] != '\0')) ? strtoul(valueStr, NULL, 10)
+                                                         : defaultValue;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the PWM backend, exporting the channel if necessary.
+ *
+ * @return LE_OK, or an error code if the channel can't be used.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PwmOpen
+(
+    void
+)
+{
+    unsigned long chip = GetEnvNum("BUZZER_PWM_CHIP", 0);
+    unsigned long channel = GetEnvNum("BUZZER_PWM_CHANNEL", 0);
+    const char *pwmPathPtr = getenv("BUZZER_PWM_PATH");
+    if ((pwmPathPtr == NULL) || (pwmPathPtr[0] == '\0'))
+    {
+        pwmPathPtr = DEFAULT_PWM_PATH;
+    }
+
+    snprintf(ChannelPath, sizeof(ChannelPath), "%s/pwmchip%lu/pwm%lu", pwmPathPtr, chip, channel);
+
+    if (access(ChannelPath, F_OK) != 0)
+    {
+        char path[PATH_MAX];
+        char channelStr[16];
+        snprintf(path, sizeof(path), "%s/pwmchip%lu/export", pwmPathPtr, chip);
+        int len = snprintf(channelStr, sizeof(channelStr), "%lu", channel);
+
+        int fd = open(path, O_WRONLY | O_CLOEXEC);
+        bool exported = (fd != -1) && backend_WriteAttr(fd, channelStr, (size_t)len);
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        if (!exported)
+        {
+            LE_ERROR("Exporting PWM channel (%s) failed (%m)", ChannelPath);
+            return LE_NOT_FOUND;
+        }
+    }
+
+    PeriodFd = OpenAttr("period");
+    DutyCycleFd = OpenAttr("duty_cycle");
+    EnableFd = OpenAttr("enable");
+
+    // The channel must be disabled while it is reconfigured.  Whoever used it last may have left
+    // any period programmed.
+    PeriodNs = 0;
+    if ((PeriodFd == -1) || (DutyCycleFd == -1) || (EnableFd == -1) ||
+        !backend_WriteAttr(EnableFd, "0", 1) ||
+        !Program(ON_PERIOD_NS, ON_PERIOD_NS))
+    {
+        LE_ERROR("Configuring PWM channel (%s) failed (%m)", ChannelPath);
+        CloseAttrs();
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the buzzer on or off.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PwmSet
+(
+    uint32_t freqHz
+)
+{
+    // Put back the "held on" configuration if a cycle was handed over to the hardware.
+    if ((freqHz != 0) && ((PeriodNs != ON_PERIOD_NS) || (DutyCycleNs != ON_PERIOD_NS)) &&
+        !Program(ON_PERIOD_NS, ON_PERIOD_NS))
+    {
+        LE_FATAL("Writing PWM channel (%s) failed (%m)", ChannelPath);
+    }
+
+    if (!backend_WriteAttr(EnableFd, (freqHz != 0) ? "1" : "0", 1))
+    {
+        LE_FATAL("Writing PWM channel (%s) failed (%m)", ChannelPath);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands an on/off cycle over to the PWM hardware.
+ *
+ * @return LE_OK, or LE_OUT_OF_RANGE if the hardware can't produce that cycle.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PwmSetCycle
+(
+    uint64_t periodNs,
+    uint64_t onNs
+)
+{
+    if (!Program(periodNs, onNs) || !backend_WriteAttr(EnableFd, "1", 1))
+    {
+        LE_DEBUG("PWM channel (%s) can't produce a %" PRIu64 "/%" PRIu64 " ns cycle (%m)",
+                 ChannelPath, onNs, periodNs);
+        return LE_OUT_OF_RANGE;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads back whether the buzzer is on.
+ *
+ * @return 1 if it's on, 0 if it's off, or BACKEND_FREQ_UNKNOWN.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t PwmGet
+(
+    void
+)
+{
+    char c;
+
+    if (pread(EnableFd, &c, 1, 0) != 1)
+    {
+        LE_WARN("Reading PWM channel (%s) failed (%m)", ChannelPath);
+        return BACKEND_FREQ_UNKNOWN;
+    }
+
+    return (c == '1') ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the PWM backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PwmClose
+(
+    void
+)
+{
+    PwmSet(0);
+    CloseAttrs();
+}
+
+const backend_Ops_t backend_Pwm =
+{
+    .namePtr = "pwm",
+    .open = PwmOpen,
+    .set = PwmSet,
+    .get = PwmGet,
+    .setCycle = PwmSetCycle,
+    .close = PwmClose,
+    .caps =
+    {
+        .freqsPtr = NULL,
+        .numFreqs = 0,
+        .minToggleNs = 100000,
+    },
+};
@@ -8,12 +8,66 @@
  *    enable = true
  * then the buzzer will emit a sound for 200 ms, turn off for 800 ms, and repeat.
  *
+ * Periods and on times are kept in nanoseconds, so short periods are reproduced exactly.  The
+ * shortest period accepted is the shortest the output backend can sustain.
+ *
  * If enable is false, then no sound will be emitted, regardless of the other settings.
  *
+ * By default, the cycle repeats until enable is set to false.  If count is set, the buzzer stops
+ * by itself after that many cycles (e.g., count = 3 for a triple beep).  If duration is set (in
+ * seconds), the buzzer stops by itself once it has been sounding for that long, wherever it has
+ * got to in the cycle (or pattern, see below).  When the buzzer stops by itself, the done input
+ * is triggered.  Setting enable to true again (even if it already is) starts it over, so a
+ * one-shot beep is just a push of enable = true.  Changing count or duration also starts over.
+ *
+ * If the timing of the cycle isn't critical (e.g., a reminder chirp every 30 seconds), slack can
+ * be set (in seconds).  The off part of each cycle may then be stretched by less than that, so
+ * the buzzer is turned on at a time when other timers are likely to be waking the CPU up anyway
+ * (see pattern.h).  Patterns can have slack of their own.
+ *
+ * The tone of the duty cycle is set by the frequency resource.  The buzzer's output can only
+ * produce certain frequencies, so the nearest one to the value pushed is used.
+ *
+ * More complex sounds (e.g., triple-beep-pause or SOS) can be produced by pushing a JSON pattern
+ * description (see pattern_ParseJson()) to the pattern resource.  While a pattern is set, it is
+ * played instead of the period/percent duty cycle.  Pushing a pattern restarts it from the
+ * beginning.  Pushing null (or an empty string) goes back to the duty cycle.
+ *
+ * Apps that need the buzzer for their own purposes (e.g., a fault monitor) can each be given a
+ * request slot with a priority, by listing them in the BUZZER_REQUESTERS environment variable
+ * (see request.h).  The highest priority request is played, and the settings above only sound
+ * the buzzer when no request is active.
+ *
+ * Updates that arrive together (e.g., a controller setting period and percent at the same time)
+ * are applied together, so the buzzer goes straight to the new configuration without writing
+ * to the hardware for each intermediate one.  By default, updates are coalesced when they are
+ * received in the same turn of the event loop.  If the BUZZER_SETTLE_MS environment variable is
+ * set, updates are also coalesced if they are received within that many milliseconds of the
+ * first one.
+ *
+ * Whether the buzzer is actually sounding, and what it is playing, is published to the active and
+ * state inputs (see status.h), at most once per BUZZER_STATUS_MS milliseconds.
+ *
+ * If the BUZZER_STATS_MS environment variable is set, edge timing statistics are published under
+ * stats/ at that interval (see stats.h), along with how long start-up took.
+ *
+ * The settings, and the point reached in the pattern, are saved to the file named by the
+ * BUZZER_STATE_FILE environment variable (see state.h).  If the process is restarted after a
+ * fault, it carries on from that point straight away, before registering with the Data Hub, so
+ * an alarm that was sounding is only interrupted for as long as the restart takes.  When the app
+ * is stopped, the file is deleted.
+ *
  * <hr>
  *
  * The buzzer is driven by the CLKOUT signal from the RTC chip, which is controlled via a sysfs
- * file.  A Legato timer is used to implement the on/off duty cycle period.
+ * file.  Other output backends can be selected using the BUZZER_BACKEND environment variable
+ * (see backend.h and output.h).
+ *
+ * The on/off duty cycle is compiled into a pattern of (frequency, duration) steps, which is
+ * played by the edge engine (see engine.h), along with any pattern pushed to the pattern
+ * resource.  If the BUZZER_EDGE_THREAD environment variable is set to 1, the engine runs on a
+ * dedicated thread, optionally with a real-time priority (BUZZER_EDGE_PRIORITY) and pinned to a
+ * CPU (BUZZER_EDGE_CPU).
  *
  * <hr>
  *
@@ -23,155 +77,357 @@
 #include "legato.h"
 #include "interfaces.h"
 
+#include <sched.h>
+
+#include "pattern.h"
+#include "output.h"
+#include "patternCache.h"
+#include "engine.h"
+#include "stats.h"
+#include "state.h"
+#include "arbiter.h"
+#include "request.h"
+#include "status.h"
+#include "resource.h"
+
 // Data Hub resource paths, relative to the app's root.
 #define RES_PATH_ENABLE     "enable"
 #define RES_PATH_PERIOD     "period"
 #define RES_PATH_DUTY_CYCLE "percent"
+#define RES_PATH_PATTERN    "pattern"
+#define RES_PATH_FREQUENCY  "frequency"
+#define RES_PATH_COUNT      "count"
+#define RES_PATH_DURATION   "duration"
+#define RES_PATH_SLACK      "slack"
+#define RES_PATH_DONE       "done"
 
 /// Frequency to use to turn the buzzer off.
 #define BUZZER_OFF_FREQ 0
 
-/// Frequency to use to turn the buzzer on.
+/// Default frequency to use to turn the buzzer on.
 /// The buzzer can physically produce a range of frequencies, but is designed to run at 4kHz.
 /// The RTC chip can produce a set of specific frequencies, the closest of which is 4096Hz.
 #define BUZZER_ON_FREQ 4096
 
+/// Highest frequency that can be requested through the frequency resource.
+#define MAX_FREQ_HZ 1000000
+
+/// Frequency used for the on part of the duty cycle (always one the output can produce).
+static uint32_t OnFreqHz = BUZZER_ON_FREQ;
+
 /// Whether the buzzer is enabled or not.
 static bool Enabled = false;
 
 // The on percentage of the buzzer on/off duty cycle (0 to 100).
 static double DutyCycleOnPercent = 100;
 
-// The total number of milliseconds in the full duty cycle period (on + off).
-// Must be >= 10 and <= 3600000 (i.e. 1 hour).
-static uint PeriodMs = 2000;
+// Number of nanoseconds in a second.
+#define NS_PER_SEC 1000000000ULL
+
+// Longest duty cycle period (1 hour).  The shortest is set by what the output backend can
+// sustain: two changes (on and off) per period.
+#define MAX_PERIOD_NS (3600 * NS_PER_SEC)
 
-// The timer used to run the duty cycle
-static le_timer_Ref_t Timer = NULL;
+// The total number of nanoseconds in the full duty cycle period (on + off).
+static uint64_t PeriodNs = 2 * NS_PER_SEC;
 
-// true if the buzzer is currently on (buzzing).
-static bool BuzzerOn = false;
+// Number of duty cycles to play (0 = until disabled).
+static uint32_t CycleCount = 0;
+
+// Longest duration (1 day).
+#define MAX_DURATION_NS (86400 * NS_PER_SEC)
+
+// How long to play the duty cycle or pattern for (0 = until disabled, or until it ends).
+static uint64_t DurationNs = 0;
+
+// How much the off part of the duty cycle may be stretched (0 = not at all).
+static uint64_t SlackNs = 0;
+
+// The pattern that implements the enable/period/percent duty cycle.
+static pattern_Pattern_t DutyCyclePattern;
+
+// The pattern pushed to the pattern resource (NULL if the duty cycle pattern should be played).
+static const pattern_Pattern_t *PatternPtr = NULL;
+
+// Copy of the pattern with the duration as its time limit (compiled patterns are shared by the
+// cache, so they can't be changed).
+static pattern_Pattern_t LimitedPattern;
+
+// The previous pattern, which the arbiter may still refer to until the changes are applied, so it
+// is only released then (NULL if none).
+static const pattern_Pattern_t *ReleasePatternPtr = NULL;
+
+// Arbiter slot the settings are played in (see request.h for the other slots).
+static uint8_t SettingsSlot;
+
+// JSON description of the pattern, as pushed ("" if none), and whether it fits in the state file.
+static char PatternJson[STATE_MAX_JSON_BYTES] = "";
+static bool PatternJsonFits = true;
+
+// true if playing was resumed from the state file, and the pattern hasn't been pushed since.
+static bool Resumed = false;
+
+// true if the duty cycle or pattern has come to its end by itself (so it isn't played again until
+// something starts it over).
+static bool Finished = false;
+
+// Bits of PendingChanges: which settings have been updated but not applied yet.
+#define CHANGE_ENABLE   0x1
+#define CHANGE_PERIOD   0x2
+#define CHANGE_PERCENT  0x4
+#define CHANGE_PATTERN  0x8
+#define CHANGE_FREQ     0x10
+#define CHANGE_COUNT    0x20
+#define CHANGE_DURATION 0x40
+#define CHANGE_SLACK    0x80
+
+// Settings updated since the last time changes were applied (CHANGE_* bits).
+static uint32_t PendingChanges = 0;
+
+// Timer used to apply changes at the end of the settle time (NULL if changes are applied as soon
+// as the updates received in the current event loop turn have been handled).
+static le_timer_Ref_t SettleTimer = NULL;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sets the buzzer control on or off.
+ * Checks that all the frequencies used in a newly compiled pattern can be produced, and that
+ * none of its tones is too short for the output to keep up with.  Tones that take no time at all
+ * are skipped by the sequencer without changing the output, so are allowed.
+ *
+ * @return true if the pattern can be played.
  */
 //--------------------------------------------------------------------------------------------------
-static void SetBuzzer
+static bool CheckPattern
 (
-    bool on ///< true = turn the buzzer on, false = turn the buzzer off.
+    const pattern_Pattern_t *patternPtr ///< Pattern.
 )
 {
-    // Path to the RTC CLKOUT control file in sysfs.
-    static const char BuzzerFreqPath[] = "/sys/bus/i2c/drivers/rtc-pcf85063/8-0051/clkout_freq";
+    uint64_t minToggleNs = output_GetCaps()->minToggleNs;
 
-    static FILE *FreqFile = NULL;
-
-    if (FreqFile == NULL)
+    for (uint16_t i = 0; i < patternPtr->numSteps; i++)
     {
-        FreqFile = fopen(BuzzerFreqPath, "r+");
-        if (FreqFile == NULL)
+        const pattern_Step_t *stepPtr = &patternPtr->steps[i];
+
+        if (stepPtr->op != PATTERN_OP_TONE)
+        {
+            continue;
+        }
+        if (!output_IsSupported(stepPtr->freqHz))
         {
-            LE_FATAL("Opening file (%s) failed (%m)", BuzzerFreqPath);
+            LE_ERROR("Frequency %" PRIu32 " Hz is not supported", stepPtr->freqHz);
+            return false;
+        }
+        if ((stepPtr->durationNs > 0) && (stepPtr->durationNs < minToggleNs))
+        {
+            LE_ERROR("Step of %" PRIu64 " ns is shorter than the output can manage (%" PRIu64
+                     " ns)", stepPtr->durationNs, minToggleNs);
+            return false;
         }
     }
 
-    if (fprintf(FreqFile, "%d", on ? BUZZER_ON_FREQ : BUZZER_OFF_FREQ) == -1)
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rebuilds the duty cycle pattern from the period, percentage, count, duration and slack.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateDutyCyclePattern
+(
+    void
+)
+{
+    uint64_t onNs = (uint64_t)(((double)PeriodNs * DutyCycleOnPercent / 100.0) + 0.5);
+    if (onNs > PeriodNs)
     {
-        LE_FATAL("Write to file (%s) failed (%m)", BuzzerFreqPath);
+        onNs = PeriodNs;
     }
 
-    if (fflush(FreqFile) != 0)
+    // Neither part of the cycle can be shorter than the output can keep up with, unless it is
+    // left out altogether.  A part that is asked for is never left out, so it is lengthened (the
+    // period is at least twice the shortest toggle, so lengthening one never shortens the other
+    // too much).
+    uint64_t minToggleNs = output_GetCaps()->minToggleNs;
+    if ((onNs > 0) && (onNs < minToggleNs))
     {
-        LE_FATAL("fflush of file (%s) failed (%m)", BuzzerFreqPath);
+        onNs = minToggleNs;
+    }
+    if ((onNs < PeriodNs) && (PeriodNs - onNs < minToggleNs))
+    {
+        onNs = PeriodNs - minToggleNs;
+    }
+
+    pattern_MakeDutyCycle(&DutyCyclePattern, OnFreqHz, PeriodNs, onNs, CycleCount);
+    DutyCyclePattern.slackNs = SlackNs;
+    if (DurationNs != 0)
+    {
+        DutyCyclePattern.limitNs = DurationNs;
     }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Start at the beginning of a duty cycle.
+ * Gets the pattern the settings call for: the pattern pushed (with the duration as its time
+ * limit), or the duty cycle.
+ *
+ * @return The pattern, which stays valid until the next call.
  */
 //--------------------------------------------------------------------------------------------------
-static void StartCycle
+static const pattern_Pattern_t *GetSettingsPattern
 (
     void
 )
 {
-    SetBuzzer(true);
-    BuzzerOn = true;
-    uint32_t ms = (uint32_t)(PeriodMs * DutyCycleOnPercent / 100.0);
-    if (ms == 0)
+    if (PatternPtr == NULL)
     {
-        ms = 1;
+        return &DutyCyclePattern;
     }
-    le_timer_SetMsInterval(Timer, ms);
-    le_timer_Start(Timer);
+
+    if (DurationNs == 0)
+    {
+        return PatternPtr;
+    }
+
+    LimitedPattern = *PatternPtr;
+    LimitedPattern.limitNs = DurationNs;
+    return &LimitedPattern;
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Disable the buzzer, immediately stopping it, even if it's in the middle of a duty cycle.
+ * Saves the settings to the state file.
  */
 //--------------------------------------------------------------------------------------------------
-static void StopCycle
+static void SaveSettings
 (
     void
 )
 {
-    le_timer_Stop(Timer);
-    if (BuzzerOn)
+    static state_Settings_t settings;
+
+    if (!PatternJsonFits)
     {
-        SetBuzzer(false);
-        BuzzerOn = false;
+        state_SaveSettings(NULL);
+        return;
     }
+
+    settings.enabled = Enabled;
+    settings.periodNs = PeriodNs;
+    settings.percent = DutyCycleOnPercent;
+    settings.freqHz = OnFreqHz;
+    settings.count = CycleCount;
+    settings.durationNs = DurationNs;
+    settings.slackNs = SlackNs;
+    settings.generation = engine_GetGeneration(SettingsSlot);
+    memcpy(settings.patternJson, PatternJson, sizeof(settings.patternJson));
+
+    state_SaveSettings(&settings);
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Timer expiry handler function.
+ * Applies all the settings updated since the last time this was called, in one go.
  */
 //--------------------------------------------------------------------------------------------------
-static void TimerExpiryHandler
+static void ApplyChanges
 (
-    le_timer_Ref_t timer
+    void
 )
 {
-    // If the buzzer is on, it's time to turn it off and adjust the timer for the off period.
-    // Otherwise, it's time to turn it on and restart the timer for the on period.
-    // NOTE: the timer will drift less if we leave it running while we update its interval,
-    // rather than stopping the timer while updating its interval.
-    if (BuzzerOn)
-    {
-        // If the duty cycle is 100%, then just leave the buzzer on.
-        if (DutyCycleOnPercent < 100.0)
-        {
-            SetBuzzer(false);
-            BuzzerOn = false;
+    uint32_t changes = PendingChanges;
+    PendingChanges = 0;
 
-            uint32_t ms = (uint32_t)(PeriodMs * (100.0 - DutyCycleOnPercent) / 100.0);
-            if (ms == 0)
-            {
-                ms = 1;
-            }
-            le_timer_SetMsInterval(timer, ms);
-        }
+    if (changes & (CHANGE_PERIOD | CHANGE_PERCENT | CHANGE_FREQ | CHANGE_COUNT | CHANGE_DURATION |
+                   CHANGE_SLACK))
+    {
+        UpdateDutyCyclePattern();
     }
-    else
+
+    if (!Enabled)
     {
-        // If the duty cycle is 0%, then just leave the buzzer off.
-        if (DutyCycleOnPercent > 0.0)
+        if (changes & CHANGE_ENABLE)
         {
-            SetBuzzer(true);
-            BuzzerOn = true;
+            arbiter_Release(SettingsSlot);
+            Finished = false;
+        }
+    }
+    else if ((changes & (CHANGE_ENABLE | CHANGE_PATTERN | CHANGE_DURATION)) ||
+             ((changes & (CHANGE_PERIOD | CHANGE_COUNT)) && (PatternPtr == NULL)))
+    {
+        // Restart from the beginning of the pattern (or the duty cycle).  A new period or count
+        // doesn't affect a pattern that has been set.
+        arbiter_Play(SettingsSlot, GetSettingsPattern());
+        Finished = false;
+    }
+    else if ((changes & (CHANGE_PERCENT | CHANGE_FREQ | CHANGE_SLACK)) && (PatternPtr == NULL) &&
+             !Finished)
+    {
+        // The duty cycle pattern has been rebuilt in place with the same shape, so the engine
+        // carries on from the same position with the new on and off times, tone and slack.
+        arbiter_Update(SettingsSlot, &DutyCyclePattern);
+    }
 
-            uint32_t ms = (uint32_t)(PeriodMs * DutyCycleOnPercent / 100.0);
-            if (ms == 0)
-            {
-                ms = 1;
-            }
-            le_timer_SetMsInterval(timer, ms);
+    if (ReleasePatternPtr != NULL)
+    {
+        patternCache_Release(ReleasePatternPtr);
+        ReleasePatternPtr = NULL;
+    }
+
+    SaveSettings();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deferred function used to apply changes at the end of the current event loop turn.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyChangesDeferred
+(
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    ApplyChanges();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Settle timer expiry handler function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SettleTimerExpiryHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    ApplyChanges();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records that a setting has been updated.  The first update schedules all the changes to be
+ * applied together, later on.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MarkChanged
+(
+    uint32_t change ///< CHANGE_* bit for the setting.
+)
+{
+    if (PendingChanges == 0)
+    {
+        if (SettleTimer != NULL)
+        {
+            le_timer_Start(SettleTimer);
+        }
+        else
+        {
+            le_event_QueueFunction(ApplyChangesDeferred, NULL, NULL);
         }
     }
+
+    PendingChanges |= change;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -186,20 +442,16 @@ static void EnablePushHandler
     void *context
 )
 {
-    // Ignore updates that don't change the value.
-    if (enable != Enabled)
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    // Ignore updates that don't change the value, unless they start a finished cycle over.
+    if ((enable != Enabled) || (enable && Finished))
     {
         Enabled = enable;
-
-        if (enable)
-        {
-            StartCycle();
-        }
-        else
-        {
-            StopCycle();
-        }
+        MarkChanged(CHANGE_ENABLE);
     }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -214,27 +466,25 @@ static void PeriodPushHandler
     void *context
 )
 {
-    // Restrict the range
-    if (period < 0.01 || period > 3600.0)
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    double minPeriod = (double)(2 * output_GetCaps()->minToggleNs) / NS_PER_SEC;
+    if (!resource_IsInRange(period, minPeriod, (double)MAX_PERIOD_NS / NS_PER_SEC))
     {
-        LE_ERROR("Received invalid duty cycle period (%lf seconds) - must be between 0.01 & 3600",
-                 period);
+        LE_ERROR("Received invalid duty cycle period (%lf seconds) - must be between %lf & %lf",
+                 period, minPeriod, (double)MAX_PERIOD_NS / NS_PER_SEC);
     }
     else
     {
-        uint periodMs = (uint)(period * 1000);  // Convert to integer number of milliseconds.
-        if (PeriodMs != periodMs)
+        uint64_t periodNs = (uint64_t)((period * NS_PER_SEC) + 0.5);
+        if (PeriodNs != periodNs)
         {
-            PeriodMs = periodMs;
-
-            // If the buzzer is enabled, stop the buzzer and the timer and restart everything.
-            if (Enabled)
-            {
-                StopCycle();
-                StartCycle();
-            }
+            PeriodNs = periodNs;
+            MarkChanged(CHANGE_PERIOD);
         }
     }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -249,7 +499,9 @@ static void PercentPushHandler
     void *context
 )
 {
-    if (percent < 0.0 || percent > 100.0)
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    if (!resource_IsInRange(percent, 0.0, 100.0))
     {
         LE_ERROR("Ignoring invalid duty cycle percentage (%lf) - must be between 0 & 100", percent);
     }
@@ -258,43 +510,769 @@ static void PercentPushHandler
         if (DutyCycleOnPercent != percent)
         {
             DutyCycleOnPercent = percent;
+            MarkChanged(CHANGE_PERCENT);
+        }
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for duty cycle frequency setpoint updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FrequencyPushHandler
+(
+    double timestamp,
+    double frequency,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    if (!resource_IsInRange(frequency, 1.0, MAX_FREQ_HZ))
+    {
+        LE_ERROR("Ignoring invalid frequency (%lf Hz) - must be between 1 & %d",
+                 frequency, MAX_FREQ_HZ);
+    }
+    else
+    {
+        uint32_t freqHz = output_GetNearestFreq((uint32_t)(frequency + 0.5));
+        if (OnFreqHz != freqHz)
+        {
+            OnFreqHz = freqHz;
+            MarkChanged(CHANGE_FREQ);
+        }
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for duty cycle count setpoint updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountPushHandler
+(
+    double timestamp,
+    double count,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    if (!resource_IsInRange(count, 0.0, PATTERN_MAX_LOOP_COUNT))
+    {
+        LE_ERROR("Ignoring invalid count (%lf) - must be between 0 & %d",
+                 count, PATTERN_MAX_LOOP_COUNT);
+    }
+    else
+    {
+        uint32_t cycleCount = (uint32_t)(count + 0.5);
+        if (CycleCount != cycleCount)
+        {
+            CycleCount = cycleCount;
+            MarkChanged(CHANGE_COUNT);
+        }
+    }
 
-            // If the buzzer is on, it's not too late to update the timer interval in this
-            // cycle.  Otherwise, we have to wait for the off period to end before updating.
-            // Also, the buzzer won't be on if it's disabled.
-            if (BuzzerOn)
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for duration setpoint updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DurationPushHandler
+(
+    double timestamp,
+    double duration,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    if (!resource_IsInRange(duration, 0.0, (double)MAX_DURATION_NS / NS_PER_SEC))
+    {
+        LE_ERROR("Ignoring invalid duration (%lf seconds) - must be between 0 & %lf",
+                 duration, (double)MAX_DURATION_NS / NS_PER_SEC);
+    }
+    else
+    {
+        uint64_t durationNs = (uint64_t)((duration * NS_PER_SEC) + 0.5);
+        if (DurationNs != durationNs)
+        {
+            DurationNs = durationNs;
+            MarkChanged(CHANGE_DURATION);
+        }
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for duty cycle slack setpoint updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SlackPushHandler
+(
+    double timestamp,
+    double slack,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    if (!resource_IsInRange(slack, 0.0, (double)PATTERN_MAX_SLACK_NS / NS_PER_SEC))
+    {
+        LE_ERROR("Ignoring invalid slack (%lf seconds) - must be between 0 & %lf",
+                 slack, (double)PATTERN_MAX_SLACK_NS / NS_PER_SEC);
+    }
+    else
+    {
+        uint64_t slackNs = (uint64_t)((slack * NS_PER_SEC) + 0.5);
+        if (SlackNs != slackNs)
+        {
+            SlackNs = slackNs;
+            MarkChanged(CHANGE_SLACK);
+        }
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for pattern updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PatternPushHandler
+(
+    double timestamp,
+    const char *json,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+    const pattern_Pattern_t *newPatternPtr = NULL;
+    le_result_t result = LE_OK;
+
+    if ((json[0] != '\0') && (strcmp(json, "null") != 0))
+    {
+        // Patterns tend to be pushed over and over again, so they are compiled only once.
+        result = patternCache_Get(json, &newPatternPtr);
+    }
+
+    if (result != LE_OK)
+    {
+        LE_ERROR("Ignoring invalid pattern (%s)", LE_RESULT_TXT(result));
+    }
+    else if (Resumed && (newPatternPtr == PatternPtr))
+    {
+        // The Data Hub is pushing the pattern that was resumed from the state file again (e.g.,
+        // after the restart), so it carries on rather than starting again.
+        if (newPatternPtr != NULL)
+        {
+            patternCache_Release(newPatternPtr);
+        }
+    }
+    else
+    {
+        if (PatternPtr != NULL)
+        {
+            // If the pattern being replaced was pushed since the changes were last applied, the
+            // arbiter has never seen it.
+            if (PendingChanges & CHANGE_PATTERN)
+            {
+                patternCache_Release(PatternPtr);
+            }
+            else
             {
-                uint32_t ms = (uint32_t)(PeriodMs * DutyCycleOnPercent / 100.0);
-                if (ms == 0)
+                ReleasePatternPtr = PatternPtr;
+            }
+        }
+        PatternPtr = newPatternPtr;
+
+        if (PatternPtr == NULL)
+        {
+            PatternJson[0] = '\0';
+            PatternJsonFits = true;
+        }
+        else
+        {
+            PatternJsonFits = (le_utf8_Copy(PatternJson, json, sizeof(PatternJson), NULL) == LE_OK);
+            if (!PatternJsonFits)
+            {
+                LE_WARN("Pattern is too long to be saved in the state file");
+            }
+        }
+
+        // Even if the pattern is the same, pushing it restarts it.
+        MarkChanged(CHANGE_PATTERN);
+    }
+    Resumed = false;
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Functions that get the default value of a resource (the current setting).
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetEnableDefault(void)    { return Enabled ? 1 : 0; }
+static double GetPeriodDefault(void)    { return ((double)PeriodNs) / NS_PER_SEC; }
+static double GetPercentDefault(void)   { return DutyCycleOnPercent; }
+static double GetFrequencyDefault(void) { return OnFreqHz; }
+static double GetCountDefault(void)     { return CycleCount; }
+static double GetDurationDefault(void)  { return ((double)DurationNs) / NS_PER_SEC; }
+static double GetSlackDefault(void)     { return ((double)SlackNs) / NS_PER_SEC; }
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A Data Hub output resource (a setting).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *pathPtr;                            ///< Path, relative to the app's root.
+    dhubIO_DataType_t type;                         ///< BOOLEAN, NUMERIC or JSON.
+    const char *unitsPtr;                           ///< Units.
+    union
+    {
+        dhubIO_BooleanPushHandlerFunc_t boolean;    ///< BOOLEAN.
+        dhubIO_NumericPushHandlerFunc_t numeric;    ///< NUMERIC.
+        dhubIO_JsonPushHandlerFunc_t json;          ///< JSON.
+    }
+    handler;                                        ///< Push handler function.
+    double (*getDefaultFunc)(void);                 ///< Gets the default value (NULL = none).
+}
+Resource_t;
+
+/// The settings, in the order they are registered.  Enable comes first, as it is the one needed
+/// to sound the buzzer.
+static const Resource_t Resources[] =
+{
+    {
+        RES_PATH_ENABLE, DHUBIO_DATA_TYPE_BOOLEAN, "",
+        .handler.boolean = EnablePushHandler, .getDefaultFunc = GetEnableDefault
+    },
+    {
+        RES_PATH_PERIOD, DHUBIO_DATA_TYPE_NUMERIC, "s",
+        .handler.numeric = PeriodPushHandler, .getDefaultFunc = GetPeriodDefault
+    },
+    {
+        RES_PATH_DUTY_CYCLE, DHUBIO_DATA_TYPE_NUMERIC, "%",
+        .handler.numeric = PercentPushHandler, .getDefaultFunc = GetPercentDefault
+    },
+    {
+        RES_PATH_FREQUENCY, DHUBIO_DATA_TYPE_NUMERIC, "Hz",
+        .handler.numeric = FrequencyPushHandler, .getDefaultFunc = GetFrequencyDefault
+    },
+    {
+        RES_PATH_COUNT, DHUBIO_DATA_TYPE_NUMERIC, "",
+        .handler.numeric = CountPushHandler, .getDefaultFunc = GetCountDefault
+    },
+    {
+        RES_PATH_DURATION, DHUBIO_DATA_TYPE_NUMERIC, "s",
+        .handler.numeric = DurationPushHandler, .getDefaultFunc = GetDurationDefault
+    },
+    {
+        RES_PATH_SLACK, DHUBIO_DATA_TYPE_NUMERIC, "s",
+        .handler.numeric = SlackPushHandler, .getDefaultFunc = GetSlackDefault
+    },
+    {
+        RES_PATH_PATTERN, DHUBIO_DATA_TYPE_JSON, "",
+        .handler.json = PatternPushHandler, .getDefaultFunc = NULL
+    },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads an unsigned integer setting from an environment variable.
+ *
+ * @return The value of the setting, or the default value if it is not set or not valid.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GetEnvUint
+(
+    const char *namePtr,    ///< Name of the environment variable.
+    uint32_t defaultValue,  ///< Value to use if the variable is not set or not valid.
+    uint32_t maxValue       ///< Largest valid value.
+)
+{
+    const char *valueStr = getenv(namePtr);
+    if ((valueStr == NULL) || (valueStr[0] == '\0'))
+    {
+        return defaultValue;
+    }
+
+    char *endPtr;
+    errno = 0;
+    unsigned long value = strtoul(valueStr, &endPtr, 10);
+    if ((*endPtr != '\0') || (errno != 0) || (value > maxValue))
+    {
+        LE_ERROR("Ignoring invalid %s (%s) - must be between 0 & %" PRIu32,
+                 namePtr, valueStr, maxValue);
+        return defaultValue;
+    }
+
+    return (uint32_t)value;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads a string setting from an environment variable.
+ *
+ * @return The value of the setting, or NULL if it is not set or empty.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char *GetEnvStr
+(
+    const char *namePtr     ///< Name of the environment variable.
+)
+{
+    const char *valueStr = getenv(namePtr);
+    if ((valueStr != NULL) && (valueStr[0] == '\0'))
+    {
+        return NULL;
+    }
+
+    return valueStr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restores the settings saved in the state file by the previous process, if they are still valid.
+ *
+ * @return true if the settings were restored.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool RestoreSettings
+(
+    const state_Settings_t *settingsPtr ///< Settings saved by the previous process.
+)
+{
+    // The backend may have been changed since they were saved.
+    uint64_t minPeriodNs = 2 * output_GetCaps()->minToggleNs;
+    if ((settingsPtr->periodNs < minPeriodNs) || (settingsPtr->periodNs > MAX_PERIOD_NS) ||
+        !((settingsPtr->percent >= 0.0) && (settingsPtr->percent <= 100.0)) ||
+        (settingsPtr->freqHz == 0) || (settingsPtr->freqHz > MAX_FREQ_HZ) ||
+        (settingsPtr->count > PATTERN_MAX_LOOP_COUNT) ||
+        (settingsPtr->durationNs > MAX_DURATION_NS) ||
+        (settingsPtr->slackNs > PATTERN_MAX_SLACK_NS))
+    {
+        LE_WARN("Saved settings are not valid.  Not resuming.");
+        return false;
+    }
+
+    const pattern_Pattern_t *patternPtr = NULL;
+    if (settingsPtr->patternJson[0] != '\0')
+    {
+        le_result_t result = patternCache_Get(settingsPtr->patternJson, &patternPtr);
+        if (result != LE_OK)
+        {
+            LE_WARN("Saved pattern is not valid (%s).  Not resuming.", LE_RESULT_TXT(result));
+            return false;
+        }
+    }
+
+    Enabled = settingsPtr->enabled;
+    PeriodNs = settingsPtr->periodNs;
+    DutyCycleOnPercent = settingsPtr->percent;
+    OnFreqHz = output_GetNearestFreq(settingsPtr->freqHz);
+    CycleCount = settingsPtr->count;
+    DurationNs = settingsPtr->durationNs;
+    SlackNs = settingsPtr->slackNs;
+    PatternPtr = patternPtr;
+    memcpy(PatternJson, settingsPtr->patternJson, sizeof(PatternJson));
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Carries on playing from where the previous process was, according to the state file.  If it
+ * didn't save what it was playing, the pattern (or duty cycle) is started from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResumePlaying
+(
+    void
+)
+{
+    // The arbiter refers to the pattern for as long as the settings don't change.
+    static pattern_Pattern_t pattern;
+    seq_Position_t position;
+    uint8_t slot;
+
+    if (!Enabled)
+    {
+        engine_Stop();
+    }
+    else if (!state_GetPlayback(&slot, &pattern, &position) || !CheckPattern(&pattern))
+    {
+        arbiter_Play(SettingsSlot, GetSettingsPattern());
+    }
+    else if (pattern.numSteps == 0)
+    {
+        // The pattern had finished (and the done input was triggered then).
+        engine_Stop();
+        Finished = true;
+    }
+    else if (slot != SettingsSlot)
+    {
+        // A request was being played.  Requests aren't saved, so the requester has to push it
+        // again.  Meanwhile, the settings carry on from where they were paused when the request
+        // took over, as if no time had passed since (as they would have once it had finished).
+        bool finished;
+        uint64_t pausedAtNs;
+        if (!state_GetPaused(&finished, &position, &pausedAtNs))
+        {
+            arbiter_Play(SettingsSlot, GetSettingsPattern());
+        }
+        else if (finished)
+        {
+            engine_Stop();
+            Finished = true;
+        }
+        else
+        {
+            seq_ShiftPosition(&position, backend_GetMonotonicNs() - pausedAtNs);
+            arbiter_Resume(SettingsSlot, GetSettingsPattern(), &position);
+        }
+    }
+    else
+    {
+        arbiter_Resume(SettingsSlot, &pattern, &position);
+    }
+
+    // Saved again for this process, whose engine generations are its own.
+    SaveSettings();
+
+    Resumed = true;
+    LE_INFO("Resumed from saved state (%s)", Enabled ? "enabled" : "disabled");
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Called by the arbiter when the duty cycle or pattern has come to its end by itself.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFinished
+(
+    void *contextPtr
+)
+{
+    static const resource_Input_t doneInput = { RES_PATH_DONE, DHUBIO_DATA_TYPE_TRIGGER, "" };
+    static bool doneCreated = false;
+
+    Finished = true;
+
+    resource_CreateInputs(&doneInput, 1, &doneCreated);
+    dhubIO_PushTrigger(RES_PATH_DONE, DHUBIO_NOW);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SIGTERM handler function.  Makes sure the buzzer isn't left on when the app is stopped.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SigTermHandler
+(
+    int sigNum
+)
+{
+    engine_Close();
+
+    // Stopped on purpose, so the next start shouldn't carry on from here.
+    state_Discard();
+    exit(EXIT_SUCCESS);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets how long ago the process started.  This is the one time reading that isn't taken from
+ * backend_GetMonotonicNs(), as the kernel records process start times on the boot-time clock.
+ *
+ * @return true if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool GetProcessAgeNs
+(
+    uint64_t *ageNsPtr  ///< [OUT] Time since the process started.
+)
+{
+    char buffer[512];
+
+    int fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+    ssize_t len = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (len <= 0)
+    {
+        return false;
+    }
+    buffer[len] = '\0';
+
+    // The command name (field 2) can contain anything, so fields are counted from the end of it.
+    // The start time, in clock ticks since boot, is field 22.
+    const char *fieldPtr = strrchr(buffer, ')');
+    for (int field = 3; (field <= 22) && (fieldPtr != NULL); field++)
+    {
+        fieldPtr = strchr(fieldPtr + 1, ' ');
+    }
+
+    struct timespec now;
+    long ticksPerSec = sysconf(_SC_CLK_TCK);
+    if ((fieldPtr == NULL) || (ticksPerSec <= 0) || (clock_gettime(CLOCK_BOOTTIME, &now) != 0))
+    {
+        return false;
+    }
+
+    uint64_t startNs = strtoull(fieldPtr + 1, NULL, 10) * NS_PER_SEC / (uint64_t)ticksPerSec;
+    uint64_t nowNs = ((uint64_t)now.tv_sec * NS_PER_SEC) + (uint64_t)now.tv_nsec;
+    *ageNsPtr = (nowNs > startNs) ? (nowNs - startNs) : 0;
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Registers the settings with the Data Hub, with their current values as defaults.
+ *
+ * @return The time from the process starting to the first setting being registered (0 if
+ *         unknown).
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t RegisterResources
+(
+    void
+)
+{
+    uint64_t firstNs = 0;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Resources); i++)
+    {
+        const Resource_t *resPtr = &Resources[i];
+
+        LE_ASSERT(LE_OK == dhubIO_CreateOutput(resPtr->pathPtr, resPtr->type, resPtr->unitsPtr));
+
+        switch (resPtr->type)
+        {
+            case DHUBIO_DATA_TYPE_BOOLEAN:
+                LE_ASSERT(dhubIO_AddBooleanPushHandler(resPtr->pathPtr, resPtr->handler.boolean,
+                                                       NULL));
+                if (resPtr->getDefaultFunc != NULL)
                 {
-                    ms = 1;
+                    dhubIO_SetBooleanDefault(resPtr->pathPtr, resPtr->getDefaultFunc() != 0);
                 }
-                le_timer_SetMsInterval(Timer, ms);
-            }
+                break;
+
+            case DHUBIO_DATA_TYPE_NUMERIC:
+                LE_ASSERT(dhubIO_AddNumericPushHandler(resPtr->pathPtr, resPtr->handler.numeric,
+                                                       NULL));
+                if (resPtr->getDefaultFunc != NULL)
+                {
+                    dhubIO_SetNumericDefault(resPtr->pathPtr, resPtr->getDefaultFunc());
+                }
+                break;
+
+            case DHUBIO_DATA_TYPE_JSON:
+                LE_ASSERT(dhubIO_AddJsonPushHandler(resPtr->pathPtr, resPtr->handler.json, NULL));
+                break;
+
+            default:
+                LE_FATAL("Unsupported type for resource '%s'", resPtr->pathPtr);
+        }
+
+        if ((i == 0) && !GetProcessAgeNs(&firstNs))
+        {
+            firstNs = 0;
         }
     }
+
+    return firstNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of the thread that opens the output and turns it off, while the main thread
+ * registers with the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void *OpenThreadMain
+(
+    void *contextPtr
+)
+{
+    // Opening the output tests that the buzzer's output (e.g., its sysfs entry) is available
+    // inside the app sandbox.
+    output_Open(GetEnvStr("BUZZER_BACKEND"));
+
+    // Turn off the buzzer to start (if it isn't off already).
+    output_Set(BUZZER_OFF_FREQ);
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on its own thread) each time it has applied a snapshot (see
+ * engine_CheckpointFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+static void Checkpoint
+(
+    uint8_t slot,                           ///< Slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+)
+{
+    state_SavePlayback(slot, patternPtr, positionPtr);
+    status_Record(slot, patternPtr, positionPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on its own thread) when it pauses a slot (see
+ * engine_PauseFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+static void SavePaused
+(
+    uint8_t slot,                           ///< Slot paused.
+    uint32_t generation,                    ///< Slot's generation.
+    const seq_Position_t *positionPtr,      ///< Position in the pattern (NULL if it had
+                                            ///  finished).
+    uint64_t pausedAtNs                     ///< Time at which it was paused.
+)
+{
+    // Only the settings are saved, so only they can carry on from where they were paused.
+    if (slot == SettingsSlot)
+    {
+        state_SavePaused(generation, positionPtr, pausedAtNs);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts the edge engine (and the statistics and status, which must be collecting before the
+ * engine starts, as it may be on another thread).  The output must be open.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartEngine
+(
+    void
+)
+{
+    stats_Init(GetEnvUint("BUZZER_STATS_MS", 0, 86400000));
+    status_Init(GetEnvUint("BUZZER_STATUS_MS", 1000, 3600000));
+
+    engine_Config_t engineConfig =
+    {
+        .ownThread = (GetEnvUint("BUZZER_EDGE_THREAD", 0, 1) != 0),
+        .rtPriority = GetEnvUint("BUZZER_EDGE_PRIORITY", 0, 32),
+        .cpu = -1,
+        .readBackMs = GetEnvUint("BUZZER_READBACK_MS", 0, 3600000),
+        .batchEdges = GetEnvUint("BUZZER_BATCH_EDGES", 0, BACKEND_MAX_SCHEDULED + 1),
+        .checkpointFunc = Checkpoint,
+        .pauseFunc = SavePaused,
+        .stretchFunc = state_SavePosition,
+        .finishedFunc = arbiter_HandleFinished,
+    };
+    uint32_t cpu = GetEnvUint("BUZZER_EDGE_CPU", UINT32_MAX, CPU_SETSIZE - 1);
+    if (cpu != UINT32_MAX)
+    {
+        engineConfig.cpu = (int)cpu;
+    }
+    engine_Init(&engineConfig);
 }
 
 COMPONENT_INIT
 {
-    // Turn off the buzzer to start.
-    // This not only ensures that the buzzer is off, but it also tests that the buzzer's
-    // sysfs entry is available inside the app sandbox.
-    SetBuzzer(false);
-
-    Timer = le_timer_Create("Buzzer Timer");
-    le_timer_SetRepeat(Timer, 0 /* number of iterations, where 0 = infinity */);
-    le_timer_SetHandler(Timer, TimerExpiryHandler);
-
-    LE_ASSERT(LE_OK == dhubIO_CreateOutput(RES_PATH_ENABLE, DHUBIO_DATA_TYPE_BOOLEAN, ""));
-    LE_ASSERT(dhubIO_AddBooleanPushHandler(RES_PATH_ENABLE, EnablePushHandler, NULL));
-    dhubIO_SetBooleanDefault(RES_PATH_ENABLE, Enabled);
-
-    LE_ASSERT(LE_OK == dhubIO_CreateOutput(RES_PATH_PERIOD, DHUBIO_DATA_TYPE_NUMERIC, "s"));
-    LE_ASSERT(dhubIO_AddNumericPushHandler(RES_PATH_PERIOD, PeriodPushHandler, NULL));
-    dhubIO_SetNumericDefault(RES_PATH_PERIOD, ((double)PeriodMs) / 1000.0);
-
-    LE_ASSERT(LE_OK == dhubIO_CreateOutput(RES_PATH_DUTY_CYCLE, DHUBIO_DATA_TYPE_NUMERIC, "%"));
-    LE_ASSERT(dhubIO_AddNumericPushHandler(RES_PATH_DUTY_CYCLE, PercentPushHandler, NULL));
-    dhubIO_SetNumericDefault(RES_PATH_DUTY_CYCLE, DutyCycleOnPercent);
+    // Only used during start-up, but too big for the stack.
+    static state_Settings_t savedSettings;
+
+    le_sig_Block(SIGTERM);
+    le_sig_SetEventHandler(SIGTERM, SigTermHandler);
+
+    patternCache_Init(CheckPattern);
+    state_Open(GetEnvStr("BUZZER_STATE_FILE"));
+    SettingsSlot = arbiter_AddSlot("settings", 0, HandleFinished, NULL);
+
+    OnFreqHz = BUZZER_ON_FREQ;
+
+    le_thread_Ref_t openThread = NULL;
+    if (state_GetSettings(&savedSettings))
+    {
+        // Restarted after a fault.  Get back to playing first, before registering with the Data
+        // Hub (which may take a while).  The output is left as it is, so an alarm that was
+        // sounding doesn't stop and start again.
+        output_Open(GetEnvStr("BUZZER_BACKEND"));
+        OnFreqHz = output_GetNearestFreq(OnFreqHz);
+
+        bool resume = RestoreSettings(&savedSettings);
+        if (!resume)
+        {
+            output_Set(BUZZER_OFF_FREQ);
+        }
+        UpdateDutyCyclePattern();
+        StartEngine();
+        if (resume)
+        {
+            ResumePlaying();
+        }
+    }
+    else
+    {
+        // Opening the output and turning it off goes to the hardware, so it's done on another
+        // thread while this one registers with the Data Hub.  Push handlers (which need the
+        // output) can't be called until this function has returned.
+        openThread = le_thread_Create("BuzzerOpen", OpenThreadMain, NULL);
+        le_thread_SetJoinable(openThread);
+        le_thread_Start(openThread);
+    }
+
+    uint32_t settleMs = GetEnvUint("BUZZER_SETTLE_MS", 0, 10000);
+    if (settleMs > 0)
+    {
+        SettleTimer = le_timer_Create("Buzzer Settle");
+        le_timer_SetMsInterval(SettleTimer, settleMs);
+        le_timer_SetHandler(SettleTimer, SettleTimerExpiryHandler);
+    }
+
+    uint64_t registeredNs = RegisterResources();
+    request_Init(GetEnvStr("BUZZER_REQUESTERS"));
+
+    if (openThread != NULL)
+    {
+        le_thread_Join(openThread, NULL);
+
+        // The frequency was registered before the output's capabilities were known, so its
+        // default is corrected if the output can't produce it (which is rarely the case).
+        uint32_t freqHz = output_GetNearestFreq(OnFreqHz);
+        if (freqHz != OnFreqHz)
+        {
+            OnFreqHz = freqHz;
+            dhubIO_SetNumericDefault(RES_PATH_FREQUENCY, OnFreqHz);
+        }
+        UpdateDutyCyclePattern();
+        StartEngine();
+    }
+
+    uint64_t readyNs;
+    if ((registeredNs != 0) && GetProcessAgeNs(&readyNs))
+    {
+        LE_INFO("Ready %" PRIu64 " ms after process start (first setting registered after %"
+                PRIu64 " ms)", readyNs / 1000000, registeredNs / 1000000);
+        stats_RecordStartup(registeredNs, readyNs);
+    }
 }
@@ -0,0 +1,998 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * The edge engine.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "engine.h"
+#include "output.h"
+#include "sequencer.h"
+#include "stats.h"
+
+/// Frequency to use to turn the buzzer off.
+#define OFF_FREQ 0
+
+/// Number of nanoseconds in a second.
+#define NS_PER_SEC 1000000000ULL
+
+/// Flag set in SharedIndex when the snapshot it refers to hasn't been picked up by the engine yet.
+#define SNAPSHOT_FRESH 0x4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A snapshot of what the engine should be doing.  Each one is complete, so the engine only ever
+ * needs the latest one, and never sees half of a change.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t version;               ///< Incremented each time a snapshot is published.
+    uint8_t slot;                   ///< Slot the pattern is played for.
+    uint32_t generation;            ///< The slot's generation (see Generations).
+    bool playing;                   ///< false if the output should be off.
+    bool closing;                   ///< true if the output should be closed.
+    bool resume;                    ///< true if the pattern should be played from position.
+    seq_Position_t position;        ///< Position to resume playing from (if resume).
+    pattern_Pattern_t pattern;      ///< Pattern to play (if playing).
+}
+Snapshot_t;
+
+/// Snapshot buffers.  At any time, one belongs to the main thread (WriteIndex), one to the engine
+/// (ReadIndex), and the third is the one most recently handed over (SharedIndex).  Buffers change
+/// hands by atomically swapping indexes, so neither side ever waits for the other.
+static Snapshot_t Snapshots[3];
+static uint32_t WriteIndex = 0;
+static uint32_t SharedIndex = 1;
+static uint32_t ReadIndex = 2;
+
+/// Main thread side: version of the last snapshot published.
+static uint32_t Version = 0;
+
+/// Main thread side: generation of each slot.  A slot's generation is incremented each time its
+/// pattern should start again from the beginning, rather than carry on from where it was.
+static uint32_t Generations[ENGINE_MAX_SLOTS];
+
+/// Slot number meaning no slot.
+#define NO_SLOT UINT8_MAX
+
+/// Engine side: slot and generation of the snapshot being played.
+static uint8_t PlayingSlot = NO_SLOT;
+static uint32_t PlayingGeneration = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine side: where a slot's pattern was when another slot took over the output.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool valid;                     ///< false if the slot hasn't been paused.
+    bool finished;                  ///< true if the pattern had already finished.
+    uint32_t generation;            ///< Generation of the slot when it was paused.
+    uint16_t numSteps;              ///< Number of steps in the pattern (to check its shape).
+    uint64_t pausedAtNs;            ///< Time at which it was paused.
+    seq_Position_t position;        ///< Position in the pattern.
+}
+Paused_t;
+
+static Paused_t Paused[ENGINE_MAX_SLOTS];
+
+/// The pattern being played (in the engine's snapshot buffer), or NULL.
+static const pattern_Pattern_t *PatternPtr = NULL;
+
+/// The sequencer playing the pattern.
+static seq_Player_t Player;
+
+/// The timerfd used to run the sequencer (-1 if not yet created).
+static int TimerFd = -1;
+
+/// true if the pattern has been handed over to the output hardware, so the sequencer is idle.
+static bool Offloaded = false;
+
+/// Number of steps whose ends have been handed over to the output as a batch of edges, starting
+/// with the step the player is at (0 if none).  The player stays at that step until the batch is
+/// taken back (see Unschedule()).
+static uint32_t ScheduledSteps = 0;
+
+/// false once the output has turned out not to be able to make edges by itself.
+static bool CanSchedule = true;
+
+/// Period of the cycle that the tone being played stands in for (0 if none), as last reported to
+/// the statistics.
+static uint64_t HeldPeriodNs = 0;
+
+/// The dedicated thread (NULL if the engine runs on the main thread).
+static le_thread_Ref_t Thread = NULL;
+
+/// The thread that started the engine, which finished patterns are reported to.
+static le_thread_Ref_t MainThread = NULL;
+
+/// Settings the dedicated thread starts with.
+static engine_Config_t Config;
+
+/// eventfd used to wake the engine thread when a snapshot is published.
+static int WakeFd = -1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Arms the timer to expire at an absolute CLOCK_MONOTONIC deadline.  If the deadline has already
+ * passed, the timer expires immediately.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ArmTimer
+(
+    uint64_t deadlineNs ///< CLOCK_MONOTONIC time (in nanoseconds) of the next edge.
+)
+{
+    struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+    spec.it_value.tv_sec = (time_t)(deadlineNs / NS_PER_SEC);
+    spec.it_value.tv_nsec = (long)(deadlineNs % NS_PER_SEC);
+
+    if (timerfd_settime(TimerFd, TFD_TIMER_ABSTIME, &spec, NULL) != 0)
+    {
+        LE_FATAL("Failed to arm edge timer (%m)");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Disarms the timer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DisarmTimer
+(
+    void
+)
+{
+    static const struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+    if (timerfd_settime(TimerFd, 0, &spec, NULL) != 0)
+    {
+        LE_FATAL("Failed to disarm edge timer (%m)");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tells the statistics whether a cycle is being held by a single tone, if that has changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetHeld
+(
+    uint64_t periodNs   ///< Period of the cycle (0 = none).
+)
+{
+    if (periodNs != HeldPeriodNs)
+    {
+        HeldPeriodNs = periodNs;
+        stats_RecordHold(periodNs);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the time at which the player's current step ends.  A silence in a pattern with slack is
+ * stretched first, so that the next tone starts on a multiple of the slack, and can share a
+ * wake-up with other timers.  Once stretched, the deadline is aligned, so this does nothing if it
+ * is called again for the same step.  The time limit is never moved.
+ *
+ * @return The deadline, or SEQ_NO_DEADLINE if the step never ends.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetDeadline
+(
+    seq_Player_t *playerPtr     ///< Player (must be playing).
+)
+{
+    uint64_t deadlineNs = seq_GetDeadline(playerPtr);
+    uint64_t slackNs = playerPtr->patternPtr->slackNs;
+
+    if ((slackNs != 0) && (deadlineNs < playerPtr->endNs) && (seq_GetFreq(playerPtr) == OFF_FREQ))
+    {
+        uint64_t alignedNs = ((deadlineNs + slackNs - 1) / slackNs) * slackNs;
+        if (alignedNs != deadlineNs)
+        {
+            seq_Stretch(playerPtr, alignedNs - deadlineNs);
+            deadlineNs = seq_GetDeadline(playerPtr);
+
+            // Only the player's own position is reported (not that of a copy working out the
+            // edges coming up).
+            if ((playerPtr == &Player) && (Config.stretchFunc != NULL))
+            {
+                seq_Position_t position;
+                seq_GetPosition(&Player, &position);
+                Config.stretchFunc(&position);
+            }
+        }
+    }
+
+    return deadlineNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands the edges coming up over to the output, if it can make them by itself (e.g., as a chain
+ * of timed writes in the kernel), so the engine only needs to wake up once for the whole batch,
+ * rather than for each edge.  The edges are worked out on a copy of the player, so the player
+ * stays at the step being played.
+ *
+ * The engine still makes the last edge of each batch itself, when it wakes up to hand over the
+ * next one.  The end of the pattern, and steps that never end, are always left to the engine.
+ *
+ * @return The time to wake up at: the end of the last step handed over, or deadlineNs if none
+ *         was.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ScheduleAhead
+(
+    uint64_t deadlineNs         ///< End of the step being played.
+)
+{
+    static backend_Edge_t edges[BACKEND_MAX_SCHEDULED];
+    static seq_Player_t ahead;
+    uint64_t wakeNs = deadlineNs;
+    uint32_t count = 0;
+
+    if (!CanSchedule || (Config.batchEdges < 2))
+    {
+        return deadlineNs;
+    }
+
+    ahead = Player;
+    while (((count + 1) < Config.batchEdges) && seq_Next(&ahead))
+    {
+        uint64_t nextNs = GetDeadline(&ahead);
+        if (nextNs == SEQ_NO_DEADLINE)
+        {
+            break;
+        }
+
+        edges[count].timeNs = wakeNs;
+        edges[count].freqHz = seq_GetFreq(&ahead);
+        count++;
+        wakeNs = nextNs;
+    }
+
+    if (count == 0)
+    {
+        return deadlineNs;
+    }
+
+    if (output_Schedule(edges, count) != LE_OK)
+    {
+        LE_INFO("Output can't make edges by itself.  Waking up for each one.");
+        CanSchedule = false;
+        return deadlineNs;
+    }
+
+    ScheduledSteps = count;
+
+    return wakeNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Takes back the batch of edges handed over to the output, if there is one, cancelling those that
+ * haven't been made yet.  The player is moved past the steps that have ended since, as they have
+ * been played (rather than missed).
+ */
+//--------------------------------------------------------------------------------------------------
+static void Unschedule
+(
+    void
+)
+{
+    if (ScheduledSteps == 0)
+    {
+        return;
+    }
+
+    stats_RecordScheduled(output_Unschedule());
+
+    uint64_t nowNs = backend_GetMonotonicNs();
+    while ((ScheduledSteps > 0) && (GetDeadline(&Player) <= nowNs))
+    {
+        // There is always a next step, or it wouldn't have been handed over.
+        bool hasNext = seq_Next(&Player);
+        LE_ASSERT(hasNext);
+        ScheduledSteps--;
+    }
+    ScheduledSteps = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing immediately, even in the middle of a step, and turns the output off.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Stop
+(
+    void
+)
+{
+    DisarmTimer();
+    seq_Stop(&Player);
+    PatternPtr = NULL;
+    Offloaded = false;
+    SetHeld(0);
+    output_Set(OFF_FREQ);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands the pattern over to the output hardware, if it is a simple on/off cycle that the hardware
+ * can produce, and stops sequencing it in software.  Cycles that are always on or always off are
+ * left to the sequencer, as they need no timer anyway.
+ *
+ * @return true if the hardware is now producing the pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Offload
+(
+    void
+)
+{
+    const pattern_Step_t *stepsPtr = PatternPtr->steps;
+
+    // The shape built by pattern_MakeDutyCycle(): on, off, loop back to the start forever, with
+    // no time limit.
+    bool isCycle = (PatternPtr->numSteps == 3) &&
+                   (PatternPtr->limitNs == PATTERN_DURATION_INFINITE) &&
+                   (stepsPtr[0].op == PATTERN_OP_TONE) && (stepsPtr[0].freqHz != 0) &&
+                   (stepsPtr[1].op == PATTERN_OP_TONE) && (stepsPtr[1].freqHz == 0) &&
+                   (stepsPtr[2].op == PATTERN_OP_LOOP) && (stepsPtr[2].loopStart == 0) &&
+                   (stepsPtr[2].loopCount == 0);
+
+    uint64_t onNs = stepsPtr[0].durationNs;
+    uint64_t offNs = stepsPtr[1].durationNs;
+
+    if (!isCycle || (onNs == 0) || (offNs == 0) ||
+        (onNs == PATTERN_DURATION_INFINITE) || (offNs == PATTERN_DURATION_INFINITE) ||
+        (output_SetCycle(onNs + offNs, onNs) != LE_OK))
+    {
+        Offloaded = false;
+        return false;
+    }
+
+    DisarmTimer();
+    seq_Stop(&Player);
+    Offloaded = true;
+    SetHeld(0);
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reports what is now being played to the checkpoint function, if there is one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Checkpoint
+(
+    void
+)
+{
+    if (Config.checkpointFunc == NULL)
+    {
+        return;
+    }
+
+    if (PatternPtr == NULL)
+    {
+        Config.checkpointFunc(PlayingSlot, NULL, NULL);
+    }
+    else
+    {
+        seq_Position_t position;
+        seq_GetPosition(&Player, &position);
+        Config.checkpointFunc(PlayingSlot, PatternPtr, &position);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main thread side of reporting a finished pattern.  Deferred function called with the slot and
+ * its generation.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FinishedDeferred
+(
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    uint8_t slot = (uint8_t)(uintptr_t)param1Ptr;
+    uint32_t generation = (uint32_t)(uintptr_t)param2Ptr;
+
+    // If the slot has been told to start again since, it didn't finish after all.
+    if ((Config.finishedFunc != NULL) && (Generations[slot] == generation))
+    {
+        Config.finishedFunc(slot);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing because the pattern has finished, and reports it to the main thread.  This is
+ * queued even if the engine is on the main thread, so the report never arrives in the middle of
+ * publishing a snapshot.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Finish
+(
+    void
+)
+{
+    Stop();
+
+    // Saved as stopped, so a restarted process doesn't play the end of the pattern again.
+    Checkpoint();
+    le_event_QueueFunctionToThread(MainThread, FinishedDeferred, (void *)(uintptr_t)PlayingSlot,
+                                   (void *)(uintptr_t)PlayingGeneration);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Brings the output up to date with the step of the pattern that should be playing now, and arms
+ * the timer for the end of that step.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunSequencer
+(
+    uint64_t nowNs  ///< Current CLOCK_MONOTONIC time.
+)
+{
+    // Deadlines are always relative to the start of the pattern, never to the current time,
+    // so the pattern does not drift no matter how late this runs.  Steps that have been missed
+    // entirely (e.g., because the system was suspended) are skipped rather than replayed.
+    if (!seq_CatchUp(&Player, nowNs))
+    {
+        Finish();
+        return;
+    }
+
+    output_Set(seq_GetFreq(&Player));
+    SetHeld(PatternPtr->heldPeriodNs);
+
+    // A step that is held until something changes (e.g., a duty cycle of 0% or 100%) needs no
+    // timer at all.
+    uint64_t deadlineNs = GetDeadline(&Player);
+    if (deadlineNs == SEQ_NO_DEADLINE)
+    {
+        DisarmTimer();
+    }
+    else
+    {
+        ArmTimer(ScheduleAhead(deadlineNs));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing the pattern from the beginning.  If the output is already on, it is left on
+ * rather than being turned off and on again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Start
+(
+    void
+)
+{
+    uint64_t nowNs = backend_GetMonotonicNs();
+
+    // The player is set up even if the pattern is handed over to the hardware, so that the
+    // position reported to the checkpoint function is the start of the pattern.
+    seq_Start(&Player, PatternPtr, nowNs);
+    if (!Offload())
+    {
+        RunSequencer(nowNs);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing the pattern from a saved position, skipping any steps that have ended since.  A
+ * cycle that is handed over to the hardware starts wherever the hardware starts it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Resume
+(
+    const seq_Position_t *positionPtr   ///< Position to carry on from.
+)
+{
+    if (!seq_Resume(&Player, PatternPtr, positionPtr))
+    {
+        LE_WARN("Saved position doesn't fit the pattern.  Starting from the beginning.");
+        Start();
+    }
+    else if (!Offload())
+    {
+        RunSequencer(backend_GetMonotonicNs());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records where the slot being played is, so it can carry on from there when it is played again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Pause
+(
+    uint16_t numSteps   ///< Number of steps in the pattern being played.
+)
+{
+    Paused_t *pausedPtr = &Paused[PlayingSlot];
+
+    pausedPtr->valid = true;
+    pausedPtr->finished = (PatternPtr == NULL);
+    pausedPtr->generation = PlayingGeneration;
+    pausedPtr->numSteps = numSteps;
+    pausedPtr->pausedAtNs = backend_GetMonotonicNs();
+    seq_GetPosition(&Player, &pausedPtr->position);
+
+    if (Config.pauseFunc != NULL)
+    {
+        Config.pauseFunc(PlayingSlot, PlayingGeneration,
+                         pausedPtr->finished ? NULL : &pausedPtr->position, pausedPtr->pausedAtNs);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing the pattern for a slot that has just taken over the output.  If the slot was
+ * paused, and hasn't been told to start again since, it carries on from where it was, as if no
+ * time had passed in between.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Switch
+(
+    const Snapshot_t *snapshotPtr   ///< Snapshot being applied.
+)
+{
+    Paused_t *pausedPtr = &Paused[snapshotPtr->slot];
+
+    if (snapshotPtr->resume)
+    {
+        Resume(&snapshotPtr->position);
+    }
+    else if (!pausedPtr->valid || (pausedPtr->generation != snapshotPtr->generation) ||
+             (pausedPtr->numSteps != snapshotPtr->pattern.numSteps))
+    {
+        Start();
+    }
+    else if (pausedPtr->finished)
+    {
+        Stop();
+    }
+    else
+    {
+        seq_ShiftPosition(&pausedPtr->position, backend_GetMonotonicNs() - pausedPtr->pausedAtNs);
+        Resume(&pausedPtr->position);
+    }
+
+    pausedPtr->valid = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Picks up the latest snapshot, if there is a new one, and brings the output in line with it.
+ * Engine side.
+ *
+ * @return false if the output has been closed.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Consume
+(
+    void
+)
+{
+    if ((__atomic_load_n(&SharedIndex, __ATOMIC_ACQUIRE) & SNAPSHOT_FRESH) == 0)
+    {
+        return true;
+    }
+
+    // Whatever the snapshot says, the engine needs the output (and the player) back first.
+    Unschedule();
+
+    // The buffer being played from is handed back, so nothing may look at it after this.
+    uint16_t playingNumSteps = (PatternPtr != NULL) ? PatternPtr->numSteps : 0;
+    ReadIndex = __atomic_exchange_n(&SharedIndex, ReadIndex, __ATOMIC_ACQ_REL) & ~SNAPSHOT_FRESH;
+    const Snapshot_t *snapshotPtr = &Snapshots[ReadIndex];
+
+    uint64_t writeCount = output_GetStats()->writeCount;
+
+    LE_DEBUG("Applying snapshot %" PRIu32, snapshotPtr->version);
+
+    if (snapshotPtr->closing)
+    {
+        DisarmTimer();
+        seq_Stop(&Player);
+        SetHeld(0);
+        output_Close();
+        return false;
+    }
+
+    if (!snapshotPtr->playing)
+    {
+        Stop();
+        PlayingSlot = NO_SLOT;
+    }
+    else if (snapshotPtr->slot != PlayingSlot)
+    {
+        // Another slot takes over the output.  The one that was playing (if any) is paused.
+        if (PlayingSlot != NO_SLOT)
+        {
+            Pause(playingNumSteps);
+        }
+        PlayingSlot = snapshotPtr->slot;
+        PlayingGeneration = snapshotPtr->generation;
+        PatternPtr = &snapshotPtr->pattern;
+        Switch(snapshotPtr);
+    }
+    else if ((PatternPtr == NULL) && (snapshotPtr->generation == PlayingGeneration))
+    {
+        // The slot's pattern has finished, and it hasn't been told to start again, so the output
+        // stays off.
+    }
+    else if ((snapshotPtr->generation != PlayingGeneration) || Offloaded ||
+             !seq_IsPlaying(&Player) || (snapshotPtr->pattern.numSteps != playingNumSteps))
+    {
+        // Start from the beginning.  If the pattern was handed over to the hardware, this
+        // reprograms it, or goes back to the sequencer if it can't produce the new pattern.
+        PlayingGeneration = snapshotPtr->generation;
+        PatternPtr = &snapshotPtr->pattern;
+        if (snapshotPtr->resume)
+        {
+            Resume(&snapshotPtr->position);
+        }
+        else
+        {
+            Start();
+        }
+    }
+    else
+    {
+        // Same shape, so the sequencer carries on from the same position with the new durations,
+        // starting with the step that is currently playing.  Try handing it over to the hardware
+        // first, though.
+        PatternPtr = &snapshotPtr->pattern;
+        seq_ReplacePattern(&Player, PatternPtr);
+        if (!Offload())
+        {
+            RunSequencer(backend_GetMonotonicNs());
+        }
+    }
+
+    Checkpoint();
+
+    stats_RecordApply(output_GetStats()->writeCount - writeCount);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publishes a new snapshot to the engine.  Main thread side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Publish
+(
+    uint8_t slot,                       ///< Slot the pattern is played for.
+    const pattern_Pattern_t *patternPtr,///< Pattern to play (NULL = turn the output off).
+    const seq_Position_t *positionPtr,  ///< Position to resume playing from (NULL = the start).
+    bool closing                        ///< Close the output.
+)
+{
+    Snapshot_t *snapshotPtr = &Snapshots[WriteIndex];
+
+    snapshotPtr->version = ++Version;
+    snapshotPtr->slot = slot;
+    snapshotPtr->generation = (slot != NO_SLOT) ? Generations[slot] : 0;
+    snapshotPtr->playing = (patternPtr != NULL);
+    snapshotPtr->closing = closing;
+    snapshotPtr->resume = (positionPtr != NULL);
+    if (positionPtr != NULL)
+    {
+        snapshotPtr->position = *positionPtr;
+    }
+    if (patternPtr != NULL)
+    {
+        snapshotPtr->pattern = *patternPtr;
+    }
+
+    // If the engine hasn't picked up the previous snapshot yet, it never will: this one replaces
+    // it, and its buffer comes back to be written next time.
+    WriteIndex = __atomic_exchange_n(&SharedIndex, WriteIndex | SNAPSHOT_FRESH, __ATOMIC_ACQ_REL) &
+                 ~SNAPSHOT_FRESH;
+
+    if (Thread == NULL)
+    {
+        Consume();
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(WakeFd, &one, sizeof(one)) != sizeof(one))
+    {
+        LE_FATAL("Failed to wake edge thread (%m)");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler function.  Called by the event loop when the timerfd becomes readable.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimerExpiryHandler
+(
+    int fd,         ///< The timerfd.
+    short events    ///< Bitmap of poll events that occurred.
+)
+{
+    // Consume the expiry count so the fd stops being readable.  The timer may have been re-armed
+    // or disarmed since it expired, in which case there is nothing to read and nothing to do.
+    uint64_t expiryCount;
+    if (read(fd, &expiryCount, sizeof(expiryCount)) != sizeof(expiryCount))
+    {
+        return;
+    }
+
+    if (seq_IsPlaying(&Player))
+    {
+        // The edges handed over to the output since the engine last woke up have all been made.
+        Unschedule();
+
+        uint64_t deadlineNs = seq_GetDeadline(&Player);
+        uint64_t missedCount = Player.missedCount;
+        uint64_t writeTimeNs = output_GetStats()->writeTimeNs;
+        uint64_t nowNs = backend_GetMonotonicNs();
+
+        RunSequencer(nowNs);
+
+        stats_RecordEdge((nowNs > deadlineNs) ? (nowNs - deadlineNs) : 0,
+                         output_GetStats()->writeTimeNs - writeTimeNs,
+                         (uint32_t)(Player.missedCount - missedCount));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wake-up handler function.  Called by the engine thread's event loop when a snapshot has been
+ * published.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WakeHandler
+(
+    int fd,         ///< The eventfd.
+    short events    ///< Bitmap of poll events that occurred.
+)
+{
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+    {
+        return;
+    }
+
+    if (!Consume())
+    {
+        le_thread_Exit(NULL);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets up the timer and output read-back in the calling thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartTimer
+(
+    void
+)
+{
+    TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (TimerFd == -1)
+    {
+        LE_FATAL("Failed to create edge timer (%m)");
+    }
+    le_fdMonitor_Create("Buzzer Timer", TimerFd, TimerExpiryHandler, POLLIN);
+
+    output_StartReadBack(Config.readBackMs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of the dedicated engine thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void *ThreadMain
+(
+    void *contextPtr
+)
+{
+    if (Config.cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(Config.cpu, &cpuSet);
+        if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+        {
+            LE_WARN("Failed to pin edge thread to CPU %d (%m)", Config.cpu);
+        }
+    }
+
+    StartTimer();
+    le_fdMonitor_Create("Buzzer Wake", WakeFd, WakeHandler, POLLIN);
+
+    le_event_RunLoop();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts the engine.  The output must already be open.  All the other functions must be called
+ * from the thread that called this one.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Init
+(
+    const engine_Config_t *configPtr    ///< Settings.
+)
+{
+    Config = *configPtr;
+    MainThread = le_thread_GetCurrent();
+
+    if (!Config.ownThread)
+    {
+        StartTimer();
+        return;
+    }
+
+    WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (WakeFd == -1)
+    {
+        LE_FATAL("Failed to create edge thread wake-up (%m)");
+    }
+
+    Thread = le_thread_Create("BuzzerEdges", ThreadMain, NULL);
+    le_thread_SetJoinable(Thread);
+
+    if (Config.rtPriority > 0)
+    {
+        le_thread_Priority_t priority = LE_THREAD_PRIORITY_RT_1 + (Config.rtPriority - 1);
+        if (le_thread_SetPriority(Thread, priority) != LE_OK)
+        {
+            LE_WARN("Failed to set edge thread real-time priority %" PRIu32, Config.rtPriority);
+        }
+    }
+
+    le_thread_Start(Thread);
+
+    LE_INFO("Edges are handled by a dedicated thread (priority %" PRIu32 ", CPU %d)",
+            Config.rtPriority, Config.cpu);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern from the beginning.  The pattern is copied, so it can be changed or
+ * freed as soon as this returns.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Play
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+)
+{
+    engine_Forget(slot);
+    Publish(slot, patternPtr, NULL, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern from a position reported to the checkpoint function, catching up with
+ * the current time.  If the position isn't valid for the pattern, the pattern is started from the
+ * beginning instead.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Resume
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+)
+{
+    engine_Forget(slot);
+    Publish(slot, patternPtr, positionPtr, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern, carrying on from where the slot was, if possible:
+ *
+ *  - If the slot is being played, the pattern replaces the one being played, carrying on from the
+ *    same position (e.g., a duty cycle with new on and off times).
+ *  - If another slot is being played, that slot is paused, and this slot carries on from where it
+ *    was paused.
+ *
+ * In either case, the pattern must have the same shape as the slot's previous one, and the slot
+ * must not have been forgotten since.  Otherwise, the pattern is started from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Update
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+)
+{
+    Publish(slot, patternPtr, NULL, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Forgets where a slot was, so that the next time it is played, it starts from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Forget
+(
+    uint8_t slot                            ///< Slot (less than ENGINE_MAX_SLOTS).
+)
+{
+    LE_ASSERT(slot < ENGINE_MAX_SLOTS);
+    Generations[slot]++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a slot's generation, which changes each time the slot is forgotten (see engine_Forget()).
+ * A position reported to the pause function for the same generation is still where the slot
+ * would carry on from.
+ *
+ * @return The generation.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t engine_GetGeneration
+(
+    uint8_t slot                            ///< Slot (less than ENGINE_MAX_SLOTS).
+)
+{
+    LE_ASSERT(slot < ENGINE_MAX_SLOTS);
+    return Generations[slot];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing, and turns the output off.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Stop
+(
+    void
+)
+{
+    Publish(NO_SLOT, NULL, NULL, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing, and closes the output (leaving it off).  Returns once the output is closed.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Close
+(
+    void
+)
+{
+    Publish(NO_SLOT, NULL, NULL, true);
+
+    if (Thread != NULL)
+    {
+        le_thread_Join(Thread, NULL);
+        Thread = NULL;
+    }
+}
@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file engine.h
+ *
+ * The edge engine: plays patterns on the output, on time.
+ *
+ * Patterns are played by the sequencer (see sequencer.h).  A timerfd is armed with the absolute
+ * CLOCK_MONOTONIC deadline of each step, so handler latency and rounding never accumulate into
+ * drift.  If the output backend can repeat an on/off cycle by itself (e.g., a PWM channel), such
+ * cycles are handed over to the hardware instead, and the timer stays idle.
+ *
+ * If the output backend can make changes by itself at given times (e.g., as timed writes made by
+ * the kernel), the engine looks ahead in the pattern and hands the edges coming up over to it in
+ * batches.  It then only wakes up once per batch, to hand over the next one, so the edges aren't
+ * held up by the event loop, and the CPU is woken up far less often.  The batch is taken back
+ * (cancelling the edges that haven't been made) whenever anything changes.
+ *
+ * By default, the engine runs on the main thread's event loop, alongside everything else.  It
+ * can instead run on a dedicated thread (optionally with a real-time priority, and pinned to a
+ * CPU), so the edges aren't held up by Data Hub traffic or other handlers.  Once the engine is
+ * started, that thread is the only one that touches the timer and the output.
+ *
+ * Either way, each call publishes a complete snapshot of what the engine should be doing
+ * (including its own copy of the pattern) by swapping it in atomically, and the engine only ever
+ * acts on the latest one.  So the engine never sees a half-made change (e.g., a new period with
+ * the old percentage), neither side ever waits for the other, and nothing is allocated.
+ *
+ * Patterns are played for numbered slots (e.g., one per app that wants to sound the buzzer), one
+ * slot at a time.  When a slot takes over the output, the slot that was playing is paused, and
+ * when that slot is played again, it carries on from where it was paused.  Which slot to play is
+ * decided by the caller (see arbiter.h).
+ *
+ * Each time the engine applies a snapshot, it can report what it is now playing, and from where,
+ * so that playing can be resumed at the same point if the process is restarted.
+ *
+ * When a slot's pattern comes to its end (or its time limit), the output is turned off, and the
+ * engine reports it on the thread that started the engine, so the caller can move on (e.g., play
+ * another slot).  The slot stays finished until it is forgotten.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ENGINE_H_INCLUDE_GUARD
+#define ENGINE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pattern.h"
+#include "sequencer.h"
+
+/// Number of slots patterns can be played for.
+#define ENGINE_MAX_SLOTS 8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on its own thread) each time it has applied a snapshot, with
+ * the pattern it is now playing and the position it is playing it from.  The pattern and position
+ * are only valid during the call.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*engine_CheckpointFunc_t)
+(
+    uint8_t slot,                           ///< Slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on its own thread) when the slot it was playing is paused,
+ * because another slot has taken over the output, with where the slot was paused.  The position
+ * is only valid during the call.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*engine_PauseFunc_t)
+(
+    uint8_t slot,                           ///< Slot paused.
+    uint32_t generation,                    ///< Slot's generation (see engine_GetGeneration()).
+    const seq_Position_t *positionPtr,      ///< Position in the pattern (NULL if it had
+                                            ///  finished).
+    uint64_t pausedAtNs                     ///< Time at which it was paused.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on its own thread) each time it stretches a silence, so that
+ * the next tone lines up with the pattern's slack, with the position it is now playing from.  The
+ * steps after the silence all start later, so carrying on from the position last reported to the
+ * checkpoint function would put the pattern out of phase.  The position is only valid during the
+ * call.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*engine_StretchFunc_t)
+(
+    const seq_Position_t *positionPtr       ///< Position in the pattern being played.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called by the engine (on the thread that called engine_Init()) when a slot's pattern
+ * has finished.  Not called if the slot has been forgotten since.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*engine_FinishedFunc_t)
+(
+    uint8_t slot                            ///< Slot whose pattern has finished.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine settings.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool ownThread;             ///< Run on a dedicated thread, rather than the main thread.
+    uint32_t rtPriority;        ///< Dedicated thread's real-time priority (1 to 32, 0 = normal).
+    int cpu;                    ///< CPU to pin the dedicated thread to (-1 = any).
+    uint32_t readBackMs;        ///< Interval between output read-backs (0 = never).
+    uint32_t batchEdges;        ///< Edges per wake-up, if the output can make edges by itself
+                                ///  (at most BACKEND_MAX_SCHEDULED + 1, 0 or 1 = one).
+    engine_CheckpointFunc_t checkpointFunc; ///< Function to report what is playing (or NULL).
+    engine_PauseFunc_t pauseFunc;           ///< Function to report paused slots (or NULL).
+    engine_StretchFunc_t stretchFunc;       ///< Function to report stretched silences (or NULL).
+    engine_FinishedFunc_t finishedFunc;     ///< Function to report finished patterns (or NULL).
+}
+engine_Config_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts the engine.  The output must already be open.  All the other functions must be called
+ * from the thread that called this one.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Init
+(
+    const engine_Config_t *configPtr    ///< Settings.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern from the beginning.  The pattern is copied, so it can be changed or
+ * freed as soon as this returns.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Play
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern from a position reported to the checkpoint function, catching up with
+ * the current time.  If the position isn't valid for the pattern, the pattern is started from the
+ * beginning instead.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Resume
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Plays a slot's pattern, carrying on from where the slot was, if possible:
+ *
+ *  - If the slot is being played, the pattern replaces the one being played, carrying on from the
+ *    same position (e.g., a duty cycle with new on and off times).
+ *  - If another slot is being played, that slot is paused, and this slot carries on from where it
+ *    was paused.
+ *
+ * In either case, the pattern must have the same shape as the slot's previous one, and the slot
+ * must not have been forgotten since.  Otherwise, the pattern is started from the beginning.  If
+ * the slot's pattern has finished, it stays finished (the output is left off).
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Update
+(
+    uint8_t slot,                           ///< Slot (less than ENGINE_MAX_SLOTS).
+    const pattern_Pattern_t *patternPtr     ///< Pattern (must have been finished).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Forgets where a slot was, so that the next time it is played, it starts from the beginning.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Forget
+(
+    uint8_t slot                            ///< Slot (less than ENGINE_MAX_SLOTS).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a slot's generation, which changes each time the slot is forgotten (see engine_Forget()).
+ * A position reported to the pause function for the same generation is still where the slot
+ * would carry on from.
+ *
+ * @return The generation.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t engine_GetGeneration
+(
+    uint8_t slot                            ///< Slot (less than ENGINE_MAX_SLOTS).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing, and turns the output off.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Stop
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops playing, and closes the output (leaving it off).  Returns once the output is closed.
+ */
+//--------------------------------------------------------------------------------------------------
+void engine_Close
+(
+    void
+);
+
+#endif // ENGINE_H_INCLUDE_GUARD
@@ -0,0 +1,431 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Buzzer output.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "output.h"
+#include "stats.h"
+
+/// The backend in use.
+static const backend_Ops_t *BackendPtr = NULL;
+
+/// Shadow register: the frequency last written to (or read from) the hardware.
+static uint32_t ShadowFreqHz = BACKEND_FREQ_UNKNOWN;
+
+/// Traffic counters.
+static output_Stats_t Stats;
+
+/// Frequencies of the changes scheduled (see output_Schedule()), and how many there are.
+static uint32_t ScheduledFreqs[BACKEND_MAX_SCHEDULED];
+static size_t ScheduledCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Converts a frequency to what the backend will actually output.  Backends that can only switch
+ * the buzzer on and off output 1 for any non-zero frequency.
+ *
+ * @return The frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t Normalize
+(
+    uint32_t freqHz
+)
+{
+    if ((BackendPtr->caps.numFreqs == 0) && (freqHz != 0) && (freqHz != BACKEND_FREQ_UNKNOWN))
+    {
+        return 1;
+    }
+
+    return freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Writes a frequency to the hardware, bypassing the shadow register.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Write
+(
+    uint32_t freqHz
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    BackendPtr->set(freqHz);
+
+    ShadowFreqHz = freqHz;
+    Stats.writeCount++;
+    Stats.writeTimeNs += backend_GetMonotonicNs() - startNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read-back timer expiry handler function.  Checks that the hardware still matches the shadow
+ * register, and corrects it if not.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadBackTimerExpiryHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    // While changes are scheduled, the hardware is meant to change behind our back.
+    if (ScheduledCount > 0)
+    {
+        return;
+    }
+
+    uint32_t freqHz = BackendPtr->get();
+    Stats.readBackCount++;
+
+    // If nothing has been written yet, there is nothing to check against.
+    if ((freqHz != ShadowFreqHz) &&
+        (freqHz != BACKEND_FREQ_UNKNOWN) && (ShadowFreqHz != BACKEND_FREQ_UNKNOWN))
+    {
+        Stats.mismatchCount++;
+        stats_RecordMismatch();
+        LE_WARN("Output is %" PRIu32 " Hz, expected %" PRIu32 " Hz", freqHz, ShadowFreqHz);
+
+        Write(ShadowFreqHz);
+    }
+
+    LE_DEBUG("Output writes: %" PRIu64 " (%" PRIu64 " ns), skipped: %" PRIu64
+             ", mismatches: %" PRIu64 "/%" PRIu64,
+             Stats.writeCount, Stats.writeTimeNs, Stats.skipCount,
+             Stats.mismatchCount, Stats.readBackCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens an output backend, and loads the shadow register with what the hardware is outputting.
+ *
+ * If the backend can't be opened, the RTC CLKOUT sysfs backend is used instead.
+ *
+ * @note Exits the process if no backend can be opened.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Open
+(
+    const char *backendNamePtr  ///< Name of the backend (NULL = RTC CLKOUT through sysfs).
+)
+{
+    BackendPtr = &backend_ClkoutSysfs;
+    if (backendNamePtr != NULL)
+    {
+        BackendPtr = backend_Find(backendNamePtr);
+        if (BackendPtr == NULL)
+        {
+            LE_ERROR("Unknown output backend '%s'", backendNamePtr);
+            BackendPtr = &backend_ClkoutSysfs;
+        }
+    }
+
+    if (BackendPtr->open() != LE_OK)
+    {
+        if (BackendPtr == &backend_ClkoutSysfs)
+        {
+            LE_FATAL("Failed to open '%s' output backend", BackendPtr->namePtr);
+        }
+
+        LE_WARN("Failed to open '%s' output backend, falling back to '%s'",
+                BackendPtr->namePtr, backend_ClkoutSysfs.namePtr);
+
+        BackendPtr = &backend_ClkoutSysfs;
+        LE_FATAL_IF(BackendPtr->open() != LE_OK,
+                    "Failed to open '%s' output backend", BackendPtr->namePtr);
+    }
+
+    LE_INFO("Using '%s' output backend", BackendPtr->namePtr);
+
+    // If the output can't be read, or isn't something we would ever write, the shadow register
+    // doesn't match anything and the first write will go through.
+    ShadowFreqHz = BACKEND_FREQ_UNKNOWN;
+    if (BackendPtr->get != NULL)
+    {
+        uint32_t freqHz = BackendPtr->get();
+        if (output_IsSupported(freqHz))
+        {
+            ShadowFreqHz = Normalize(freqHz);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts periodically reading the hardware back, and correcting it if it doesn't match the shadow
+ * register.  The read-backs are done by the calling thread, which must be the one that uses the
+ * output from then on.  Does nothing if the backend can't be read back.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_StartReadBack
+(
+    uint32_t readBackMs         ///< Interval between read-backs of the hardware (0 = never).
+)
+{
+    if ((readBackMs > 0) && (BackendPtr->get != NULL))
+    {
+        le_timer_Ref_t timer = le_timer_Create("Output Read-back");
+        le_timer_SetMsInterval(timer, readBackMs);
+        le_timer_SetRepeat(timer, 0 /* number of iterations, where 0 = infinity */);
+        le_timer_SetHandler(timer, ReadBackTimerExpiryHandler);
+        le_timer_Start(timer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the capabilities of the backend in use.
+ */
+//--------------------------------------------------------------------------------------------------
+const backend_Caps_t *output_GetCaps
+(
+    void
+)
+{
+    return &BackendPtr->caps;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether the backend can output a given frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+bool output_IsSupported
+(
+    uint32_t freqHz             ///< Frequency.
+)
+{
+    const backend_Caps_t *capsPtr = &BackendPtr->caps;
+
+    if (freqHz == BACKEND_FREQ_UNKNOWN)
+    {
+        return false;
+    }
+    if ((freqHz == 0) || (capsPtr->numFreqs == 0))
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < capsPtr->numFreqs; i++)
+    {
+        if (capsPtr->freqsPtr[i] == freqHz)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds the supported frequency nearest to a requested one.  Backends that can only switch the
+ * buzzer on and off accept any frequency, so it is returned unchanged.
+ *
+ * @return The frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t output_GetNearestFreq
+(
+    uint32_t freqHz             ///< Requested frequency (> 0).
+)
+{
+    const backend_Caps_t *capsPtr = &BackendPtr->caps;
+
+    if (capsPtr->numFreqs == 0)
+    {
+        return freqHz;
+    }
+
+    // The table is sorted, so stop at the first frequency that is at least the one requested
+    // (or the highest), and pick whichever of it and the one below is closer.
+    size_t i = 0;
+    while ((i < capsPtr->numFreqs - 1) && (capsPtr->freqsPtr[i] < freqHz))
+    {
+        i++;
+    }
+    if ((i > 0) && (capsPtr->freqsPtr[i] > freqHz) &&
+        ((freqHz - capsPtr->freqsPtr[i - 1]) < (capsPtr->freqsPtr[i] - freqHz)))
+    {
+        i--;
+    }
+
+    return capsPtr->freqsPtr[i];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the output frequency, unless it is already set to that frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Set
+(
+    uint32_t freqHz             ///< Frequency (0 = off).  Must be supported.
+)
+{
+    freqHz = Normalize(freqHz);
+
+    if (freqHz == ShadowFreqHz)
+    {
+        Stats.skipCount++;
+        stats_RecordSkip((Stats.writeCount > 0) ? (Stats.writeTimeNs / Stats.writeCount) : 0);
+        return;
+    }
+
+    Write(freqHz);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands an on/off cycle over to the hardware, if the backend can repeat it by itself.  The cycle
+ * runs until the next call to output_Set().
+ *
+ * @return
+ *  - LE_OK if the hardware is now producing the cycle.
+ *  - LE_NOT_IMPLEMENTED if the backend can't produce cycles.
+ *  - LE_OUT_OF_RANGE if the backend can't produce this cycle.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t output_SetCycle
+(
+    uint64_t periodNs,          ///< Length of the whole cycle.
+    uint64_t onNs               ///< Length of the on part of the cycle.
+)
+{
+    if (BackendPtr->setCycle == NULL)
+    {
+        return LE_NOT_IMPLEMENTED;
+    }
+
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    le_result_t result = BackendPtr->setCycle(periodNs, onNs);
+
+    // The output isn't a single frequency any more (or is unknown, if that failed), so the next
+    // call to output_Set() must go through to the hardware.
+    ShadowFreqHz = BACKEND_FREQ_UNKNOWN;
+    Stats.writeCount++;
+    Stats.writeTimeNs += backend_GetMonotonicNs() - startNs;
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands a batch of changes over to the backend, to make by itself at their times.  Changes that
+ * wouldn't change anything are left out.
+ *
+ * @return
+ *  - LE_OK if the changes are scheduled.  output_Unschedule() must be called before anything else
+ *    is done with the output.
+ *  - LE_NOT_IMPLEMENTED if the backend can't schedule changes.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t output_Schedule
+(
+    const backend_Edge_t *edgesPtr, ///< Changes, in time order.
+    size_t numEdges                 ///< Number of changes (at most BACKEND_MAX_SCHEDULED).
+)
+{
+    backend_Edge_t edges[BACKEND_MAX_SCHEDULED];
+    uint32_t freqHz = ShadowFreqHz;
+    size_t count = 0;
+
+    LE_ASSERT((ScheduledCount == 0) && (numEdges <= BACKEND_MAX_SCHEDULED));
+
+    if (BackendPtr->schedule == NULL)
+    {
+        return LE_NOT_IMPLEMENTED;
+    }
+
+    for (size_t i = 0; i < numEdges; i++)
+    {
+        uint32_t nextFreqHz = Normalize(edgesPtr[i].freqHz);
+        if (nextFreqHz != freqHz)
+        {
+            edges[count].timeNs = edgesPtr[i].timeNs;
+            edges[count].freqHz = nextFreqHz;
+            ScheduledFreqs[count] = nextFreqHz;
+            count++;
+            freqHz = nextFreqHz;
+        }
+    }
+
+    if (count == 0)
+    {
+        return LE_OK;
+    }
+
+    uint64_t startNs = backend_GetMonotonicNs();
+
+    le_result_t result = BackendPtr->schedule(edges, count);
+    if (result == LE_OK)
+    {
+        ScheduledCount = count;
+    }
+
+    Stats.writeTimeNs += backend_GetMonotonicNs() - startNs;
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancels the scheduled changes that haven't been made yet, waiting for any that are being made.
+ * Does nothing if nothing is scheduled.
+ *
+ * @return The number of changes that were made.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t output_Unschedule
+(
+    void
+)
+{
+    if (ScheduledCount == 0)
+    {
+        return 0;
+    }
+
+    size_t madeCount = BackendPtr->unschedule();
+    if (madeCount > 0)
+    {
+        ShadowFreqHz = ScheduledFreqs[madeCount - 1];
+        Stats.writeCount += madeCount;
+    }
+    ScheduledCount = 0;
+
+    return madeCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the output off and closes the backend.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Close
+(
+    void
+)
+{
+    BackendPtr->close();
+    ShadowFreqHz = BACKEND_FREQ_UNKNOWN;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the traffic counters.
+ */
+//--------------------------------------------------------------------------------------------------
+const output_Stats_t *output_GetStats
+(
+    void
+)
+{
+    return &Stats;
+}
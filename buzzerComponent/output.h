@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file output.h
+ *
+ * Buzzer output.  Drives the selected output backend (see backend.h).
+ *
+ * The last frequency written is kept in a shadow register, so writes that would not change
+ * anything never reach the hardware.  Optionally, the shadow register is periodically checked
+ * against the hardware, in case something else has changed it.
+ *
+ * If the backend can make changes by itself at given times, a batch of them can be scheduled.
+ * Nothing else may be done with the output until the batch is unscheduled, which brings the
+ * shadow register up to date with the changes that were made.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef OUTPUT_H_INCLUDE_GUARD
+#define OUTPUT_H_INCLUDE_GUARD
+
+#include "backend.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counters of the traffic to the hardware.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t writeCount;        ///< Number of writes that reached the hardware.
+    uint64_t skipCount;         ///< Number of writes skipped because they would change nothing.
+    uint64_t writeTimeNs;       ///< Total time spent writing to the hardware.
+    uint64_t readBackCount;     ///< Number of times the hardware was read back.
+    uint64_t mismatchCount;     ///< Number of read-backs that didn't match the shadow register.
+}
+output_Stats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens an output backend, and loads the shadow register with what the hardware is outputting.
+ *
+ * If the backend can't be opened, the RTC CLKOUT sysfs backend is used instead.
+ *
+ * @note Exits the process if no backend can be opened.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Open
+(
+    const char *backendNamePtr  ///< Name of the backend (NULL = RTC CLKOUT through sysfs).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts periodically reading the hardware back, and correcting it if it doesn't match the shadow
+ * register.  The read-backs are done by the calling thread, which must be the one that uses the
+ * output from then on.  Does nothing if the backend can't be read back.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_StartReadBack
+(
+    uint32_t readBackMs         ///< Interval between read-backs of the hardware (0 = never).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the capabilities of the backend in use.
+ */
+//--------------------------------------------------------------------------------------------------
+const backend_Caps_t *output_GetCaps
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether the backend can output a given frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+bool output_IsSupported
+(
+    uint32_t freqHz             ///< Frequency.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds the supported frequency nearest to a requested one.  Backends that can only switch the
+ * buzzer on and off accept any frequency, so it is returned unchanged.
+ *
+ * @return The frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t output_GetNearestFreq
+(
+    uint32_t freqHz             ///< Requested frequency (> 0).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the output frequency, unless it is already set to that frequency.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Set
+(
+    uint32_t freqHz             ///< Frequency (0 = off).  Must be supported.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands an on/off cycle over to the hardware, if the backend can repeat it by itself.  The cycle
+ * runs until the next call to output_Set().
+ *
+ * @return
+ *  - LE_OK if the hardware is now producing the cycle.
+ *  - LE_NOT_IMPLEMENTED if the backend can't produce cycles.
+ *  - LE_OUT_OF_RANGE if the backend can't produce this cycle.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t output_SetCycle
+(
+    uint64_t periodNs,          ///< Length of the whole cycle.
+    uint64_t onNs               ///< Length of the on part of the cycle.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands a batch of changes over to the backend, to make by itself at their times.  Changes that
+ * wouldn't change anything are left out.
+ *
+ * @return
+ *  - LE_OK if the changes are scheduled.  output_Unschedule() must be called before anything else
+ *    is done with the output.
+ *  - LE_NOT_IMPLEMENTED if the backend can't schedule changes.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t output_Schedule
+(
+    const backend_Edge_t *edgesPtr, ///< Changes, in time order.
+    size_t numEdges                 ///< Number of changes (at most BACKEND_MAX_SCHEDULED).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancels the scheduled changes that haven't been made yet, waiting for any that are being made.
+ * Does nothing if nothing is scheduled.
+ *
+ * @return The number of changes that were made.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t output_Unschedule
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the output off and closes the backend.
+ */
+//--------------------------------------------------------------------------------------------------
+void output_Close
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the traffic counters.
+ */
+//--------------------------------------------------------------------------------------------------
+const output_Stats_t *output_GetStats
+(
+    void
+);
+
+#endif // OUTPUT_H_INCLUDE_GUARD
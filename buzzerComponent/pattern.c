@@ -0,0 +1,309 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Building of compiled buzzer patterns.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pattern.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the first error encountered while building a pattern.
+ *
+ * @return The error code passed in.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Fail
+(
+    pattern_Builder_t *builderPtr,
+    le_result_t result
+)
+{
+    if (builderPtr->result == LE_OK)
+    {
+        builderPtr->result = result;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts building a new pattern, discarding anything previously stored in it.
+ */
+//--------------------------------------------------------------------------------------------------
+void pattern_InitBuilder
+(
+    pattern_Builder_t *builderPtr,  ///< Builder to initialize.
+    pattern_Pattern_t *patternPtr   ///< Pattern to build into.
+)
+{
+    builderPtr->patternPtr = patternPtr;
+    builderPtr->depth = 0;
+    builderPtr->result = LE_OK;
+
+    patternPtr->numSteps = 0;
+    patternPtr->limitNs = PATTERN_DURATION_INFINITE;
+    patternPtr->slackNs = 0;
+    patternPtr->heldPeriodNs = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Appends a tone step to the pattern being built.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the pattern is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_AddTone
+(
+    pattern_Builder_t *builderPtr,  ///< Builder.
+    uint32_t freqHz,                ///< Frequency to output (0 = silent).
+    uint64_t durationNs             ///< Duration, or PATTERN_DURATION_INFINITE.
+)
+{
+    pattern_Pattern_t *patternPtr = builderPtr->patternPtr;
+
+    if (patternPtr->numSteps >= PATTERN_MAX_STEPS)
+    {
+        return Fail(builderPtr, LE_OVERFLOW);
+    }
+
+    pattern_Step_t *stepPtr = &patternPtr->steps[patternPtr->numSteps++];
+    stepPtr->op = PATTERN_OP_TONE;
+    stepPtr->freqHz = freqHz;
+    stepPtr->durationNs = durationNs;
+    stepPtr->loopStart = 0;
+    stepPtr->loopCount = 0;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens a loop.  Steps added until the matching pattern_EndLoop() form the loop body.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if loops are nested too deeply.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_BeginLoop
+(
+    pattern_Builder_t *builderPtr   ///< Builder.
+)
+{
+    if (builderPtr->depth >= PATTERN_MAX_LOOP_DEPTH)
+    {
+        return Fail(builderPtr, LE_OVERFLOW);
+    }
+
+    builderPtr->loopStarts[builderPtr->depth++] = builderPtr->patternPtr->numSteps;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the innermost open loop.  A loop that is only played once is just its body, so no loop
+ * step is added for it.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the pattern is full.
+ *  - LE_FORMAT_ERROR if no loop is open, or the loop body is empty or takes no time to play.
+ *  - LE_OUT_OF_RANGE if the count is too large.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_EndLoop
+(
+    pattern_Builder_t *builderPtr,  ///< Builder.
+    uint32_t count                  ///< Number of times to play the loop body (0 = forever).
+)
+{
+    pattern_Pattern_t *patternPtr = builderPtr->patternPtr;
+
+    if (builderPtr->depth == 0)
+    {
+        return Fail(builderPtr, LE_FORMAT_ERROR);
+    }
+    if (count > PATTERN_MAX_LOOP_COUNT)
+    {
+        return Fail(builderPtr, LE_OUT_OF_RANGE);
+    }
+
+    uint16_t start = builderPtr->loopStarts[--builderPtr->depth];
+
+    if (count == 1)
+    {
+        return LE_OK;
+    }
+    if (patternPtr->numSteps >= PATTERN_MAX_STEPS)
+    {
+        return Fail(builderPtr, LE_OVERFLOW);
+    }
+
+    // A loop body that takes no time to play would spin the sequencer without ever giving the
+    // event loop a chance to run.
+    bool hasDuration = false;
+    for (uint16_t i = start; i < patternPtr->numSteps; i++)
+    {
+        if ((patternPtr->steps[i].op == PATTERN_OP_TONE) && (patternPtr->steps[i].durationNs > 0))
+        {
+            hasDuration = true;
+            break;
+        }
+    }
+    if (!hasDuration)
+    {
+        return Fail(builderPtr, LE_FORMAT_ERROR);
+    }
+
+    pattern_Step_t *stepPtr = &patternPtr->steps[patternPtr->numSteps++];
+    stepPtr->op = PATTERN_OP_LOOP;
+    stepPtr->freqHz = 0;
+    stepPtr->durationNs = 0;
+    stepPtr->loopStart = start;
+    stepPtr->loopCount = (uint16_t)count;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finishes building a pattern.
+ *
+ * @return
+ *  - LE_OK if the pattern is ready to be played.
+ *  - LE_FORMAT_ERROR if the pattern is empty or a loop was left open.
+ *  - Otherwise, the first error returned while building the pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_Finish
+(
+    pattern_Builder_t *builderPtr   ///< Builder.
+)
+{
+    if (builderPtr->result != LE_OK)
+    {
+        return builderPtr->result;
+    }
+    if ((builderPtr->depth != 0) || (builderPtr->patternPtr->numSteps == 0))
+    {
+        return Fail(builderPtr, LE_FORMAT_ERROR);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Works out how long one pass through a run of steps takes, and how many tones it plays,
+ * counting the repeats of the loops in it (e.g., one pass through a loop body, from its first
+ * step to its loop step).
+ *
+ * @return false if the run never ends (it holds a tone, or loops forever), or is too long to
+ *         count.
+ */
+//--------------------------------------------------------------------------------------------------
+bool pattern_GetRunLength
+(
+    const pattern_Pattern_t *patternPtr,    ///< Pattern.
+    uint16_t start,                         ///< First step of the run.
+    uint16_t end,                           ///< Step after the last step of the run.
+    uint64_t *durationNsPtr,                ///< [OUT] Time taken.
+    uint64_t *toneCountPtr                  ///< [OUT] Tones played.
+)
+{
+    uint64_t durationNs = 0;
+    uint64_t toneCount = 0;
+
+    for (uint16_t i = start; i < end; i++)
+    {
+        const pattern_Step_t *stepPtr = &patternPtr->steps[i];
+
+        if (stepPtr->op == PATTERN_OP_TONE)
+        {
+            if ((stepPtr->durationNs == PATTERN_DURATION_INFINITE) ||
+                (stepPtr->durationNs > UINT64_MAX - durationNs))
+            {
+                return false;
+            }
+            durationNs += stepPtr->durationNs;
+            toneCount++;
+            continue;
+        }
+
+        // The body has been counted once already, on the way to its loop step.
+        uint64_t bodyNs;
+        uint64_t bodyTones;
+        if ((stepPtr->loopCount == 0) ||
+            !pattern_GetRunLength(patternPtr, stepPtr->loopStart, i, &bodyNs, &bodyTones))
+        {
+            return false;
+        }
+
+        uint64_t repeats = stepPtr->loopCount - 1;
+        if ((repeats > 0) && ((bodyNs > (UINT64_MAX - durationNs) / repeats) ||
+                              (bodyTones > (UINT64_MAX - toneCount) / repeats)))
+        {
+            return false;
+        }
+        durationNs += repeats * bodyNs;
+        toneCount += repeats * bodyTones;
+    }
+
+    *durationNsPtr = durationNs;
+    *toneCountPtr = toneCount;
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Builds the pattern for a simple on/off duty cycle that repeats a number of times (or forever).
+ * The pattern has no time limit.
+ *
+ * For a given count, the result always has the same shape (on tone, off tone, loop), so updating
+ * the on time of a pattern that is playing does not disturb the sequencer's position in it.  The
+ * exception is a cycle that is always on or always off, which is a single tone lasting for all
+ * the cycles, so that nothing has to be done at the end of each one.
+ */
+//--------------------------------------------------------------------------------------------------
+void pattern_MakeDutyCycle
+(
+    pattern_Pattern_t *patternPtr,  ///< Pattern to build into.
+    uint32_t freqHz,                ///< Frequency to output during the on part of the cycle.
+    uint64_t periodNs,              ///< Length of the whole cycle (must be > 0).
+    uint64_t onNs,                  ///< Length of the on part of the cycle (<= periodNs).
+    uint32_t count                  ///< Number of cycles (0 = forever, at most
+                                    ///  PATTERN_MAX_LOOP_COUNT).
+)
+{
+    pattern_Builder_t builder;
+
+    pattern_InitBuilder(&builder, patternPtr);
+
+    if ((onNs == 0) || (onNs == periodNs))
+    {
+        // Always off or always on.  As a cycle, one of its tones would take no time, and the
+        // sequencer would wake up at the end of every cycle just to carry on with the same tone.
+        pattern_AddTone(&builder, (onNs == 0) ? 0 : freqHz,
+                        (count == 0) ? PATTERN_DURATION_INFINITE : (periodNs * count));
+        patternPtr->heldPeriodNs = periodNs;
+    }
+    else
+    {
+        pattern_BeginLoop(&builder);
+        pattern_AddTone(&builder, freqHz, onNs);
+        pattern_AddTone(&builder, 0, periodNs - onNs);
+        pattern_EndLoop(&builder, count);
+    }
+
+    LE_ASSERT(pattern_Finish(&builder) == LE_OK);
+}
@@ -0,0 +1,255 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pattern.h
+ *
+ * Compiled buzzer patterns.
+ *
+ * A pattern is a flat table of steps.  A tone step outputs a frequency (0 = silent) for a
+ * duration.  A loop step jumps back to the first step of its loop body a given number of times
+ * (or forever).  Loops can be nested, up to PATTERN_MAX_LOOP_DEPTH deep.  A pattern can also be
+ * given a time limit, after which it ends wherever it has got to.
+ *
+ * Patterns whose timing isn't critical (e.g., a reminder chirp every 30 seconds) can be given some
+ * slack: each silence may then be stretched by less than the slack, so that the tone after it
+ * starts on a multiple of the slack (on the CLOCK_MONOTONIC clock).  The wake-up for it can then
+ * coincide with those of other timers aligned the same way, rather than waking the CPU up on its
+ * own.  The tones themselves always last exactly as long as they should.
+ *
+ * Patterns are built using a pattern_Builder_t, which checks that the result is well formed, so
+ * the sequencer never has to validate anything while it is running.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PATTERN_H_INCLUDE_GUARD
+#define PATTERN_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+/// Maximum number of steps (tones and loops) in a pattern.
+#define PATTERN_MAX_STEPS 64
+
+/// Maximum nesting depth of loops in a pattern.
+#define PATTERN_MAX_LOOP_DEPTH 8
+
+/// Maximum number of times a finite loop body can be played.
+#define PATTERN_MAX_LOOP_COUNT UINT16_MAX
+
+/// Maximum slack (1 minute).
+#define PATTERN_MAX_SLACK_NS (60 * 1000000000ULL)
+
+/// Tone duration meaning "hold this tone until the pattern is replaced or stopped" (also used as a
+/// pattern's time limit, meaning "no limit").
+#define PATTERN_DURATION_INFINITE UINT64_MAX
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Step operation codes.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PATTERN_OP_TONE,    ///< Output a frequency for a duration.
+    PATTERN_OP_LOOP,    ///< Jump back to the start of the loop body.
+}
+pattern_Op_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A single step of a compiled pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t durationNs;    ///< TONE: how long to output the frequency for.
+    uint32_t freqHz;        ///< TONE: frequency to output (0 = silent).
+    uint16_t loopStart;     ///< LOOP: index of the first step of the loop body.
+    uint16_t loopCount;     ///< LOOP: number of times to play the loop body (0 = forever).
+    uint8_t op;             ///< Operation (pattern_Op_t).
+}
+pattern_Step_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A compiled pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint16_t numSteps;                          ///< Number of valid entries in steps[].
+    uint64_t limitNs;                           ///< Longest time to play for, from the start
+                                                ///  (PATTERN_DURATION_INFINITE = no limit).
+    uint64_t slackNs;                           ///< How much later than planned a tone may start
+                                                ///  after a silence (0 = exactly on time).
+    uint64_t heldPeriodNs;                      ///< Period of the cycle that a single tone stands
+                                                ///  in for (0 if none, see
+                                                ///  pattern_MakeDutyCycle()).
+    pattern_Step_t steps[PATTERN_MAX_STEPS];    ///< The step table.
+}
+pattern_Pattern_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State used while building a pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pattern_Pattern_t *patternPtr;                  ///< Pattern being built.
+    uint16_t depth;                                 ///< Number of loops currently open.
+    uint16_t loopStarts[PATTERN_MAX_LOOP_DEPTH];    ///< First step of each open loop body.
+    le_result_t result;                             ///< First error encountered, or LE_OK.
+}
+pattern_Builder_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts building a new pattern, discarding anything previously stored in it.
+ */
+//--------------------------------------------------------------------------------------------------
+void pattern_InitBuilder
+(
+    pattern_Builder_t *builderPtr,  ///< Builder to initialize.
+    pattern_Pattern_t *patternPtr   ///< Pattern to build into.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Appends a tone step to the pattern being built.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the pattern is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_AddTone
+(
+    pattern_Builder_t *builderPtr,  ///< Builder.
+    uint32_t freqHz,                ///< Frequency to output (0 = silent).
+    uint64_t durationNs             ///< Duration, or PATTERN_DURATION_INFINITE.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens a loop.  Steps added until the matching pattern_EndLoop() form the loop body.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if loops are nested too deeply.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_BeginLoop
+(
+    pattern_Builder_t *builderPtr   ///< Builder.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the innermost open loop.  A loop that is only played once is just its body, so no loop
+ * step is added for it.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the pattern is full.
+ *  - LE_FORMAT_ERROR if no loop is open, or the loop body is empty or takes no time to play.
+ *  - LE_OUT_OF_RANGE if the count is too large.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_EndLoop
+(
+    pattern_Builder_t *builderPtr,  ///< Builder.
+    uint32_t count                  ///< Number of times to play the loop body (0 = forever).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finishes building a pattern.
+ *
+ * @return
+ *  - LE_OK if the pattern is ready to be played.
+ *  - LE_FORMAT_ERROR if the pattern is empty or a loop was left open.
+ *  - Otherwise, the first error returned while building the pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_Finish
+(
+    pattern_Builder_t *builderPtr   ///< Builder.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Works out how long one pass through a run of steps takes, and how many tones it plays,
+ * counting the repeats of the loops in it (e.g., one pass through a loop body, from its first
+ * step to its loop step).
+ *
+ * @return false if the run never ends (it holds a tone, or loops forever), or is too long to
+ *         count.
+ */
+//--------------------------------------------------------------------------------------------------
+bool pattern_GetRunLength
+(
+    const pattern_Pattern_t *patternPtr,    ///< Pattern.
+    uint16_t start,                         ///< First step of the run.
+    uint16_t end,                           ///< Step after the last step of the run.
+    uint64_t *durationNsPtr,                ///< [OUT] Time taken.
+    uint64_t *toneCountPtr                  ///< [OUT] Tones played.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Builds the pattern for a simple on/off duty cycle that repeats a number of times (or forever).
+ * The pattern has no time limit.
+ *
+ * For a given count, the result always has the same shape (on tone, off tone, loop), so updating
+ * the on time of a pattern that is playing does not disturb the sequencer's position in it.  The
+ * exception is a cycle that is always on or always off, which is a single tone lasting for all
+ * the cycles, so that nothing has to be done at the end of each one.
+ */
+//--------------------------------------------------------------------------------------------------
+void pattern_MakeDutyCycle
+(
+    pattern_Pattern_t *patternPtr,  ///< Pattern to build into.
+    uint32_t freqHz,                ///< Frequency to output during the on part of the cycle.
+    uint64_t periodNs,              ///< Length of the whole cycle (must be > 0).
+    uint64_t onNs,                  ///< Length of the on part of the cycle (<= periodNs).
+    uint32_t count                  ///< Number of cycles (0 = forever, at most
+                                    ///  PATTERN_MAX_LOOP_COUNT).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compiles a pattern from its JSON description.
+ *
+ * A pattern is described by a group object:
+ *
+ * @verbatim
+   {
+       "repeat": 3,             // Times to play the steps (0 = forever).  Optional, default 1.
+       "slack": 1000,           // Slack (ms).  Top level only.  Optional, default 0.
+       "steps":                 // Steps to play, in order.
+       [
+           { "freq": 4096, "ms": 100 },         // Tone.  "freq" is optional, default 0 (silent).
+           { "ms": 50 },                        // Silence.
+           { "repeat": 2, "steps": [ ... ] },   // Nested group.
+           { "freq": 2048 }                     // Tone without "ms" is held until stopped.
+       ]
+   }
+   @endverbatim
+ *
+ * Durations can be fractional (e.g., 0.25 ms), and are kept to the nearest nanosecond.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FORMAT_ERROR if the description is not valid.
+ *  - LE_OUT_OF_RANGE if a value is out of range.
+ *  - LE_OVERFLOW if the pattern has too many steps or its groups are nested too deeply.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_ParseJson
+(
+    pattern_Pattern_t *patternPtr,  ///< Pattern to compile into.
+    const char *jsonPtr             ///< JSON description (null-terminated).
+);
+
+#endif // PATTERN_H_INCLUDE_GUARD
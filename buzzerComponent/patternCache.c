@@ -0,0 +1,232 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache of compiled patterns.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "patternCache.h"
+
+/// Maximum number of patterns kept in the cache.
+#define CACHE_SIZE 16
+
+/// Longest JSON description (including the terminator) of a pattern that is kept in the cache.
+/// Longer ones are compiled each time they are pushed.
+#define MAX_JSON_BYTES 2048
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache lookup key.  The hash only picks the bucket: keys are equal only if their JSON
+ * descriptions are.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t hash;          ///< FNV-1a hash of the JSON description.
+    size_t len;             ///< Length of the JSON description.
+    const char *jsonPtr;    ///< JSON description.
+}
+Key_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache entry.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pattern_Pattern_t pattern;  ///< The compiled pattern.
+    Key_t key;                  ///< Key the pattern is stored under (pointing at json).
+    le_dls_Link_t link;         ///< Link in the list of entries, most recently used first.
+    char json[MAX_JSON_BYTES];  ///< JSON description the pattern was compiled from.
+}
+Entry_t;
+
+/// Pool from which cache entries are allocated.
+static le_mem_PoolRef_t EntryPool;
+
+/// Map of Key_t to Entry_t.
+static le_hashmap_Ref_t EntryMap;
+
+/// List of entries in the cache, most recently used first.
+static le_dls_List_t EntryList = LE_DLS_LIST_INIT;
+
+/// Function used to check newly compiled patterns.
+static patternCache_CheckFunc_t CheckFunc;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hashes a lookup key.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t HashKey
+(
+    const void *keyPtr
+)
+{
+    return (size_t)((const Key_t *)keyPtr)->hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compares two lookup keys.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool KeysEqual
+(
+    const void *firstPtr,
+    const void *secondPtr
+)
+{
+    const Key_t *aPtr = firstPtr;
+    const Key_t *bPtr = secondPtr;
+
+    return (aPtr->hash == bPtr->hash) && (aPtr->len == bPtr->len) &&
+           (memcmp(aPtr->jsonPtr, bPtr->jsonPtr, aPtr->len) == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Computes the lookup key for a JSON description.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComputeKey
+(
+    const char *jsonPtr,
+    Key_t *keyPtr
+)
+{
+    // 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char *cPtr = (const unsigned char *)jsonPtr;
+
+    while (*cPtr != '\0')
+    {
+        hash ^= *cPtr++;
+        hash *= 1099511628211ULL;
+    }
+
+    keyPtr->hash = hash;
+    keyPtr->len = (size_t)((const char *)cPtr - jsonPtr);
+    keyPtr->jsonPtr = jsonPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the pattern cache.  Must be called before any other function in this module.
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_Init
+(
+    patternCache_CheckFunc_t checkFunc      ///< Function to check newly compiled patterns.
+)
+{
+    CheckFunc = checkFunc;
+
+    EntryPool = le_mem_CreatePool("Pattern Cache", sizeof(Entry_t));
+    le_mem_ExpandPool(EntryPool, CACHE_SIZE + 1);
+
+    EntryMap = le_hashmap_Create("Pattern Cache", CACHE_SIZE, HashKey, KeysEqual);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the compiled form of a pattern, compiling it only if it is not already in the cache.
+ *
+ * The pattern must be released using patternCache_Release() when it is no longer needed.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_POSSIBLE if the pattern was rejected by the check function.
+ *  - Otherwise, the error returned by pattern_ParseJson().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t patternCache_Get
+(
+    const char *jsonPtr,                    ///< JSON description of the pattern.
+    const pattern_Pattern_t **patternPtrPtr ///< [OUT] Compiled pattern.
+)
+{
+    Key_t key;
+    ComputeKey(jsonPtr, &key);
+
+    Entry_t *entryPtr = le_hashmap_Get(EntryMap, &key);
+    if (entryPtr != NULL)
+    {
+        le_dls_Remove(&EntryList, &entryPtr->link);
+        le_dls_Stack(&EntryList, &entryPtr->link);
+    }
+    else
+    {
+        entryPtr = le_mem_ForceAlloc(EntryPool);
+
+        le_result_t result = pattern_ParseJson(&entryPtr->pattern, jsonPtr);
+        if ((result == LE_OK) && !CheckFunc(&entryPtr->pattern))
+        {
+            result = LE_NOT_POSSIBLE;
+        }
+        if (result != LE_OK)
+        {
+            le_mem_Release(entryPtr);
+            return result;
+        }
+
+        // A pattern too long to keep is only held by the caller.
+        if (key.len >= MAX_JSON_BYTES)
+        {
+            *patternPtrPtr = &entryPtr->pattern;
+            return LE_OK;
+        }
+
+        if (le_hashmap_Size(EntryMap) >= CACHE_SIZE)
+        {
+            Entry_t *oldestPtr = CONTAINER_OF(le_dls_PeekTail(&EntryList), Entry_t, link);
+
+            le_dls_Remove(&EntryList, &oldestPtr->link);
+            le_hashmap_Remove(EntryMap, &oldestPtr->key);
+            le_mem_Release(oldestPtr);
+        }
+
+        memcpy(entryPtr->json, jsonPtr, key.len + 1);
+        entryPtr->key = key;
+        entryPtr->key.jsonPtr = entryPtr->json;
+        entryPtr->link = LE_DLS_LINK_INIT;
+        le_dls_Stack(&EntryList, &entryPtr->link);
+        le_hashmap_Put(EntryMap, &entryPtr->key, entryPtr);
+    }
+
+    // One reference is held by the cache, and one by the caller.
+    le_mem_AddRef(entryPtr);
+    *patternPtrPtr = &entryPtr->pattern;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Takes an extra reference to a pattern obtained using patternCache_Get().  Each reference must
+ * be released using patternCache_Release().
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_AddRef
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+)
+{
+    le_mem_AddRef(CONTAINER_OF(patternPtr, Entry_t, pattern));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Releases a pattern obtained using patternCache_Get().
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_Release
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+)
+{
+    le_mem_Release(CONTAINER_OF(patternPtr, Entry_t, pattern));
+}
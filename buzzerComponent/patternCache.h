@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file patternCache.h
+ *
+ * Cache of compiled patterns, keyed by their JSON description.
+ *
+ * The same few patterns tend to be pushed over and over again, so looking a pattern up in the
+ * cache saves both parsing it and allocating memory for it.  The least recently used pattern is
+ * evicted when the cache is full.  Patterns are reference counted, so a pattern that is evicted
+ * while it is still being played stays valid until it is released.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PATTERN_CACHE_H_INCLUDE_GUARD
+#define PATTERN_CACHE_H_INCLUDE_GUARD
+
+#include "pattern.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function used to check that a newly compiled pattern can be played.
+ *
+ * @return true if the pattern can be played.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef bool (*patternCache_CheckFunc_t)
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the pattern cache.  Must be called before any other function in this module.
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_Init
+(
+    patternCache_CheckFunc_t checkFunc      ///< Function to check newly compiled patterns.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the compiled form of a pattern, compiling it only if it is not already in the cache.
+ *
+ * The pattern must be released using patternCache_Release() when it is no longer needed.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_POSSIBLE if the pattern was rejected by the check function.
+ *  - Otherwise, the error returned by pattern_ParseJson().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t patternCache_Get
+(
+    const char *jsonPtr,                    ///< JSON description of the pattern.
+    const pattern_Pattern_t **patternPtrPtr ///< [OUT] Compiled pattern.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Takes an extra reference to a pattern obtained using patternCache_Get().  Each reference must
+ * be released using patternCache_Release().
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_AddRef
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Releases a pattern obtained using patternCache_Get().
+ */
+//--------------------------------------------------------------------------------------------------
+void patternCache_Release
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+);
+
+#endif // PATTERN_CACHE_H_INCLUDE_GUARD
@@ -0,0 +1,375 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compilation of buzzer patterns from their JSON description (see pattern_ParseJson()).
+ *
+ * The JSON is parsed in a single pass, straight into a pattern builder, without building any
+ * intermediate document tree.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pattern.h"
+
+/// Maximum length of an object member name that is recognized.
+#define MAX_KEY_LEN 15
+
+/// Longest tone duration accepted (1 day), in milliseconds.
+#define MAX_DURATION_MS (24.0 * 60 * 60 * 1000)
+
+/// Highest frequency accepted, in Hz.
+#define MAX_FREQ_HZ 1000000.0
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parser state.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *pos;                ///< Next character to parse.
+    pattern_Builder_t builder;      ///< Builder for the pattern being compiled.
+}
+Parser_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skips over white space.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SkipSpace
+(
+    Parser_t *parserPtr
+)
+{
+    while ((*parserPtr->pos == ' ') || (*parserPtr->pos == '\t') ||
+           (*parserPtr->pos == '\n') || (*parserPtr->pos == '\r'))
+    {
+        parserPtr->pos++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consumes a given character, if it is the next non-space character.
+ *
+ * @return true if the character was consumed.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Accept
+(
+    Parser_t *parserPtr,
+    char c
+)
+{
+    SkipSpace(parserPtr);
+
+    if (*parserPtr->pos == c)
+    {
+        parserPtr->pos++;
+        return true;
+    }
+
+    return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parses an object member name and the colon that follows it.  Names that are too long to be
+ * recognized are truncated.
+ *
+ * @return LE_OK or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseKey
+(
+    Parser_t *parserPtr,
+    char keyBuff[MAX_KEY_LEN + 1]
+)
+{
+    size_t len = 0;
+
+    if (!Accept(parserPtr, '"'))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    while (*parserPtr->pos != '"')
+    {
+        // None of the names we recognize contain escapes or control characters.
+        if ((*parserPtr->pos == '\0') || (*parserPtr->pos == '\\') ||
+            ((unsigned char)*parserPtr->pos < ' '))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        if (len < MAX_KEY_LEN)
+        {
+            keyBuff[len++] = *parserPtr->pos;
+        }
+        parserPtr->pos++;
+    }
+    parserPtr->pos++;
+    keyBuff[len] = '\0';
+
+    return Accept(parserPtr, ':') ? LE_OK : LE_FORMAT_ERROR;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skips a run of decimal digits.
+ *
+ * @return The number of digits skipped.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t SkipDigits
+(
+    const char **posPtr
+)
+{
+    const char *startPtr = *posPtr;
+
+    while ((**posPtr >= '0') && (**posPtr <= '9'))
+    {
+        (*posPtr)++;
+    }
+
+    return (size_t)(*posPtr - startPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parses a number and checks that it is within a range.
+ *
+ * @return LE_OK, LE_FORMAT_ERROR or LE_OUT_OF_RANGE.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseNumber
+(
+    Parser_t *parserPtr,
+    double min,
+    double max,
+    double *valuePtr
+)
+{
+    SkipSpace(parserPtr);
+
+    // strtod() accepts more than JSON does (e.g., "-nan", "inf", hex and leading zeros), so the
+    // number is matched against the JSON grammar first:
+    //      -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+    const char *endPtr = parserPtr->pos;
+    if (*endPtr == '-')
+    {
+        endPtr++;
+    }
+    if (*endPtr == '0')
+    {
+        endPtr++;
+    }
+    else if ((*endPtr < '1') || (*endPtr > '9') || (SkipDigits(&endPtr) == 0))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    if (*endPtr == '.')
+    {
+        endPtr++;
+        if (SkipDigits(&endPtr) == 0)
+        {
+            return LE_FORMAT_ERROR;
+        }
+    }
+    if ((*endPtr == 'e') || (*endPtr == 'E'))
+    {
+        endPtr++;
+        if ((*endPtr == '+') || (*endPtr == '-'))
+        {
+            endPtr++;
+        }
+        if (SkipDigits(&endPtr) == 0)
+        {
+            return LE_FORMAT_ERROR;
+        }
+    }
+
+    // strtod() must then read exactly that much (e.g., not "0x10" when the grammar matched "0").
+    char *strtodEndPtr;
+    errno = 0;
+    double value = strtod(parserPtr->pos, &strtodEndPtr);
+    if ((strtodEndPtr != endPtr) || (errno == ERANGE) || !isfinite(value))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    parserPtr->pos = endPtr;
+
+    if ((value < min) || (value > max))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    *valuePtr = value;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parses a step object: either a tone or a group of steps.
+ *
+ * @return LE_OK or an error code (see pattern_ParseJson()).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseStep
+(
+    Parser_t *parserPtr,
+    bool isTopLevel     ///< true if this is the pattern itself, which must be a group.
+)
+{
+    char key[MAX_KEY_LEN + 1];
+    bool isGroup = false;
+    bool hasSteps = false;
+    bool isTone = false;
+    double freqHz = 0;
+    double durationMs = -1;     // Negative = hold forever.
+    double repeat = 1;
+    le_result_t result;
+
+    if (!Accept(parserPtr, '{'))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (!Accept(parserPtr, '}'))
+    {
+        do
+        {
+            result = ParseKey(parserPtr, key);
+            if (result != LE_OK)
+            {
+                return result;
+            }
+
+            if (strcmp(key, "freq") == 0)
+            {
+                isTone = true;
+                result = ParseNumber(parserPtr, 0, MAX_FREQ_HZ, &freqHz);
+            }
+            else if (strcmp(key, "ms") == 0)
+            {
+                isTone = true;
+                result = ParseNumber(parserPtr, 0, MAX_DURATION_MS, &durationMs);
+            }
+            else if ((strcmp(key, "slack") == 0) && isTopLevel)
+            {
+                double slackMs;
+                result = ParseNumber(parserPtr, 0, PATTERN_MAX_SLACK_NS / 1000000, &slackMs);
+                if (result == LE_OK)
+                {
+                    parserPtr->builder.patternPtr->slackNs =
+                        (uint64_t)((slackMs * 1000000.0) + 0.5);
+                }
+            }
+            else if (strcmp(key, "repeat") == 0)
+            {
+                isGroup = true;
+                result = ParseNumber(parserPtr, 0, PATTERN_MAX_LOOP_COUNT, &repeat);
+            }
+            else if ((strcmp(key, "steps") == 0) && !isTone && !hasSteps)
+            {
+                if (!Accept(parserPtr, '['))
+                {
+                    return LE_FORMAT_ERROR;
+                }
+
+                isGroup = true;
+                hasSteps = true;
+                result = pattern_BeginLoop(&parserPtr->builder);
+
+                if ((result == LE_OK) && !Accept(parserPtr, ']'))
+                {
+                    do
+                    {
+                        result = ParseStep(parserPtr, false);
+                    }
+                    while ((result == LE_OK) && Accept(parserPtr, ','));
+
+                    if ((result == LE_OK) && !Accept(parserPtr, ']'))
+                    {
+                        result = LE_FORMAT_ERROR;
+                    }
+                }
+            }
+            else
+            {
+                result = LE_FORMAT_ERROR;
+            }
+
+            if (result != LE_OK)
+            {
+                return result;
+            }
+        }
+        while (Accept(parserPtr, ','));
+
+        if (!Accept(parserPtr, '}'))
+        {
+            return LE_FORMAT_ERROR;
+        }
+    }
+
+    if (isGroup || isTopLevel)
+    {
+        // A group must have a list of steps, and must not also have tone members.
+        if (isTone || !hasSteps || (repeat != (uint32_t)repeat))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        return pattern_EndLoop(&parserPtr->builder, (uint32_t)repeat);
+    }
+
+    if (!isTone)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return pattern_AddTone(&parserPtr->builder,
+                           (uint32_t)(freqHz + 0.5),
+                           (durationMs < 0) ? PATTERN_DURATION_INFINITE
+                                            : (uint64_t)((durationMs * 1000000.0) + 0.5));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compiles a pattern from its JSON description.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FORMAT_ERROR if the description is not valid.
+ *  - LE_OUT_OF_RANGE if a value is out of range.
+ *  - LE_OVERFLOW if the pattern has too many steps or its groups are nested too deeply.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pattern_ParseJson
+(
+    pattern_Pattern_t *patternPtr,  ///< Pattern to compile into.
+    const char *jsonPtr             ///< JSON description (null-terminated).
+)
+{
+    Parser_t parser;
+
+    parser.pos = jsonPtr;
+    pattern_InitBuilder(&parser.builder, patternPtr);
+
+    le_result_t result = ParseStep(&parser, true);
+    if (result != LE_OK)
+    {
+        return result;
+    }
+
+    SkipSpace(&parser);
+    if (*parser.pos != '\0')
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return pattern_Finish(&parser.builder);
+}
@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Named requests.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "request.h"
+#include "arbiter.h"
+#include "backend.h"
+#include "engine.h"
+#include "patternCache.h"
+#include "stats.h"
+#include "resource.h"
+
+/// Priority of a request until one is pushed.
+#define DEFAULT_PRIORITY 1
+
+/// Highest priority a request can have.
+#define MAX_PRIORITY 1000
+
+/// Number of requesters (the shared settings take up one of the engine's slots).
+#define MAX_REQUESTERS (ENGINE_MAX_SLOTS - 1)
+
+/// Longest requester name (including the terminator).
+#define MAX_NAME_BYTES 32
+
+/// Longest resource path (including the terminator).
+#define MAX_PATH_BYTES (MAX_NAME_BYTES + 32)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A requester.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char patternPath[MAX_PATH_BYTES];       ///< Path of the pattern resource.
+    char priorityPath[MAX_PATH_BYTES];      ///< Path of the priority resource.
+    char donePath[MAX_PATH_BYTES];          ///< Path of the done input.
+    bool doneCreated;                       ///< true once the done input has been created.
+    uint8_t slot;                           ///< Arbiter slot.
+    const pattern_Pattern_t *patternPtr;    ///< Pattern requested (NULL if none).
+}
+Requester_t;
+
+static Requester_t Requesters[MAX_REQUESTERS];
+static size_t NumRequesters = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for pattern updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PatternPushHandler
+(
+    double timestamp,
+    const char *json,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+    Requester_t *requesterPtr = context;
+    const pattern_Pattern_t *newPatternPtr = NULL;
+    le_result_t result = LE_OK;
+
+    if ((json[0] != '\0') && (strcmp(json, "null") != 0))
+    {
+        result = patternCache_Get(json, &newPatternPtr);
+    }
+
+    if (result != LE_OK)
+    {
+        LE_ERROR("Ignoring invalid pattern for %s (%s)",
+                 requesterPtr->patternPath, LE_RESULT_TXT(result));
+    }
+    else
+    {
+        if (newPatternPtr == NULL)
+        {
+            arbiter_Release(requesterPtr->slot);
+        }
+        else
+        {
+            arbiter_Play(requesterPtr->slot, newPatternPtr);
+        }
+
+        // The engine has its own copy, so the old pattern can go.
+        if (requesterPtr->patternPtr != NULL)
+        {
+            patternCache_Release(requesterPtr->patternPtr);
+        }
+        requesterPtr->patternPtr = newPatternPtr;
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler function for priority updates from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PriorityPushHandler
+(
+    double timestamp,
+    double priority,
+    void *context
+)
+{
+    uint64_t startNs = backend_GetMonotonicNs();
+    Requester_t *requesterPtr = context;
+
+    if (!resource_IsInRange(priority, 0.0, MAX_PRIORITY))
+    {
+        LE_ERROR("Ignoring invalid priority (%lf) for %s - must be between 0 & %d",
+                 priority, requesterPtr->priorityPath, MAX_PRIORITY);
+    }
+    else
+    {
+        arbiter_SetPriority(requesterPtr->slot, (int32_t)(priority + 0.5));
+    }
+
+    stats_RecordUpdate(timestamp, backend_GetMonotonicNs() - startNs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Called by the arbiter when a requester's pattern has finished.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFinished
+(
+    void *contextPtr
+)
+{
+    Requester_t *requesterPtr = contextPtr;
+
+    const resource_Input_t doneInput = { requesterPtr->donePath, DHUBIO_DATA_TYPE_TRIGGER, "" };
+
+    resource_CreateInputs(&doneInput, 1, &requesterPtr->doneCreated);
+    dhubIO_PushTrigger(requesterPtr->donePath, DHUBIO_NOW);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a requester.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddRequester
+(
+    const char *namePtr     ///< Name.
+)
+{
+    // Names go into resource paths, and into the status JSON (see status.h).
+    if ((namePtr[0] == '\0') || (strpbrk(namePtr, "/\"\\") != NULL))
+    {
+        LE_ERROR("Ignoring invalid requester name '%s'", namePtr);
+        return;
+    }
+    if (NumRequesters >= MAX_REQUESTERS)
+    {
+        LE_ERROR("Ignoring requester '%s' - at most %d are supported", namePtr, MAX_REQUESTERS);
+        return;
+    }
+
+    Requester_t *requesterPtr = &Requesters[NumRequesters++];
+    snprintf(requesterPtr->patternPath, sizeof(requesterPtr->patternPath),
+             "requests/%s/pattern", namePtr);
+    snprintf(requesterPtr->priorityPath, sizeof(requesterPtr->priorityPath),
+             "requests/%s/priority", namePtr);
+    snprintf(requesterPtr->donePath, sizeof(requesterPtr->donePath),
+             "requests/%s/done", namePtr);
+    requesterPtr->doneCreated = false;
+    requesterPtr->slot = arbiter_AddSlot(namePtr, DEFAULT_PRIORITY, HandleFinished, requesterPtr);
+    requesterPtr->patternPtr = NULL;
+
+    LE_ASSERT(LE_OK == dhubIO_CreateOutput(requesterPtr->patternPath, DHUBIO_DATA_TYPE_JSON, ""));
+    LE_ASSERT(dhubIO_AddJsonPushHandler(requesterPtr->patternPath, PatternPushHandler,
+                                        requesterPtr));
+
+    LE_ASSERT(LE_OK == dhubIO_CreateOutput(requesterPtr->priorityPath, DHUBIO_DATA_TYPE_NUMERIC,
+                                           ""));
+    LE_ASSERT(dhubIO_AddNumericPushHandler(requesterPtr->priorityPath, PriorityPushHandler,
+                                           requesterPtr));
+    dhubIO_SetNumericDefault(requesterPtr->priorityPath, DEFAULT_PRIORITY);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a request slot for each requester, and registers their resources with the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void request_Init
+(
+    const char *namesPtr    ///< Comma-separated requester names (NULL = none).
+)
+{
+    if (namesPtr == NULL)
+    {
+        return;
+    }
+
+    while (*namesPtr != '\0')
+    {
+        size_t len = strcspn(namesPtr, ",");
+        char name[MAX_NAME_BYTES];
+
+        if (len >= sizeof(name))
+        {
+            LE_ERROR("Ignoring requester name longer than %d bytes", MAX_NAME_BYTES - 1);
+        }
+        else
+        {
+            memcpy(name, namesPtr, len);
+            name[len] = '\0';
+            AddRequester(name);
+        }
+
+        namesPtr += len;
+        if (*namesPtr == ',')
+        {
+            namesPtr++;
+        }
+    }
+}
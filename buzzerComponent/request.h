@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file request.h
+ *
+ * Named requests.  Each app that wants to sound the buzzer (e.g., a fault monitor, a user
+ * interaction app, a provisioning app) gets a request slot of its own in the Data Hub, rather
+ * than fighting over the shared settings:
+ *
+ *  - requests/<name>/pattern: JSON pattern description (see pattern_ParseJson()) to play.
+ *    Pushing a pattern starts it from the beginning.  Pushing null (or an empty string)
+ *    withdraws the request.
+ *  - requests/<name>/priority: priority of the request (0 to 1000, default 1).  The highest
+ *    priority request is played (see arbiter.h).  The shared settings have priority 0.
+ *  - requests/<name>/done: trigger input, pushed when the requested pattern comes to its end
+ *    (e.g., a pattern with a finite "repeat").  The request is then withdrawn, so a lower priority
+ *    one gets the buzzer back straight away.  Patterns that are played forever never end.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef REQUEST_H_INCLUDE_GUARD
+#define REQUEST_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a request slot for each requester, and registers their resources with the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+void request_Init
+(
+    const char *namesPtr    ///< Comma-separated requester names (NULL = none).
+);
+
+#endif // REQUEST_H_INCLUDE_GUARD
@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Utilities for the component's Data Hub resources.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "resource.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates some inputs, unless they have already been created.
+ *
+ * @return true if the inputs have been created now, false if they already had been.
+ */
+//--------------------------------------------------------------------------------------------------
+bool resource_CreateInputs
+(
+    const resource_Input_t *inputsPtr,  ///< Inputs.
+    size_t numInputs,                   ///< Number of entries in inputsPtr.
+    bool *createdPtr                    ///< [IN/OUT] true once the inputs have been created.
+)
+{
+    if (*createdPtr)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < numInputs; i++)
+    {
+        LE_ASSERT(LE_OK == dhubIO_CreateInput(inputsPtr[i].pathPtr, inputsPtr[i].type,
+                                              inputsPtr[i].unitsPtr));
+    }
+    *createdPtr = true;
+
+    return true;
+}
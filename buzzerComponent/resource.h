@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file resource.h
+ *
+ * Utilities for the component's Data Hub resources, shared by the modules that own them.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef RESOURCE_H_INCLUDE_GUARD
+#define RESOURCE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A Data Hub input.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *pathPtr;        ///< Path, relative to the app's root.
+    dhubIO_DataType_t type;     ///< Data type.
+    const char *unitsPtr;       ///< Units.
+}
+resource_Input_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether a value pushed to a setting is within its range (inclusive).  Any comparison
+ * with NaN is false, so NaN is out of range too.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool resource_IsInRange
+(
+    double value,
+    double min,
+    double max
+)
+{
+    return (value >= min) && (value <= max);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates some inputs, unless they have already been created.
+ *
+ * Inputs are created the first time a value is pushed to them, rather than at start-up: creating
+ * each one is a round trip to the Data Hub, which would otherwise hold up the settings' push
+ * handlers (and so the first output change) at start-up.
+ *
+ * @return true if the inputs have been created now, false if they already had been.
+ */
+//--------------------------------------------------------------------------------------------------
+bool resource_CreateInputs
+(
+    const resource_Input_t *inputsPtr,  ///< Inputs.
+    size_t numInputs,                   ///< Number of entries in inputsPtr.
+    bool *createdPtr                    ///< [IN/OUT] true once the inputs have been created.
+);
+
+#endif // RESOURCE_H_INCLUDE_GUARD
@@ -0,0 +1,291 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pattern sequencer.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "sequencer.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing a pattern from its first step.
+ */
+//--------------------------------------------------------------------------------------------------
+void seq_Start
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern to play (must have been finished).
+    uint64_t startNs                        ///< Time at which the first step starts.
+)
+{
+    // Loop steps always follow their body, so a finished pattern always starts with a tone.
+    LE_ASSERT(patternPtr->steps[0].op == PATTERN_OP_TONE);
+
+    playerPtr->patternPtr = patternPtr;
+    playerPtr->stepStartNs = startNs;
+    playerPtr->endNs = (patternPtr->limitNs == PATTERN_DURATION_INFINITE) ?
+                       SEQ_NO_DEADLINE : (startNs + patternPtr->limitNs);
+    playerPtr->stepIndex = 0;
+    playerPtr->depth = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing a pattern from a position saved by seq_GetPosition().  The position is checked
+ * against the pattern first, as it may have been saved by a different process.
+ *
+ * @return false if the position is not valid for the pattern (the player is then unchanged).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_Resume
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern to play (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+)
+{
+    uint16_t numSteps = patternPtr->numSteps;
+
+    if ((positionPtr->stepIndex >= numSteps) ||
+        (patternPtr->steps[positionPtr->stepIndex].op != PATTERN_OP_TONE) ||
+        (positionPtr->depth > PATTERN_MAX_LOOP_DEPTH))
+    {
+        return false;
+    }
+
+    // Each finite loop being played must be a loop step, with fewer repeats left than it has.
+    for (uint16_t i = 0; i < positionPtr->depth; i++)
+    {
+        uint16_t loopIndex = positionPtr->loops[i].stepIndex;
+
+        if ((loopIndex >= numSteps) ||
+            (patternPtr->steps[loopIndex].op != PATTERN_OP_LOOP) ||
+            (positionPtr->loops[i].remaining >= patternPtr->steps[loopIndex].loopCount))
+        {
+            return false;
+        }
+    }
+
+    playerPtr->patternPtr = patternPtr;
+    playerPtr->stepStartNs = positionPtr->stepStartNs;
+    playerPtr->endNs = positionPtr->endNs;
+    playerPtr->stepIndex = positionPtr->stepIndex;
+    playerPtr->depth = positionPtr->depth;
+    memcpy(playerPtr->loops, positionPtr->loops, sizeof(playerPtr->loops));
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a player's position.  If the player has been stopped, this is the position it was last
+ * at.
+ */
+//--------------------------------------------------------------------------------------------------
+void seq_GetPosition
+(
+    const seq_Player_t *playerPtr,          ///< Player.
+    seq_Position_t *positionPtr             ///< [OUT] Position.
+)
+{
+    positionPtr->stepStartNs = playerPtr->stepStartNs;
+    positionPtr->endNs = playerPtr->endNs;
+    positionPtr->stepIndex = playerPtr->stepIndex;
+    positionPtr->depth = playerPtr->depth;
+    memcpy(positionPtr->loops, playerPtr->loops, sizeof(positionPtr->loops));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves to the next tone step, following loops.  The new step starts at the deadline of the
+ * current one.
+ *
+ * @return false if the end of the pattern (or its time limit) was reached (the player is then
+ *         stopped).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_Next
+(
+    seq_Player_t *playerPtr                 ///< Player.
+)
+{
+    const pattern_Pattern_t *patternPtr = playerPtr->patternPtr;
+    uint16_t index = playerPtr->stepIndex;
+    uint64_t deadlineNs = seq_GetDeadline(playerPtr);
+
+    if (deadlineNs == SEQ_NO_DEADLINE)
+    {
+        return true;
+    }
+
+    if (deadlineNs == playerPtr->endNs)
+    {
+        // The pattern's time limit has been reached, wherever it has got to.
+        seq_Stop(playerPtr);
+        return false;
+    }
+
+    index++;
+    while ((index < patternPtr->numSteps) && (patternPtr->steps[index].op == PATTERN_OP_LOOP))
+    {
+        const pattern_Step_t *stepPtr = &patternPtr->steps[index];
+
+        if (stepPtr->loopCount == 0)
+        {
+            // Loop forever.
+            index = stepPtr->loopStart;
+            break;
+        }
+
+        // The first time a finite loop step is reached, the body has been played once.
+        uint16_t top = playerPtr->depth;
+        if ((top == 0) || (playerPtr->loops[top - 1].stepIndex != index))
+        {
+            playerPtr->loops[top].stepIndex = index;
+            playerPtr->loops[top].remaining = stepPtr->loopCount - 1;
+            playerPtr->depth = ++top;
+        }
+
+        if (playerPtr->loops[top - 1].remaining > 0)
+        {
+            playerPtr->loops[top - 1].remaining--;
+            index = stepPtr->loopStart;
+            break;
+        }
+
+        // Loop finished.  Carry on with whatever follows it.
+        playerPtr->depth--;
+        index++;
+    }
+
+    if (index >= patternPtr->numSteps)
+    {
+        seq_Stop(playerPtr);
+        return false;
+    }
+
+    playerPtr->stepIndex = index;
+    playerPtr->stepStartNs = deadlineNs;
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * If the player is at the start of the body of the innermost loop around its step, skips the
+ * passes through the body that have ended by a given time in one go, rather than step by step.
+ * Passes that would take the pattern past its time limit, or its loop past its last repeat, are
+ * left to be stepped through.
+ *
+ * @return The number of tones skipped.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t SkipLoopPasses
+(
+    seq_Player_t *playerPtr,                ///< Player (must be playing).
+    uint64_t nowNs                          ///< Current time.
+)
+{
+    const pattern_Pattern_t *patternPtr = playerPtr->patternPtr;
+    uint16_t index = playerPtr->stepIndex;
+
+    // The innermost loop around a step is the first loop step after it whose body it is in.
+    uint16_t loopIndex = index + 1;
+    while ((loopIndex < patternPtr->numSteps) &&
+           ((patternPtr->steps[loopIndex].op != PATTERN_OP_LOOP) ||
+            (patternPtr->steps[loopIndex].loopStart > index)))
+    {
+        loopIndex++;
+    }
+    if ((loopIndex >= patternPtr->numSteps) || (patternPtr->steps[loopIndex].loopStart != index))
+    {
+        return 0;
+    }
+
+    uint64_t bodyNs;
+    uint64_t bodyTones;
+    if (!pattern_GetRunLength(patternPtr, index, loopIndex, &bodyNs, &bodyTones) || (bodyNs == 0))
+    {
+        return 0;
+    }
+
+    uint64_t limitNs = (nowNs < playerPtr->endNs) ? nowNs : playerPtr->endNs;
+    if ((limitNs < playerPtr->stepStartNs) || (limitNs - playerPtr->stepStartNs < bodyNs))
+    {
+        return 0;
+    }
+    uint64_t passes = (limitNs - playerPtr->stepStartNs) / bodyNs;
+
+    // Each pass skipped uses up one of a finite loop's repeats.  If the loop has only just been
+    // entered, it isn't being tracked yet, and has all its repeats left.
+    uint16_t loopCount = patternPtr->steps[loopIndex].loopCount;
+    if (loopCount != 0)
+    {
+        uint16_t top = playerPtr->depth;
+        bool isTracked = (top > 0) && (playerPtr->loops[top - 1].stepIndex == loopIndex);
+        uint16_t remaining = isTracked ? playerPtr->loops[top - 1].remaining : (loopCount - 1);
+
+        if (passes > remaining)
+        {
+            passes = remaining;
+        }
+        if (passes == 0)
+        {
+            return 0;
+        }
+
+        if (!isTracked)
+        {
+            LE_ASSERT(top < PATTERN_MAX_LOOP_DEPTH);
+            playerPtr->loops[top].stepIndex = loopIndex;
+            playerPtr->depth = ++top;
+        }
+        playerPtr->loops[top - 1].remaining = remaining - (uint16_t)passes;
+    }
+
+    playerPtr->stepStartNs += passes * bodyNs;
+
+    return passes * bodyTones;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves forward to the step that should be playing at a given time.  Steps whose deadlines have
+ * already passed are skipped without ever being played.  Whole passes through the innermost loop
+ * are skipped arithmetically, so catching up after a long stall takes no longer than catching up
+ * after a short one.
+ *
+ * @return false if the end of the pattern was reached (the player is then stopped).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_CatchUp
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    uint64_t nowNs                          ///< Current time.
+)
+{
+    // Leaving the step that was being output is normal.  Any step after that ended before it
+    // could be output at all.
+    uint64_t count = 0;
+
+    while (seq_GetDeadline(playerPtr) <= nowNs)
+    {
+        if (!seq_Next(playerPtr))
+        {
+            return false;
+        }
+        count++;
+
+        count += SkipLoopPasses(playerPtr, nowNs);
+    }
+
+    if (count > 1)
+    {
+        playerPtr->missedCount += count - 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,252 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sequencer.h
+ *
+ * Pattern sequencer.  Steps through a compiled pattern, keeping track of which tone should be
+ * playing and the absolute deadline at which the next step starts.
+ *
+ * The sequencer only does arithmetic on a clock that it is given; it neither reads the clock
+ * nor drives the hardware.  Step deadlines are accumulated from the time the pattern started,
+ * so a pattern never drifts, however late the caller is in servicing its deadlines.  If the
+ * pattern has a time limit, the limit is just one more deadline, at which the pattern ends.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SEQUENCER_H_INCLUDE_GUARD
+#define SEQUENCER_H_INCLUDE_GUARD
+
+#include "pattern.h"
+
+/// Deadline of a step that never ends.
+#define SEQ_NO_DEADLINE UINT64_MAX
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Playback position within a pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const pattern_Pattern_t *patternPtr;    ///< Pattern being played (NULL if none).
+    uint64_t stepStartNs;                   ///< Time at which the current step started.
+    uint64_t endNs;                         ///< Time at which the pattern's time limit is
+                                            ///  reached (SEQ_NO_DEADLINE if it has none).
+    uint16_t stepIndex;                     ///< Index of the current (tone) step.
+    uint16_t depth;                         ///< Number of entries in loops[].
+    struct
+    {
+        uint16_t stepIndex;                 ///< Index of the loop step.
+        uint16_t remaining;                 ///< Number of times left to jump back.
+    }
+    loops[PATTERN_MAX_LOOP_DEPTH];          ///< Finite loops currently being played.
+    uint64_t missedCount;                   ///< Steps that seq_CatchUp() skipped because they
+                                            ///  had already ended (never reset).
+}
+seq_Player_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A player's position, without the pattern.  Together with the pattern, this is enough to carry
+ * on playing from the same point (e.g., after the process has been restarted).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t stepStartNs;                   ///< Time at which the current step started.
+    uint64_t endNs;                         ///< Time at which the pattern's time limit is
+                                            ///  reached (SEQ_NO_DEADLINE if it has none).
+    uint16_t stepIndex;                     ///< Index of the current (tone) step.
+    uint16_t depth;                         ///< Number of entries in loops[].
+    struct
+    {
+        uint16_t stepIndex;                 ///< Index of the loop step.
+        uint16_t remaining;                 ///< Number of times left to jump back.
+    }
+    loops[PATTERN_MAX_LOOP_DEPTH];          ///< Finite loops currently being played.
+}
+seq_Position_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing a pattern from its first step.
+ */
+//--------------------------------------------------------------------------------------------------
+void seq_Start
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern to play (must have been finished).
+    uint64_t startNs                        ///< Time at which the first step starts.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts playing a pattern from a position saved by seq_GetPosition().  The position is checked
+ * against the pattern first, as it may have been saved by a different process.
+ *
+ * @return false if the position is not valid for the pattern (the player is then unchanged).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_Resume
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    const pattern_Pattern_t *patternPtr,    ///< Pattern to play (must have been finished).
+    const seq_Position_t *positionPtr       ///< Position to carry on from.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a player's position.  If the player has been stopped, this is the position it was last
+ * at.
+ */
+//--------------------------------------------------------------------------------------------------
+void seq_GetPosition
+(
+    const seq_Player_t *playerPtr,          ///< Player.
+    seq_Position_t *positionPtr             ///< [OUT] Position.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves a saved position later in time (e.g., by the time a pattern spent paused), as if it had
+ * been saved that much later.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void seq_ShiftPosition
+(
+    seq_Position_t *positionPtr,            ///< Position.
+    uint64_t deltaNs                        ///< Time to move it by.
+)
+{
+    positionPtr->stepStartNs += deltaNs;
+    if (positionPtr->endNs != SEQ_NO_DEADLINE)
+    {
+        positionPtr->endNs += deltaNs;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves to the next tone step, following loops.  The new step starts at the deadline of the
+ * current one.
+ *
+ * @return false if the end of the pattern (or its time limit) was reached (the player is then
+ *         stopped).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_Next
+(
+    seq_Player_t *playerPtr                 ///< Player.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves forward to the step that should be playing at a given time.  Steps whose deadlines have
+ * already passed are skipped without ever being played.  Whole passes through the innermost loop
+ * are skipped arithmetically, so catching up after a long stall takes no longer than catching up
+ * after a short one.
+ *
+ * @return false if the end of the pattern was reached (the player is then stopped).
+ */
+//--------------------------------------------------------------------------------------------------
+bool seq_CatchUp
+(
+    seq_Player_t *playerPtr,                ///< Player.
+    uint64_t nowNs                          ///< Current time.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stops the player.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void seq_Stop
+(
+    seq_Player_t *playerPtr                 ///< Player.
+)
+{
+    playerPtr->patternPtr = NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Switches the player to a pattern with the same shape as the one it is playing (the same
+ * operations and loops, with different durations or frequencies), carrying on from the same
+ * position in it.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void seq_ReplacePattern
+(
+    seq_Player_t *playerPtr,                ///< Player (must be playing).
+    const pattern_Pattern_t *patternPtr     ///< Pattern with the same shape.
+)
+{
+    playerPtr->patternPtr = patternPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Makes the current step last longer.  The steps after it start that much later.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void seq_Stretch
+(
+    seq_Player_t *playerPtr,                ///< Player (must be playing).
+    uint64_t deltaNs                        ///< Time to add to the step.
+)
+{
+    playerPtr->stepStartNs += deltaNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether the player is playing a pattern.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool seq_IsPlaying
+(
+    const seq_Player_t *playerPtr           ///< Player.
+)
+{
+    return (playerPtr->patternPtr != NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the frequency that should be output for the current step.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t seq_GetFreq
+(
+    const seq_Player_t *playerPtr           ///< Player (must be playing).
+)
+{
+    return playerPtr->patternPtr->steps[playerPtr->stepIndex].freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the time at which the current step ends, either because the next step starts or because
+ * the pattern's time limit is reached.
+ *
+ * @return The deadline, or SEQ_NO_DEADLINE if the step never ends.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t seq_GetDeadline
+(
+    const seq_Player_t *playerPtr           ///< Player (must be playing).
+)
+{
+    uint64_t durationNs = playerPtr->patternPtr->steps[playerPtr->stepIndex].durationNs;
+
+    if ((durationNs == PATTERN_DURATION_INFINITE) ||
+        ((playerPtr->stepStartNs + durationNs) > playerPtr->endNs))
+    {
+        return playerPtr->endNs;
+    }
+
+    return playerPtr->stepStartNs + durationNs;
+}
+
+#endif // SEQUENCER_H_INCLUDE_GUARD
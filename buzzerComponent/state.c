@@ -0,0 +1,548 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saved state.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "state.h"
+
+/// Identifies a state file ("BZST").
+#define STATE_MAGIC 0x545A5A42
+
+/// File holding an ID that is different every time the system boots.
+#define BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+
+/// Size of a boot ID (a UUID string, including the terminator).
+#define BOOT_ID_BYTES 37
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Layout of the state file.
+ *
+ * Each region has a sequence number, which is odd while the region is being written, and 0 if the
+ * region has never been (or can't be) saved.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t magic;                 ///< STATE_MAGIC.
+    uint32_t size;                  ///< Size of the file, so a change of layout is detected.
+    char bootId[BOOT_ID_BYTES];     ///< Boot ID of the system that saved the state.
+    uint32_t epoch;                 ///< Incremented by each process that opens the file.
+
+    struct
+    {
+        uint32_t seq;               ///< Sequence number.
+        uint32_t epoch;             ///< Epoch of the process that saved them.
+        state_Settings_t settings;  ///< Settings.
+    }
+    settings;
+
+    struct
+    {
+        uint32_t seq;               ///< Sequence number.
+        bool playing;               ///< false if the engine was stopped.
+        uint8_t slot;               ///< Engine slot being played (if playing).
+        seq_Position_t position;    ///< Position in the pattern (if playing).
+        pattern_Pattern_t pattern;  ///< Pattern being played (if playing).
+    }
+    playback;
+
+    struct
+    {
+        uint32_t seq;               ///< Sequence number.
+        uint32_t epoch;             ///< Epoch of the process that saved it.
+        uint32_t generation;        ///< Engine generation of the settings slot when it was paused.
+        bool finished;              ///< true if its pattern had already finished.
+        uint64_t pausedAtNs;        ///< Time at which it was paused.
+        seq_Position_t position;    ///< Position in the pattern (if not finished).
+    }
+    paused;
+}
+File_t;
+
+/// The mapped state file (NULL if state isn't being saved).
+static File_t *FilePtr = NULL;
+
+/// Path of the state file.
+static char Path[PATH_MAX];
+
+/// This process's epoch.
+static uint32_t Epoch;
+
+/// Sequence numbers last written to each region.
+static uint32_t SettingsSeq = 0;
+static uint32_t PlaybackSeq = 0;
+static uint32_t PausedSeq = 0;
+
+/// What the previous process saved (valid if the matching flag is set).
+static bool HaveSettings = false;
+static uint32_t SavedSettingsEpoch;
+static state_Settings_t SavedSettings;
+static bool HavePlayback = false;
+static bool SavedPlaying = false;
+static uint8_t SavedSlot;
+static seq_Position_t SavedPosition;
+static pattern_Pattern_t SavedPattern;
+static bool HavePaused = false;
+static uint32_t SavedPausedEpoch;
+static uint32_t SavedPausedGeneration;
+static bool SavedPausedFinished;
+static uint64_t SavedPausedAtNs;
+static seq_Position_t SavedPausedPosition;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the system's boot ID.
+ *
+ * @return true if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ReadBootId
+(
+    char *bootIdPtr     ///< [OUT] Boot ID (BOOT_ID_BYTES long).
+)
+{
+    int fd = open(BOOT_ID_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    ssize_t len;
+    do
+    {
+        len = read(fd, bootIdPtr, BOOT_ID_BYTES - 1);
+    }
+    while ((len == -1) && (errno == EINTR));
+    close(fd);
+
+    if (len != BOOT_ID_BYTES - 1)
+    {
+        return false;
+    }
+
+    bootIdPtr[BOOT_ID_BYTES - 1] = '\0';
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks that a pattern read from the file is one that could have been finished by the pattern
+ * builder, so the sequencer can safely play it.
+ *
+ * @return true if the pattern is well formed.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsWellFormed
+(
+    const pattern_Pattern_t *patternPtr
+)
+{
+    if ((patternPtr->numSteps == 0) || (patternPtr->numSteps > PATTERN_MAX_STEPS) ||
+        (patternPtr->steps[0].op != PATTERN_OP_TONE))
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < patternPtr->numSteps; i++)
+    {
+        const pattern_Step_t *stepPtr = &patternPtr->steps[i];
+
+        if ((stepPtr->op != PATTERN_OP_TONE) &&
+            ((stepPtr->op != PATTERN_OP_LOOP) || (stepPtr->loopStart >= i) ||
+             (patternPtr->steps[stepPtr->loopStart].op != PATTERN_OP_TONE)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether a region's sequence number shows that it was completely saved.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool IsSaved
+(
+    uint32_t seq
+)
+{
+    return (seq != 0) && ((seq & 1) == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Loads whatever the previous process saved in the mapped file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Load
+(
+    const char *bootIdPtr   ///< This system's boot ID.
+)
+{
+    if ((FilePtr->magic != STATE_MAGIC) || (FilePtr->size != sizeof(File_t)) ||
+        (strncmp(FilePtr->bootId, bootIdPtr, BOOT_ID_BYTES) != 0))
+    {
+        return;
+    }
+
+    if (IsSaved(FilePtr->settings.seq))
+    {
+        SavedSettingsEpoch = FilePtr->settings.epoch;
+        SavedSettings = FilePtr->settings.settings;
+        SavedSettings.patternJson[STATE_MAX_JSON_BYTES - 1] = '\0';
+        HaveSettings = true;
+        SettingsSeq = FilePtr->settings.seq;
+    }
+
+    if (IsSaved(FilePtr->playback.seq))
+    {
+        SavedPlaying = FilePtr->playback.playing;
+        SavedSlot = FilePtr->playback.slot;
+        SavedPosition = FilePtr->playback.position;
+        SavedPattern = FilePtr->playback.pattern;
+        HavePlayback = !SavedPlaying || IsWellFormed(&SavedPattern);
+        PlaybackSeq = FilePtr->playback.seq;
+    }
+
+    if (IsSaved(FilePtr->paused.seq))
+    {
+        SavedPausedEpoch = FilePtr->paused.epoch;
+        SavedPausedGeneration = FilePtr->paused.generation;
+        SavedPausedFinished = FilePtr->paused.finished;
+        SavedPausedAtNs = FilePtr->paused.pausedAtNs;
+        SavedPausedPosition = FilePtr->paused.position;
+        HavePaused = true;
+        PausedSeq = FilePtr->paused.seq;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Marks a region as being written.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void BeginSave
+(
+    uint32_t *fileSeqPtr,   ///< Sequence number in the file.
+    uint32_t *seqPtr        ///< Sequence number last written.
+)
+{
+    (*seqPtr)++;
+    __atomic_store_n(fileSeqPtr, *seqPtr, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Marks a region as completely written.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline void EndSave
+(
+    uint32_t *fileSeqPtr,   ///< Sequence number in the file.
+    uint32_t *seqPtr        ///< Sequence number last written.
+)
+{
+    (*seqPtr)++;
+    __atomic_store_n(fileSeqPtr, *seqPtr, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens (or creates) the state file, and loads whatever the previous process saved in it.  If
+ * the file can't be used, nothing is saved or loaded.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_Open
+(
+    const char *pathPtr                     ///< Path of the state file (NULL = don't save state).
+)
+{
+    if (pathPtr == NULL)
+    {
+        return;
+    }
+
+    char bootId[BOOT_ID_BYTES];
+    if (!ReadBootId(bootId))
+    {
+        LE_WARN("Can't read boot ID.  State will not be saved.");
+        return;
+    }
+
+    if (le_utf8_Copy(Path, pathPtr, sizeof(Path), NULL) != LE_OK)
+    {
+        LE_WARN("State file path too long.  State will not be saved.");
+        return;
+    }
+
+    int fd = open(Path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    struct stat st;
+    if ((fd == -1) || (fstat(fd, &st) != 0))
+    {
+        LE_WARN("Can't open state file '%s' (%m).  State will not be saved.", Path);
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return;
+    }
+
+    // A file of the wrong size was saved by a different version, so its contents are dropped.
+    if ((st.st_size != sizeof(File_t)) &&
+        ((ftruncate(fd, 0) != 0) || (ftruncate(fd, sizeof(File_t)) != 0)))
+    {
+        LE_WARN("Can't size state file '%s' (%m).  State will not be saved.", Path);
+        close(fd);
+        return;
+    }
+
+    void *mapPtr = mmap(NULL, sizeof(File_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapPtr == MAP_FAILED)
+    {
+        LE_WARN("Can't map state file '%s' (%m).  State will not be saved.", Path);
+        return;
+    }
+    FilePtr = mapPtr;
+
+    Load(bootId);
+
+    // The regions are left as they are, so if this process dies before saving anything, the
+    // next one still finds what was loaded.  Each process has an epoch of its own, as engine
+    // generations are only comparable within a process.
+    Epoch = FilePtr->epoch + 1;
+    FilePtr->magic = STATE_MAGIC;
+    FilePtr->size = sizeof(File_t);
+    memcpy(FilePtr->bootId, bootId, BOOT_ID_BYTES);
+    FilePtr->epoch = Epoch;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the settings saved by the previous process.
+ *
+ * @return true if there were any.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetSettings
+(
+    state_Settings_t *settingsPtr           ///< [OUT] Settings.
+)
+{
+    if (HaveSettings)
+    {
+        *settingsPtr = SavedSettings;
+    }
+
+    return HaveSettings;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets what the previous process was playing.
+ *
+ * @return true if the previous process saved what it was playing.  If it was stopped, the pattern
+ *         has no steps.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetPlayback
+(
+    uint8_t *slotPtr,                       ///< [OUT] Engine slot the pattern was played for.
+    pattern_Pattern_t *patternPtr,          ///< [OUT] Pattern (finished, but not checked against
+                                            ///  the output).
+    seq_Position_t *positionPtr             ///< [OUT] Position in the pattern.
+)
+{
+    if (HavePlayback)
+    {
+        if (SavedPlaying)
+        {
+            *slotPtr = SavedSlot;
+            *patternPtr = SavedPattern;
+            *positionPtr = SavedPosition;
+        }
+        else
+        {
+            patternPtr->numSteps = 0;
+        }
+    }
+
+    return HavePlayback;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets where the previous process paused the settings slot, if it was paused with the settings
+ * returned by state_GetSettings() and hasn't been forgotten since (see engine_GetGeneration()).
+ *
+ * @return true if so.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetPaused
+(
+    bool *finishedPtr,                      ///< [OUT] true if its pattern had already finished.
+    seq_Position_t *positionPtr,            ///< [OUT] Position in the pattern (if not finished).
+    uint64_t *pausedAtNsPtr                 ///< [OUT] Time at which it was paused.
+)
+{
+    if (!HaveSettings || !HavePaused || (SavedPausedEpoch != SavedSettingsEpoch) ||
+        (SavedPausedGeneration != SavedSettings.generation))
+    {
+        return false;
+    }
+
+    *finishedPtr = SavedPausedFinished;
+    *positionPtr = SavedPausedPosition;
+    *pausedAtNsPtr = SavedPausedAtNs;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves the settings.  Must always be called from the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SaveSettings
+(
+    const state_Settings_t *settingsPtr     ///< Settings (NULL = they can't be saved).
+)
+{
+    if (FilePtr == NULL)
+    {
+        return;
+    }
+
+    if (settingsPtr == NULL)
+    {
+        __atomic_store_n(&FilePtr->settings.seq, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    BeginSave(&FilePtr->settings.seq, &SettingsSeq);
+    FilePtr->settings.epoch = Epoch;
+    FilePtr->settings.settings = *settingsPtr;
+    EndSave(&FilePtr->settings.seq, &SettingsSeq);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves what is being played.  Must always be called from the same thread (matches
+ * engine_CheckpointFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePlayback
+(
+    uint8_t slot,                           ///< Engine slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+)
+{
+    if (FilePtr == NULL)
+    {
+        return;
+    }
+
+    BeginSave(&FilePtr->playback.seq, &PlaybackSeq);
+    FilePtr->playback.playing = (patternPtr != NULL);
+    if (patternPtr != NULL)
+    {
+        FilePtr->playback.slot = slot;
+        FilePtr->playback.position = *positionPtr;
+        FilePtr->playback.pattern = *patternPtr;
+    }
+    EndSave(&FilePtr->playback.seq, &PlaybackSeq);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves the position in the pattern being played, which is the same pattern as was last saved by
+ * state_SavePlayback() (matches engine_StretchFunc_t).  Must be called from the same thread as
+ * state_SavePlayback().
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePosition
+(
+    const seq_Position_t *positionPtr       ///< Position in the pattern.
+)
+{
+    if (FilePtr == NULL)
+    {
+        return;
+    }
+
+    BeginSave(&FilePtr->playback.seq, &PlaybackSeq);
+    FilePtr->playback.position = *positionPtr;
+    EndSave(&FilePtr->playback.seq, &PlaybackSeq);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves where the settings slot was paused, when another slot took over the output.  Must always
+ * be called from the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePaused
+(
+    uint32_t generation,                    ///< Engine generation of the settings slot.
+    const seq_Position_t *positionPtr,      ///< Position in the pattern (NULL if it had
+                                            ///  finished).
+    uint64_t pausedAtNs                     ///< Time at which it was paused.
+)
+{
+    if (FilePtr == NULL)
+    {
+        return;
+    }
+
+    BeginSave(&FilePtr->paused.seq, &PausedSeq);
+    FilePtr->paused.epoch = Epoch;
+    FilePtr->paused.generation = generation;
+    FilePtr->paused.finished = (positionPtr == NULL);
+    FilePtr->paused.pausedAtNs = pausedAtNs;
+    if (positionPtr != NULL)
+    {
+        FilePtr->paused.position = *positionPtr;
+    }
+    EndSave(&FilePtr->paused.seq, &PausedSeq);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deletes the state file, so that the next process starts afresh.  Used when the process is
+ * stopped on purpose.  Nothing may be saved after this.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_Discard
+(
+    void
+)
+{
+    if (FilePtr == NULL)
+    {
+        return;
+    }
+
+    // In case the file can't be deleted, it is left with nothing in it to load.
+    __atomic_store_n(&FilePtr->settings.seq, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&FilePtr->playback.seq, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&FilePtr->paused.seq, 0, __ATOMIC_RELEASE);
+    munmap(FilePtr, sizeof(File_t));
+    FilePtr = NULL;
+
+    if ((unlink(Path) != 0) && (errno != ENOENT))
+    {
+        LE_WARN("Can't delete state file '%s' (%m)", Path);
+    }
+}
@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file state.h
+ *
+ * Saved state.  The buzzer's settings, and what the edge engine is playing (including where it
+ * is in the pattern), are kept in a small memory-mapped file, so that if the process is
+ * restarted (e.g., after a fault) it can carry on exactly where it left off, without waiting for
+ * the Data Hub to push the settings again.
+ *
+ * Saving only writes to the mapped memory, so it costs no system calls.  The file should be on a
+ * tmpfs (e.g., under /tmp): it only needs to outlive the process, not the system, and step times
+ * are on the CLOCK_MONOTONIC clock, which restarts when the system does.  A file left over from
+ * before the system was restarted is ignored.
+ *
+ * The settings are saved by the main thread, and the playback by the engine's thread, each with
+ * its own sequence number, so a save cut short by a crash is detected and ignored.  The engine's
+ * thread also saves:
+ *
+ *  - Where the settings slot was paused when a request took over the output, so the settings can
+ *    carry on from there if the process is restarted while the request is being played
+ *    (requests themselves aren't saved).
+ *  - The position it is playing from each time it stretches a silence to line the next tone up
+ *    with the pattern's slack, so the pattern carries on in the same phase.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STATE_H_INCLUDE_GUARD
+#define STATE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pattern.h"
+#include "sequencer.h"
+
+/// Size of the buffer holding a pattern's JSON description (including the terminator).
+#define STATE_MAX_JSON_BYTES 2048
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Buzzer settings.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool enabled;                           ///< Whether the buzzer is enabled.
+    uint64_t periodNs;                      ///< Duty cycle period.
+    double percent;                         ///< Duty cycle on percentage.
+    uint32_t freqHz;                        ///< Duty cycle frequency.
+    uint32_t count;                         ///< Duty cycle count (0 = forever).
+    uint64_t durationNs;                    ///< Duration (0 = forever).
+    uint64_t slackNs;                       ///< Duty cycle slack.
+    uint32_t generation;                    ///< Engine generation of the settings slot (see
+                                            ///  engine_GetGeneration()).
+    char patternJson[STATE_MAX_JSON_BYTES]; ///< Pattern description ("" = play the duty cycle).
+}
+state_Settings_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens (or creates) the state file, and loads whatever the previous process saved in it.  If
+ * the file can't be used, nothing is saved or loaded.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_Open
+(
+    const char *pathPtr                     ///< Path of the state file (NULL = don't save state).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the settings saved by the previous process.
+ *
+ * @return true if there were any.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetSettings
+(
+    state_Settings_t *settingsPtr           ///< [OUT] Settings.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets what the previous process was playing.
+ *
+ * @return true if the previous process saved what it was playing.  If it was stopped, the pattern
+ *         has no steps.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetPlayback
+(
+    uint8_t *slotPtr,                       ///< [OUT] Engine slot the pattern was played for.
+    pattern_Pattern_t *patternPtr,          ///< [OUT] Pattern (finished, but not checked against
+                                            ///  the output).
+    seq_Position_t *positionPtr             ///< [OUT] Position in the pattern.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets where the previous process paused the settings slot, if it was paused with the settings
+ * returned by state_GetSettings() and hasn't been forgotten since (see engine_GetGeneration()).
+ *
+ * @return true if so.
+ */
+//--------------------------------------------------------------------------------------------------
+bool state_GetPaused
+(
+    bool *finishedPtr,                      ///< [OUT] true if its pattern had already finished.
+    seq_Position_t *positionPtr,            ///< [OUT] Position in the pattern (if not finished).
+    uint64_t *pausedAtNsPtr                 ///< [OUT] Time at which it was paused.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves the settings.  Must always be called from the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SaveSettings
+(
+    const state_Settings_t *settingsPtr     ///< Settings (NULL = they can't be saved).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves what is being played.  Must always be called from the same thread (matches
+ * engine_CheckpointFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePlayback
+(
+    uint8_t slot,                           ///< Engine slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves the position in the pattern being played, which is the same pattern as was last saved by
+ * state_SavePlayback() (matches engine_StretchFunc_t).  Must be called from the same thread as
+ * state_SavePlayback().
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePosition
+(
+    const seq_Position_t *positionPtr       ///< Position in the pattern.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saves where the settings slot was paused, when another slot took over the output.  Must always
+ * be called from the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_SavePaused
+(
+    uint32_t generation,                    ///< Engine generation of the settings slot.
+    const seq_Position_t *positionPtr,      ///< Position in the pattern (NULL if it had
+                                            ///  finished).
+    uint64_t pausedAtNs                     ///< Time at which it was paused.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deletes the state file, so that the next process starts afresh.  Used when the process is
+ * stopped on purpose.  Nothing may be saved after this.
+ */
+//--------------------------------------------------------------------------------------------------
+void state_Discard
+(
+    void
+);
+
+#endif // STATE_H_INCLUDE_GUARD
@@ -0,0 +1,696 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timing statistics.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "stats.h"
+#include "backend.h"
+#include "resource.h"
+
+// Data Hub resource paths, relative to the app's root.
+#define RES_PATH_LATENCY_P50 "stats/latency_p50"
+#define RES_PATH_LATENCY_P99 "stats/latency_p99"
+#define RES_PATH_LATENCY_MAX "stats/latency_max"
+#define RES_PATH_WRITE_P99   "stats/write_p99"
+#define RES_PATH_WRITE_MAX   "stats/write_max"
+#define RES_PATH_EDGE_RATE   "stats/edge_rate"
+#define RES_PATH_MISSED      "stats/missed_edges"
+#define RES_PATH_AVOIDED     "stats/wakeups_avoided"
+#define RES_PATH_UPDATE_RATE "stats/update_rate"
+#define RES_PATH_HANDLER     "stats/handler_time"
+#define RES_PATH_HANDLER_MAX "stats/handler_max"
+#define RES_PATH_BACKLOG     "stats/update_backlog"
+#define RES_PATH_WRITES      "stats/writes_per_update"
+#define RES_PATH_SKIPPED     "stats/skipped_writes"
+#define RES_PATH_SAVED       "stats/write_time_saved"
+#define RES_PATH_MISMATCHES  "stats/readback_mismatches"
+#define RES_PATH_STARTUP_REG "stats/startup_registered"
+#define RES_PATH_STARTUP_RDY "stats/startup_ready"
+
+/// The Data Hub inputs the statistics are published to.
+static const resource_Input_t Inputs[] =
+{
+    { RES_PATH_LATENCY_P50, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_LATENCY_P99, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_LATENCY_MAX, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_WRITE_P99, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_WRITE_MAX, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_EDGE_RATE, DHUBIO_DATA_TYPE_NUMERIC, "Hz" },
+    { RES_PATH_MISSED, DHUBIO_DATA_TYPE_NUMERIC, "" },
+    { RES_PATH_AVOIDED, DHUBIO_DATA_TYPE_NUMERIC, "" },
+    { RES_PATH_UPDATE_RATE, DHUBIO_DATA_TYPE_NUMERIC, "Hz" },
+    { RES_PATH_HANDLER, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_HANDLER_MAX, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_BACKLOG, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_WRITES, DHUBIO_DATA_TYPE_NUMERIC, "" },
+    { RES_PATH_SKIPPED, DHUBIO_DATA_TYPE_NUMERIC, "" },
+    { RES_PATH_SAVED, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_MISMATCHES, DHUBIO_DATA_TYPE_NUMERIC, "" },
+    { RES_PATH_STARTUP_REG, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+    { RES_PATH_STARTUP_RDY, DHUBIO_DATA_TYPE_NUMERIC, "s" },
+};
+
+/// Number of entries in the sample ring (must be a power of 2).
+#define RING_SIZE 1024
+
+/// Number of histogram buckets.  Values below 4 have a bucket each.  Above that, each power of 2
+/// is split into 4 buckets, up to UINT32_MAX.
+#define NUM_BUCKETS 124
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Kinds of sample.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    SAMPLE_EDGE,            ///< An edge.
+    SAMPLE_APPLY,           ///< The application of setting updates.
+    SAMPLE_HOLD,            ///< A change of the cycle being held by a single tone.
+    SAMPLE_SCHEDULED,       ///< Edges made by the output backend by itself.
+    SAMPLE_SKIP,            ///< A hardware write skipped because it would change nothing.
+    SAMPLE_MISMATCH,        ///< A read-back of the hardware that didn't match what was written.
+}
+SampleKind_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A sample, as passed through the ring.  Times are in nanoseconds, saturated to 32 bits (about 4
+ * seconds), except for the held period.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint8_t kind;           ///< SampleKind_t.
+    uint32_t latenessNs;    ///< Edge: how late it was.
+    uint32_t writeNs;       ///< Edge: how long the hardware write took.  Skip: how long a
+                            ///  hardware write takes, on average.
+    uint32_t count;         ///< Edge: number of steps missed.  Apply: number of writes.
+                            ///  Scheduled: number of edges.
+    uint64_t periodNs;      ///< Hold: period of the cycle being held (0 = none).
+}
+Sample_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A histogram of nanosecond times.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t counts[NUM_BUCKETS];   ///< Number of samples in each bucket.
+    uint32_t total;                 ///< Number of samples.
+    uint32_t max;                   ///< Largest sample.
+}
+Histogram_t;
+
+/// true if statistics are being collected.  Only written before the first sample is recorded.
+static bool Enabled = false;
+
+/// The sample ring.  RingHead is only written by the producer, RingTail only by the consumer.
+/// Both count samples from the start, and wrap around naturally.
+static Sample_t Ring[RING_SIZE];
+static uint32_t RingHead = 0;
+static uint32_t RingTail = 0;
+
+/// true if the consumer has been asked to empty the ring, and hasn't started yet.
+static bool DrainQueued = false;
+
+/// Number of samples that were dropped because the ring was full.
+static uint32_t DroppedCount = 0;
+
+/// Thread that empties the ring and publishes the statistics.
+static le_thread_Ref_t ConsumerThread;
+
+/// Histograms and counters for the current interval.
+static Histogram_t LatenessHistogram;
+static Histogram_t WriteHistogram;
+static uint64_t EdgeCount;
+static uint64_t MissedCount;
+static uint64_t UpdateCount;
+static uint64_t HandlerTotalNs;
+static uint64_t HandlerMaxNs;
+static double BacklogMaxSec;
+static uint64_t ApplyWriteCount;
+static uint64_t AvoidedCount;
+static uint64_t SkippedCount;
+static uint64_t SavedNs;
+static uint64_t MismatchCount;
+static uint64_t IntervalStartNs;
+
+/// Cycle being held by a single tone (period 0 if none), and when the part of it that hasn't been
+/// counted in AvoidedCount yet started.
+static uint64_t HeldPeriodNs = 0;
+static uint64_t HeldSinceNs;
+
+/// true once the Data Hub inputs have been created.
+static bool InputsCreated = false;
+
+/// Start-up times (since the process started), and whether they are waiting to be published.
+static bool StartupPending = false;
+static uint64_t StartupRegisteredNs;
+static uint64_t StartupReadyNs;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the index of the bucket a value belongs in.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t BucketOf
+(
+    uint32_t value
+)
+{
+    if (value < 4)
+    {
+        return value;
+    }
+
+    uint32_t msb = 31 - (uint32_t)__builtin_clz(value);
+    uint32_t sub = (value >> (msb - 2)) & 3;
+
+    return ((msb - 1) * 4) + sub;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the largest value that belongs in a bucket.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t BucketMax
+(
+    uint32_t bucket
+)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+
+    uint32_t msb = (bucket / 4) + 1;
+    uint64_t width = 1ULL << (msb - 2);
+
+    return ((4 + (bucket % 4)) * width) + width - 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a value to a histogram.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToHistogram
+(
+    Histogram_t *histogramPtr,
+    uint32_t value
+)
+{
+    histogramPtr->counts[BucketOf(value)]++;
+    histogramPtr->total++;
+    if (value > histogramPtr->max)
+    {
+        histogramPtr->max = value;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a percentile from a histogram.  The result is the top of the bucket the percentile falls
+ * in (but never more than the largest sample), so it errs on the high side by less than 25%.
+ *
+ * @return The percentile, or 0 if the histogram is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetPercentile
+(
+    const Histogram_t *histogramPtr,
+    uint32_t percent
+)
+{
+    uint64_t rank = (((uint64_t)histogramPtr->total * percent) + 99) / 100;
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; (i < NUM_BUCKETS) && (rank > 0); i++)
+    {
+        seen += histogramPtr->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t value = BucketMax(i);
+            return (value < histogramPtr->max) ? value : histogramPtr->max;
+        }
+    }
+
+    return histogramPtr->max;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saturates a time to 32 bits.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t Saturate
+(
+    uint64_t value
+)
+{
+    return (value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counts the cycles that have gone by while being held by a single tone, each of which would
+ * otherwise have woken the engine up.  Consumer side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountHeldCycles
+(
+    uint64_t nowNs
+)
+{
+    if ((HeldPeriodNs != 0) && (nowNs > HeldSinceNs))
+    {
+        uint64_t cycles = (nowNs - HeldSinceNs) / HeldPeriodNs;
+        AvoidedCount += cycles;
+        HeldSinceNs += cycles * HeldPeriodNs;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Empties the ring into the histograms.  Consumer side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Drain
+(
+    void
+)
+{
+    // Cleared before looking at the ring, so a sample added from now on can queue another drain.
+    __atomic_store_n(&DrainQueued, false, __ATOMIC_RELAXED);
+
+    uint32_t head = __atomic_load_n(&RingHead, __ATOMIC_ACQUIRE);
+    uint32_t tail = RingTail;
+
+    while (tail != head)
+    {
+        const Sample_t *samplePtr = &Ring[tail & (RING_SIZE - 1)];
+
+        switch (samplePtr->kind)
+        {
+            case SAMPLE_EDGE:
+                AddToHistogram(&LatenessHistogram, samplePtr->latenessNs);
+                AddToHistogram(&WriteHistogram, samplePtr->writeNs);
+                MissedCount += samplePtr->count;
+                EdgeCount++;
+                break;
+
+            case SAMPLE_APPLY:
+                ApplyWriteCount += samplePtr->count;
+                break;
+
+            case SAMPLE_HOLD:
+            {
+                // Hold changes are drained as soon as they are recorded, so they can be taken to
+                // have happened now.
+                uint64_t nowNs = backend_GetMonotonicNs();
+                CountHeldCycles(nowNs);
+                HeldPeriodNs = samplePtr->periodNs;
+                HeldSinceNs = nowNs;
+                break;
+            }
+
+            case SAMPLE_SCHEDULED:
+                AvoidedCount += samplePtr->count;
+                break;
+
+            case SAMPLE_SKIP:
+                SkippedCount++;
+                SavedNs += samplePtr->writeNs;
+                break;
+
+            case SAMPLE_MISMATCH:
+                MismatchCount++;
+                break;
+        }
+        tail++;
+    }
+
+    __atomic_store_n(&RingTail, tail, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deferred function used to empty the ring before it fills up.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DrainDeferred
+(
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    Drain();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Converts nanoseconds to seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double NsToSec
+(
+    uint64_t ns
+)
+{
+    return (double)ns / 1000000000.0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish timer expiry handler function.  Publishes a summary of the interval that has just
+ * ended, and starts a new one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishTimerExpiryHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    Drain();
+
+    resource_CreateInputs(Inputs, NUM_ARRAY_MEMBERS(Inputs), &InputsCreated);
+
+    if (StartupPending)
+    {
+        dhubIO_PushNumeric(RES_PATH_STARTUP_REG, DHUBIO_NOW, NsToSec(StartupRegisteredNs));
+        dhubIO_PushNumeric(RES_PATH_STARTUP_RDY, DHUBIO_NOW, NsToSec(StartupReadyNs));
+        StartupPending = false;
+    }
+
+    uint64_t nowNs = backend_GetMonotonicNs();
+    uint64_t intervalNs = nowNs - IntervalStartNs;
+    double intervalSec = NsToSec(intervalNs);
+
+    dhubIO_PushNumeric(RES_PATH_LATENCY_P50, DHUBIO_NOW,
+                       NsToSec(GetPercentile(&LatenessHistogram, 50)));
+    dhubIO_PushNumeric(RES_PATH_LATENCY_P99, DHUBIO_NOW,
+                       NsToSec(GetPercentile(&LatenessHistogram, 99)));
+    dhubIO_PushNumeric(RES_PATH_LATENCY_MAX, DHUBIO_NOW, NsToSec(LatenessHistogram.max));
+    dhubIO_PushNumeric(RES_PATH_WRITE_P99, DHUBIO_NOW,
+                       NsToSec(GetPercentile(&WriteHistogram, 99)));
+    dhubIO_PushNumeric(RES_PATH_WRITE_MAX, DHUBIO_NOW, NsToSec(WriteHistogram.max));
+    dhubIO_PushNumeric(RES_PATH_EDGE_RATE, DHUBIO_NOW,
+                       (intervalNs > 0) ? ((double)EdgeCount / intervalSec) : 0);
+    dhubIO_PushNumeric(RES_PATH_MISSED, DHUBIO_NOW, (double)MissedCount);
+    CountHeldCycles(nowNs);
+    dhubIO_PushNumeric(RES_PATH_AVOIDED, DHUBIO_NOW, (double)AvoidedCount);
+
+    dhubIO_PushNumeric(RES_PATH_UPDATE_RATE, DHUBIO_NOW,
+                       (intervalNs > 0) ? ((double)UpdateCount / intervalSec) : 0);
+    dhubIO_PushNumeric(RES_PATH_HANDLER, DHUBIO_NOW,
+                       (UpdateCount > 0) ? (NsToSec(HandlerTotalNs) / (double)UpdateCount) : 0);
+    dhubIO_PushNumeric(RES_PATH_HANDLER_MAX, DHUBIO_NOW, NsToSec(HandlerMaxNs));
+    dhubIO_PushNumeric(RES_PATH_BACKLOG, DHUBIO_NOW, BacklogMaxSec);
+    dhubIO_PushNumeric(RES_PATH_WRITES, DHUBIO_NOW,
+                       (UpdateCount > 0) ? ((double)ApplyWriteCount / (double)UpdateCount) : 0);
+
+    dhubIO_PushNumeric(RES_PATH_SKIPPED, DHUBIO_NOW, (double)SkippedCount);
+    dhubIO_PushNumeric(RES_PATH_SAVED, DHUBIO_NOW, NsToSec(SavedNs));
+    dhubIO_PushNumeric(RES_PATH_MISMATCHES, DHUBIO_NOW, (double)MismatchCount);
+
+    uint32_t droppedCount = __atomic_exchange_n(&DroppedCount, 0, __ATOMIC_RELAXED);
+    if (droppedCount > 0)
+    {
+        LE_WARN("%" PRIu32 " edge timing samples were dropped", droppedCount);
+    }
+
+    memset(&LatenessHistogram, 0, sizeof(LatenessHistogram));
+    memset(&WriteHistogram, 0, sizeof(WriteHistogram));
+    EdgeCount = 0;
+    MissedCount = 0;
+    AvoidedCount = 0;
+    UpdateCount = 0;
+    HandlerTotalNs = 0;
+    HandlerMaxNs = 0;
+    BacklogMaxSec = 0;
+    ApplyWriteCount = 0;
+    SkippedCount = 0;
+    SavedNs = 0;
+    MismatchCount = 0;
+    IntervalStartNs = nowNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts collecting statistics, and starts publishing them.  The Data Hub inputs are created when
+ * the first summary is published, so this doesn't wait for the Data Hub.  Must be called from the
+ * thread that will publish them.  Until this is called (or if publishMs is 0), stats_RecordEdge()
+ * does nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_Init
+(
+    uint32_t publishMs          ///< Interval between summaries (0 = don't collect statistics).
+)
+{
+    if (publishMs == 0)
+    {
+        return;
+    }
+
+    ConsumerThread = le_thread_GetCurrent();
+    IntervalStartNs = backend_GetMonotonicNs();
+
+    le_timer_Ref_t timer = le_timer_Create("Stats Publish");
+    le_timer_SetMsInterval(timer, publishMs);
+    le_timer_SetRepeat(timer, 0 /* number of iterations, where 0 = infinity */);
+    le_timer_SetHandler(timer, PublishTimerExpiryHandler);
+    le_timer_Start(timer);
+
+    Enabled = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a sample to the ring.  Producer side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Record
+(
+    const Sample_t *samplePtr
+)
+{
+    if (!Enabled)
+    {
+        return;
+    }
+
+    uint32_t head = RingHead;
+    uint32_t tail = __atomic_load_n(&RingTail, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) >= RING_SIZE)
+    {
+        __atomic_fetch_add(&DroppedCount, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    Ring[head & (RING_SIZE - 1)] = *samplePtr;
+
+    __atomic_store_n(&RingHead, head + 1, __ATOMIC_RELEASE);
+
+    // Get the consumer to empty the ring well before it fills up (or as soon as the held cycle
+    // changes), rather than waiting for the next summary.  This is rare, so the cost of queueing
+    // doesn't matter.
+    if ((((head + 1 - tail) >= (RING_SIZE / 2)) || (samplePtr->kind == SAMPLE_HOLD)) &&
+        !__atomic_exchange_n(&DrainQueued, true, __ATOMIC_RELAXED))
+    {
+        le_event_QueueFunctionToThread(ConsumerThread, DrainDeferred, NULL, NULL);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the timing of an edge.  Producer side.  Safe to call from a different thread than the
+ * one that publishes the statistics, as long as it is always the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordEdge
+(
+    uint64_t latenessNs,        ///< How long after its deadline the edge was handled.
+    uint64_t writeNs,           ///< How long the hardware write took (0 if nothing was written).
+    uint32_t missedCount        ///< Number of steps missed before this edge.
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_EDGE,
+        .latenessNs = Saturate(latenessNs),
+        .writeNs = Saturate(writeNs),
+        .count = missedCount,
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the hardware writes made to apply a batch of setting updates.  Producer side (must be
+ * called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordApply
+(
+    uint64_t writeCount         ///< Number of hardware writes.
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_APPLY,
+        .count = Saturate(writeCount),
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records that a cycle is now being held by a single tone (e.g., a duty cycle of 0% or 100%), so
+ * the engine isn't woken up at the end of each cycle, or that it no longer is.  Producer side
+ * (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordHold
+(
+    uint64_t periodNs           ///< Period of the cycle (0 = none is being held any more).
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_HOLD,
+        .periodNs = periodNs,
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records edges that the output backend made by itself, without waking the engine up.  Producer
+ * side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordScheduled
+(
+    uint64_t edgeCount          ///< Number of edges made.
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_SCHEDULED,
+        .count = Saturate(edgeCount),
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a hardware write that was skipped, because the output was already set to what it would
+ * have written.  Producer side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordSkip
+(
+    uint64_t meanWriteNs        ///< How long a hardware write takes, on average.
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_SKIP,
+        .writeNs = Saturate(meanWriteNs),
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a read-back of the hardware that didn't match what was last written to it (so it was
+ * written again).  Producer side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordMismatch
+(
+    void
+)
+{
+    Sample_t sample =
+    {
+        .kind = SAMPLE_MISMATCH,
+    };
+
+    Record(&sample);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the handling of a setting update.  Must be called from the thread that publishes the
+ * statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordUpdate
+(
+    double timestamp,           ///< Data Hub timestamp of the update (seconds since the Epoch).
+    uint64_t handlerNs          ///< Time spent in the push handler.
+)
+{
+    if (!Enabled)
+    {
+        return;
+    }
+
+    UpdateCount++;
+    HandlerTotalNs += handlerNs;
+    if (handlerNs > HandlerMaxNs)
+    {
+        HandlerMaxNs = handlerNs;
+    }
+
+    // Data Hub timestamps are wall clock times, so the backlog has to be measured on that clock.
+    struct timespec now;
+    if ((timestamp > 0) && (clock_gettime(CLOCK_REALTIME, &now) == 0))
+    {
+        double backlogSec = ((double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0)) - timestamp;
+        if (backlogSec > BacklogMaxSec)
+        {
+            BacklogMaxSec = backlogSec;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records how long start-up took.  They are published with the first summary.  Must be called
+ * from the thread that publishes the statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordStartup
+(
+    uint64_t registeredNs,      ///< Time from the process starting to the first Data Hub resource
+                                ///  being registered.
+    uint64_t readyNs            ///< Time from the process starting to being ready.
+)
+{
+    if (!Enabled)
+    {
+        return;
+    }
+
+    StartupRegisteredNs = registeredNs;
+    StartupReadyNs = readyNs;
+    StartupPending = true;
+}
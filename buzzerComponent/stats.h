@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file stats.h
+ *
+ * Timing statistics.
+ *
+ * Each edge played from the timer records how late it was (relative to its intended deadline),
+ * how long the hardware write took, and how many steps were missed.  Samples are passed through
+ * a lock-free single-producer/single-consumer ring, so recording never blocks and never
+ * allocates, and are folded into fixed-bucket histograms by the event loop.
+ *
+ * At a configurable (low) rate, a summary of the histograms is published as Data Hub inputs:
+ *
+ *  - stats/latency_p50, stats/latency_p99, stats/latency_max: edge lateness (s).
+ *  - stats/write_p99, stats/write_max: time taken to write the hardware (s).
+ *  - stats/edge_rate: edges played per second (Hz).
+ *  - stats/missed_edges: steps that ended before they could be played.
+ *  - stats/wakeups_avoided: cycles that went by without waking the engine up, because the cycle
+ *    was held by a single tone (e.g., a duty cycle of 0% or 100%), and edges that the output
+ *    backend made by itself, from a batch scheduled by the engine.
+ *
+ * Setting updates received from the Data Hub are also measured, to show whether the component
+ * keeps up when controllers send bursts of updates:
+ *
+ *  - stats/update_rate: setting updates received per second (Hz).
+ *  - stats/handler_time, stats/handler_max: mean and longest time spent in a push handler (s).
+ *  - stats/update_backlog: longest time between an update being pushed to the Data Hub and its
+ *    handler running (s).  This grows if the event loop falls behind.
+ *  - stats/writes_per_update: hardware writes made to apply the updates, per update.
+ *
+ * Writes to the hardware are kept down by skipping those that would change nothing, and checked
+ * by reading the hardware back (if enabled):
+ *
+ *  - stats/skipped_writes: hardware writes skipped.
+ *  - stats/write_time_saved: estimate of the time the skipped writes would have taken: their
+ *    number times the mean time taken by a write (s).
+ *  - stats/readback_mismatches: read-backs that found the hardware had been changed behind the
+ *    component's back (so it was written again).
+ *
+ * How long start-up took is published once, with the first summary:
+ *
+ *  - stats/startup_registered: time from the process starting to the first Data Hub resource
+ *    being registered (s).
+ *  - stats/startup_ready: time from the process starting to the buzzer being ready (s).
+ *
+ * The histograms and counters are cleared after each summary, so each one covers a single
+ * interval.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STATS_H_INCLUDE_GUARD
+#define STATS_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts collecting statistics, and starts publishing them.  The Data Hub inputs are created when
+ * the first summary is published, so this doesn't wait for the Data Hub.  Must be called from the
+ * thread that will publish them.  Until this is called (or if publishMs is 0), stats_RecordEdge()
+ * does nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_Init
+(
+    uint32_t publishMs          ///< Interval between summaries (0 = don't collect statistics).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the timing of an edge.  Safe to call from a different thread than the one that
+ * publishes the statistics, as long as it is always the same thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordEdge
+(
+    uint64_t latenessNs,        ///< How long after its deadline the edge was handled.
+    uint64_t writeNs,           ///< How long the hardware write took (0 if nothing was written).
+    uint32_t missedCount        ///< Number of steps missed before this edge.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records edges that the output backend made by itself, without waking the engine up.  Producer
+ * side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordScheduled
+(
+    uint64_t edgeCount          ///< Number of edges made.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a hardware write that was skipped, because the output was already set to what it would
+ * have written.  Producer side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordSkip
+(
+    uint64_t meanWriteNs        ///< How long a hardware write takes, on average.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a read-back of the hardware that didn't match what was last written to it (so it was
+ * written again).  Producer side (must be called from the thread that records edges).
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordMismatch
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the handling of a setting update.  Must be called from the thread that publishes the
+ * statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordUpdate
+(
+    double timestamp,           ///< Data Hub timestamp of the update (seconds since the Epoch).
+    uint64_t handlerNs          ///< Time spent in the push handler.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the hardware writes made to apply a batch of setting updates.  Must be called from the
+ * thread that records edges.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordApply
+(
+    uint64_t writeCount         ///< Number of hardware writes.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records that a cycle is now being held by a single tone (e.g., a duty cycle of 0% or 100%), so
+ * the engine isn't woken up at the end of each cycle, or that it no longer is.  Must be called
+ * from the thread that records edges.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordHold
+(
+    uint64_t periodNs           ///< Period of the cycle (0 = none is being held any more).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records how long start-up took.  They are published with the first summary.  Must be called
+ * from the thread that publishes the statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+void stats_RecordStartup
+(
+    uint64_t registeredNs,      ///< Time from the process starting to the first Data Hub resource
+                                ///  being registered.
+    uint64_t readyNs            ///< Time from the process starting to being ready.
+);
+
+#endif // STATS_H_INCLUDE_GUARD
@@ -0,0 +1,414 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Buzzer status.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include <sched.h>
+
+#include "status.h"
+#include "arbiter.h"
+#include "backend.h"
+#include "resource.h"
+
+// Data Hub resource paths, relative to the app's root.
+#define RES_PATH_ACTIVE "active"
+#define RES_PATH_STATE  "state"
+
+/// Longest state description (including the terminator).
+#define MAX_STATE_BYTES 192
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * What the engine reported it is playing.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool playing;                   ///< false if the engine is stopped.
+    uint8_t slot;                   ///< Slot being played (if playing).
+    seq_Position_t position;        ///< Position in the pattern (if playing).
+    pattern_Pattern_t pattern;      ///< Pattern being played (if playing).
+}
+Record_t;
+
+/// true if the status is being published.  Only written before the first record.
+static bool Enabled = false;
+
+/// The latest record.  Only written by the recording thread, with RecordSeq odd while it is being
+/// written, so the publishing thread can tell if it has read a half-written one.
+static Record_t Record;
+static uint32_t RecordSeq = 0;
+
+/// true if the publishing thread has been told about a record, and hasn't looked at it yet.
+static bool RecordQueued = false;
+
+/// Thread that publishes the status.
+static le_thread_Ref_t PublishThread;
+
+/// Timer that limits how often the status is published.  It runs for as long as what is being
+/// played can change without a new record (so the step and frequency are kept up to date), and
+/// for one interval after each update.
+static le_timer_Ref_t IntervalTimer;
+
+/// Shortest interval between updates.
+static uint64_t IntervalNs;
+
+/// Publishing side: sequence number of the record last read, and the pattern being played (in
+/// Pattern, as Player's pattern) as of then, moved forward each time the status is published.
+static uint32_t ReadSeq = 0;
+static uint8_t Slot;
+static pattern_Pattern_t Pattern;
+static uint32_t PatternHash;
+static seq_Player_t Player;
+
+/// The Data Hub inputs, and whether they have been created.
+static const resource_Input_t Inputs[] =
+{
+    { RES_PATH_ACTIVE, DHUBIO_DATA_TYPE_BOOLEAN, "" },
+    { RES_PATH_STATE, DHUBIO_DATA_TYPE_JSON, "" },
+};
+static bool InputsCreated = false;
+
+/// Values last pushed to the inputs.
+static bool PushedActive = false;
+static char PushedState[MAX_STATE_BYTES] = "";
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Works out a short hash of a pattern's steps, by which it can be told apart from other patterns.
+ *
+ * @return The hash.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t HashPattern
+(
+    const pattern_Pattern_t *patternPtr     ///< Pattern.
+)
+{
+    // 32-bit FNV-1a, over the fields of each step (not the padding between them).
+    uint32_t hash = 2166136261U;
+
+    for (uint16_t i = 0; i < patternPtr->numSteps; i++)
+    {
+        const pattern_Step_t *stepPtr = &patternPtr->steps[i];
+        uint64_t fields[] = { stepPtr->op, stepPtr->durationNs, stepPtr->freqHz,
+                              stepPtr->loopStart, stepPtr->loopCount };
+
+        for (size_t f = 0; f < NUM_ARRAY_MEMBERS(fields); f++)
+        {
+            for (int shift = 0; shift < 64; shift += 8)
+            {
+                hash ^= (uint8_t)(fields[f] >> shift);
+                hash *= 16777619U;
+            }
+        }
+    }
+
+    return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Picks up the latest record, if there is a new one.  Publishing side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadRecord
+(
+    void
+)
+{
+    static Record_t record;
+    uint32_t seq;
+
+    for (;;)
+    {
+        seq = __atomic_load_n(&RecordSeq, __ATOMIC_ACQUIRE);
+        if (seq == ReadSeq)
+        {
+            return;
+        }
+        if ((seq & 1) != 0)
+        {
+            // Being written.  The writer never waits for anything, so this is brief.
+            sched_yield();
+            continue;
+        }
+
+        memcpy(&record, &Record, sizeof(record));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&RecordSeq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+    }
+
+    ReadSeq = seq;
+    seq_Stop(&Player);
+
+    if (record.playing)
+    {
+        Slot = record.slot;
+        Pattern = record.pattern;
+        PatternHash = HashPattern(&Pattern);
+        if (!seq_Resume(&Player, &Pattern, &record.position))
+        {
+            seq_Stop(&Player);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds the outermost loop around the step being played that goes round at least once per
+ * interval.  The steps in such a loop can't be published one by one (sampled once per interval,
+ * they would seem to flicker at random), so the loop is published as a whole.  Publishing side.
+ *
+ * @return true if there is such a loop.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool FindCyclingLoop
+(
+    uint16_t *loopIndexPtr          ///< [OUT] Index of the loop step.
+)
+{
+    bool found = false;
+
+    // The loops around a step are the loop steps after it whose bodies it is in, met from the
+    // innermost out.  Each takes at least as long to go round as the one inside it.
+    for (uint16_t i = Player.stepIndex + 1; i < Pattern.numSteps; i++)
+    {
+        const pattern_Step_t *stepPtr = &Pattern.steps[i];
+        if ((stepPtr->op != PATTERN_OP_LOOP) || (stepPtr->loopStart > Player.stepIndex))
+        {
+            continue;
+        }
+
+        uint64_t passNs;
+        uint64_t toneCount;
+        if (!pattern_GetRunLength(&Pattern, stepPtr->loopStart, i, &passNs, &toneCount) ||
+            (passNs > IntervalNs))
+        {
+            break;
+        }
+
+        *loopIndexPtr = i;
+        found = true;
+    }
+
+    return found;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the highest frequency output by a run of steps.
+ *
+ * @return The frequency (0 if they are all silent).
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GetTopFreq
+(
+    uint16_t start,                 ///< First step of the run.
+    uint16_t end                    ///< Step after the last step of the run.
+)
+{
+    uint32_t freqHz = 0;
+
+    for (uint16_t i = start; i < end; i++)
+    {
+        if ((Pattern.steps[i].op == PATTERN_OP_TONE) && (Pattern.steps[i].freqHz > freqHz))
+        {
+            freqHz = Pattern.steps[i].freqHz;
+        }
+    }
+
+    return freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publishes the status, pushing only the inputs whose values have changed.  Publishing side.
+ *
+ * @return true if the status can change before the next record is made, or has just been pushed
+ *         (in either case, the interval timer must be kept running).
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Publish
+(
+    void
+)
+{
+    char state[MAX_STATE_BYTES];
+    bool changing = false;
+
+    ReadRecord();
+
+    // The player is only moved forward from where it was last time, and whole passes through
+    // loops are skipped in one go, so this costs little however long it has been.
+    bool active = seq_IsPlaying(&Player) && seq_CatchUp(&Player, backend_GetMonotonicNs());
+    if (active)
+    {
+        uint16_t step = Player.stepIndex;
+        uint32_t freqHz = seq_GetFreq(&Player);
+        const char *phasePtr = (freqHz != 0) ? "on" : "off";
+        uint16_t loopIndex;
+
+        if (FindCyclingLoop(&loopIndex))
+        {
+            // Nothing changes until the loop comes to its end, if it ever does.
+            step = loopIndex;
+            freqHz = GetTopFreq(Pattern.steps[loopIndex].loopStart, loopIndex);
+            phasePtr = "cycling";
+            changing = (Pattern.steps[loopIndex].loopCount != 0) ||
+                       (Player.endNs != SEQ_NO_DEADLINE);
+        }
+        else
+        {
+            // A step that is held until something changes (e.g., a duty cycle of 0% or 100%)
+            // needs no more updates.
+            changing = (seq_GetDeadline(&Player) != SEQ_NO_DEADLINE);
+        }
+
+        snprintf(state, sizeof(state),
+                 "{\"active\":true,\"slot\":\"%s\",\"pattern\":\"%08" PRIx32 "\","
+                 "\"step\":%" PRIu16 ",\"freq\":%" PRIu32 ",\"phase\":\"%s\"}",
+                 arbiter_GetName(Slot), PatternHash, step, freqHz, phasePtr);
+    }
+    else
+    {
+        snprintf(state, sizeof(state), "{\"active\":false}");
+    }
+
+    if (resource_CreateInputs(Inputs, NUM_ARRAY_MEMBERS(Inputs), &InputsCreated))
+    {
+        PushedActive = !active;
+    }
+
+    bool pushed = false;
+    if (active != PushedActive)
+    {
+        dhubIO_PushBoolean(RES_PATH_ACTIVE, DHUBIO_NOW, active);
+        PushedActive = active;
+        pushed = true;
+    }
+    if (strcmp(state, PushedState) != 0)
+    {
+        dhubIO_PushJson(RES_PATH_STATE, DHUBIO_NOW, state);
+        le_utf8_Copy(PushedState, state, sizeof(PushedState), NULL);
+        pushed = true;
+    }
+
+    return changing || pushed;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Interval timer expiry handler function.  Publishing side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void IntervalTimerExpiryHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    // Once what is being played can't change (and that has been published), there is nothing to
+    // keep up to date until the next record.
+    if (!Publish())
+    {
+        le_timer_Stop(timer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deferred function used to look at a new record.  Publishing side.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordDeferred
+(
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    // Cleared before looking at the record, so a record made from now on queues another call.
+    __atomic_store_n(&RecordQueued, false, __ATOMIC_RELAXED);
+
+    // If the timer is running, the record is published when it next expires, so updates are
+    // never closer together than the interval.
+    if (!le_timer_IsRunning(IntervalTimer) && Publish())
+    {
+        le_timer_Start(IntervalTimer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts publishing the status.  The Data Hub inputs are created when the status is first
+ * published, so this doesn't wait for the Data Hub.  Must be called from the thread that will
+ * publish it (which must also be the one the arbiter is used on).  Until this is called (or if
+ * minIntervalMs is 0), status_Record() does nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+void status_Init
+(
+    uint32_t minIntervalMs          ///< Shortest interval between updates (0 = don't publish).
+)
+{
+    if (minIntervalMs == 0)
+    {
+        return;
+    }
+
+    PublishThread = le_thread_GetCurrent();
+    IntervalNs = (uint64_t)minIntervalMs * 1000000;
+
+    IntervalTimer = le_timer_Create("Status Publish");
+    le_timer_SetMsInterval(IntervalTimer, minIntervalMs);
+    le_timer_SetRepeat(IntervalTimer, 0 /* number of iterations, where 0 = infinity */);
+    le_timer_SetHandler(IntervalTimer, IntervalTimerExpiryHandler);
+
+    Enabled = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records what the engine is now playing.  Must always be called from the same thread (matches
+ * engine_CheckpointFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void status_Record
+(
+    uint8_t slot,                           ///< Engine slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+)
+{
+    if (!Enabled)
+    {
+        return;
+    }
+
+    uint32_t seq = __atomic_load_n(&RecordSeq, __ATOMIC_RELAXED);
+    __atomic_store_n(&RecordSeq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    Record.playing = (patternPtr != NULL);
+    if (patternPtr != NULL)
+    {
+        Record.slot = slot;
+        Record.position = *positionPtr;
+        Record.pattern = *patternPtr;
+    }
+
+    __atomic_store_n(&RecordSeq, seq + 2, __ATOMIC_RELEASE);
+
+    if (!__atomic_exchange_n(&RecordQueued, true, __ATOMIC_RELAXED))
+    {
+        le_event_QueueFunctionToThread(PublishThread, RecordDeferred, NULL, NULL);
+    }
+}
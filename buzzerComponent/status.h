@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file status.h
+ *
+ * Buzzer status.  What the edge engine is actually playing is published as Data Hub inputs, so
+ * that other apps (and the Data Hub's own tools) can see whether the buzzer is sounding:
+ *
+ *  - active: true while a pattern (or duty cycle) is being played, false once it is stopped or
+ *    has come to its end.
+ *  - state: JSON description of what is being played, e.g.,
+ *    {"active":true,"slot":"settings","pattern":"5d0c2a91","step":1,"freq":0,"phase":"off"},
+ *    where:
+ *     - slot is the request slot being played (see arbiter.h).
+ *     - pattern is a hash of the pattern's steps, which changes when a different pattern (or
+ *       duty cycle) is played.
+ *     - step is the index of the step being played.
+ *     - freq is the frequency being output (0 = silent).
+ *     - phase is "on" while a tone is output and "off" during a silence.  It is "cycling" while
+ *       in a loop that goes round at least once per interval, whose steps would seem to flicker
+ *       at random if they were published one by one.  Step is then the index of the loop step,
+ *       and freq the highest frequency in the loop, so nothing changes until the loop ends.
+ *    Just {"active":false} when nothing is being played.
+ *
+ * Nothing is published per edge.  The engine reports what it is playing each time that changes
+ * (see engine_CheckpointFunc_t), and the step and frequency are worked out from that when the
+ * status is published, so a 10 ms cycle costs nothing here.  Each input is only pushed when its
+ * value changes, and at most once per interval: changes that arrive within the interval are
+ * folded into a single update at the end of it.  Once what is being played can't change without
+ * the engine reporting it (a held tone, a loop that cycles forever, or nothing at all), the
+ * status isn't looked at again until it does.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STATUS_H_INCLUDE_GUARD
+#define STATUS_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pattern.h"
+#include "sequencer.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Starts publishing the status.  The Data Hub inputs are created when the status is first
+ * published, so this doesn't wait for the Data Hub.  Must be called from the thread that will
+ * publish it (which must also be the one the arbiter is used on).  Until this is called (or if
+ * minIntervalMs is 0), status_Record() does nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+void status_Init
+(
+    uint32_t minIntervalMs          ///< Shortest interval between updates (0 = don't publish).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records what the engine is now playing.  Must always be called from the same thread (matches
+ * engine_CheckpointFunc_t).
+ */
+//--------------------------------------------------------------------------------------------------
+void status_Record
+(
+    uint8_t slot,                           ///< Engine slot being played (if not stopped).
+    const pattern_Pattern_t *patternPtr,    ///< Pattern being played (NULL if stopped).
+    const seq_Position_t *positionPtr       ///< Position in the pattern (NULL if stopped).
+);
+
+#endif // STATUS_H_INCLUDE_GUARD
@@ -0,0 +1,561 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimal io_uring access.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "uring.h"
+
+#include <sys/syscall.h>
+
+// The ring is only built if the headers know about io_uring, and about everything used here
+// (IORING_OP_WRITE and IORING_REGISTER_PROBE came in along with IORING_FEAT_RW_CUR_POS).
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+
+#include <sys/mman.h>
+
+/// Number of operations asked about when probing the kernel.
+#define PROBE_OPS 64
+
+/// The ring's file descriptor (-1 if not set up).
+static int RingFd = -1;
+
+/// Mappings shared with the kernel.
+static void *SqRingPtr = MAP_FAILED;
+static size_t SqRingBytes;
+static void *CqRingPtr = MAP_FAILED;
+static size_t CqRingBytes;
+static struct io_uring_sqe *SqesPtr = MAP_FAILED;
+static size_t SqesBytes;
+
+/// Submission queue, in SqRingPtr.
+static uint32_t *SqTailPtr;
+static uint32_t *SqHeadPtr;
+static uint32_t *SqArrayPtr;
+static uint32_t SqMask;
+static uint32_t SqEntries;
+
+/// Completion queue, in CqRingPtr.
+static uint32_t *CqTailPtr;
+static uint32_t *CqHeadPtr;
+static struct io_uring_cqe *CqesPtr;
+static uint32_t CqMask;
+
+/// Number of entries queued, but not yet handed to the kernel.
+static uint32_t UnsubmittedCount = 0;
+
+/// true if the kernel can time writes.
+static bool TimedWritesSupported = false;
+
+/// Write at the end of the chain of timed writes, if it hasn't been handed to the kernel yet (so
+/// the next timed write can be linked to it), or NULL.
+static struct io_uring_sqe *ChainEndPtr = NULL;
+
+/// Times waited for by timed writes, by submission queue entry.  The kernel reads them when the
+/// entries are handed to it.
+static struct __kernel_timespec Times[URING_MAX_ENTRIES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks which of the operations used here the kernel supports.
+ *
+ * @return true if it supports writes.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Probe
+(
+    void
+)
+{
+    static union
+    {
+        struct io_uring_probe probe;
+        uint8_t bytes[sizeof(struct io_uring_probe) +
+                      (PROBE_OPS * sizeof(struct io_uring_probe_op))];
+    }
+    buff;
+
+    memset(&buff, 0, sizeof(buff));
+    if (syscall(__NR_io_uring_register, RingFd, IORING_REGISTER_PROBE, &buff, PROBE_OPS) != 0)
+    {
+        return false;
+    }
+
+    // Timed writes also need timeouts and cancellation (which came before writes), and a check
+    // that timeouts can be linked to (see ProbeTimedWrites()).
+    TimedWritesSupported = false;
+
+    return (buff.probe.last_op >= IORING_OP_WRITE) &&
+           ((buff.probe.ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) != 0) &&
+           ((buff.probe.ops[IORING_OP_TIMEOUT].flags & IO_URING_OP_SUPPORTED) != 0) &&
+           ((buff.probe.ops[IORING_OP_ASYNC_CANCEL].flags & IO_URING_OP_SUPPORTED) != 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a free submission queue entry, cleared.  Nothing is handed to the kernel until the tail is
+ * moved past it (see Push()).
+ *
+ * @return The entry, or NULL if there are fewer than count free.
+ */
+//--------------------------------------------------------------------------------------------------
+static struct io_uring_sqe *Reserve
+(
+    uint32_t offset,            ///< Entries already reserved.
+    uint32_t count              ///< Entries needed (including those already reserved).
+)
+{
+    // Only this thread moves the tail, but the kernel moves the head.
+    uint32_t tail = *SqTailPtr;
+    if ((tail + count - __atomic_load_n(SqHeadPtr, __ATOMIC_ACQUIRE)) > SqEntries)
+    {
+        return NULL;
+    }
+
+    uint32_t index = (tail + offset) & SqMask;
+    struct io_uring_sqe *sqePtr = &SqesPtr[index];
+    memset(sqePtr, 0, sizeof(*sqePtr));
+    SqArrayPtr[index] = index;
+
+    return sqePtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues the entries got from Reserve().
+ */
+//--------------------------------------------------------------------------------------------------
+static void Push
+(
+    uint32_t count              ///< Number of entries.
+)
+{
+    // The entries must be complete before the kernel can see the new tail.
+    __atomic_store_n(SqTailPtr, *SqTailPtr + count, __ATOMIC_RELEASE);
+    UnsubmittedCount += count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fills in a timeout entry.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrepareTimeout
+(
+    struct io_uring_sqe *sqePtr,    ///< Entry.
+    uint64_t timeNs,                ///< CLOCK_MONOTONIC time to wait for.
+    uint32_t flags                  ///< Timeout flags (besides IORING_TIMEOUT_ABS).
+)
+{
+    struct __kernel_timespec *timePtr = &Times[sqePtr - SqesPtr];
+    timePtr->tv_sec = (int64_t)(timeNs / 1000000000ULL);
+    timePtr->tv_nsec = (long long)(timeNs % 1000000000ULL);
+
+    sqePtr->opcode = IORING_OP_TIMEOUT;
+    sqePtr->addr = (uint64_t)(uintptr_t)timePtr;
+    sqePtr->len = 1;
+    sqePtr->off = 0;            // A pure timeout, rather than waiting for other completions.
+    sqePtr->timeout_flags = IORING_TIMEOUT_ABS | flags;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether the kernel can link a timeout to the request after it.  Normally, a timeout that
+ * expires counts as failed, which would cancel the request after it.  Newer kernels can be told
+ * to count it as a success instead, so a timeout that has already expired is queued with that
+ * flag, to see if the kernel accepts it.
+ *
+ * @return true if it can.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ProbeTimedWrites
+(
+    void
+)
+{
+#ifdef IORING_TIMEOUT_ETIME_SUCCESS
+    struct io_uring_sqe *sqePtr = Reserve(0, 1);
+    if (sqePtr == NULL)
+    {
+        return false;
+    }
+    PrepareTimeout(sqePtr, 1, IORING_TIMEOUT_ETIME_SUCCESS);
+    sqePtr->user_data = URING_CANCEL_TAG;
+    Push(1);
+
+    uint64_t tag;
+    int32_t result;
+    if ((uring_Submit(1) != LE_OK) || !uring_GetCompletion(&tag, &result))
+    {
+        return false;
+    }
+
+    return (result == -ETIME);
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets up the ring.
+ *
+ * @return
+ *  - LE_OK if the ring can be used.
+ *  - LE_NOT_IMPLEMENTED if io_uring (or an operation used here) isn't supported.
+ *  - LE_FAULT if the ring couldn't be set up.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_Open
+(
+    uint32_t numEntries         ///< Most requests that can be queued at a time (a power of 2, at
+                                ///  most URING_MAX_ENTRIES).
+)
+{
+    LE_ASSERT(numEntries <= URING_MAX_ENTRIES);
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    RingFd = (int)syscall(__NR_io_uring_setup, numEntries, &params);
+    if (RingFd == -1)
+    {
+        LE_WARN("io_uring set-up failed (%m)");
+        return ((errno == ENOSYS) || (errno == EPERM)) ? LE_NOT_IMPLEMENTED : LE_FAULT;
+    }
+    if (!Probe())
+    {
+        LE_WARN("io_uring doesn't support writes");
+        uring_Close();
+        return LE_NOT_IMPLEMENTED;
+    }
+
+    SqRingBytes = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+    CqRingBytes = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+    SqesBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Since Linux 5.4, both rings are in one mapping (which then has to be big enough for both).
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) && (CqRingBytes > SqRingBytes))
+    {
+        SqRingBytes = CqRingBytes;
+    }
+
+    SqRingPtr = mmap(NULL, SqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     RingFd, IORING_OFF_SQ_RING);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        CqRingPtr = SqRingPtr;
+    }
+    else
+    {
+        CqRingPtr = mmap(NULL, CqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         RingFd, IORING_OFF_CQ_RING);
+    }
+    SqesPtr = mmap(NULL, SqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   RingFd, IORING_OFF_SQES);
+
+    if ((SqRingPtr == MAP_FAILED) || (CqRingPtr == MAP_FAILED) || (SqesPtr == MAP_FAILED))
+    {
+        LE_ERROR("Mapping io_uring failed (%m)");
+        uring_Close();
+        return LE_FAULT;
+    }
+
+    uint8_t *sqPtr = SqRingPtr;
+    SqTailPtr = (uint32_t *)(sqPtr + params.sq_off.tail);
+    SqHeadPtr = (uint32_t *)(sqPtr + params.sq_off.head);
+    SqArrayPtr = (uint32_t *)(sqPtr + params.sq_off.array);
+    SqMask = *(uint32_t *)(sqPtr + params.sq_off.ring_mask);
+    SqEntries = params.sq_entries;
+
+    uint8_t *cqPtr = CqRingPtr;
+    CqTailPtr = (uint32_t *)(cqPtr + params.cq_off.tail);
+    CqHeadPtr = (uint32_t *)(cqPtr + params.cq_off.head);
+    CqesPtr = (struct io_uring_cqe *)(cqPtr + params.cq_off.cqes);
+    CqMask = *(uint32_t *)(cqPtr + params.cq_off.ring_mask);
+
+    UnsubmittedCount = 0;
+    ChainEndPtr = NULL;
+
+    TimedWritesSupported = ProbeTimedWrites();
+    if (!TimedWritesSupported)
+    {
+        LE_INFO("io_uring can't time writes");
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues a write to the start of a file.  Nothing is handed to the kernel until uring_Submit() is
+ * called.  The buffer must stay valid until the write's completion has been read.
+ *
+ * @return LE_OK, or LE_NO_MEMORY if the queue is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueWrite
+(
+    int fd,                     ///< File descriptor.
+    const void *bufPtr,         ///< Data to write.
+    size_t len,                 ///< Length of the data.
+    uint64_t tag                ///< Returned with the write's completion.
+)
+{
+    struct io_uring_sqe *sqePtr = Reserve(0, 1);
+    if (sqePtr == NULL)
+    {
+        return LE_NO_MEMORY;
+    }
+
+    sqePtr->opcode = IORING_OP_WRITE;
+    sqePtr->fd = fd;
+    sqePtr->addr = (uint64_t)(uintptr_t)bufPtr;
+    sqePtr->len = (uint32_t)len;
+    sqePtr->off = 0;
+    sqePtr->user_data = tag;
+    Push(1);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues a write to the start of a file, to be made at a given time (or straight away, if that
+ * time has passed), after the timed write queued before it (if it hasn't been handed to the kernel
+ * yet).  Nothing is handed to the kernel until uring_Submit() is called.  The buffer must stay
+ * valid until the write's completion has been read.
+ *
+ * Two completions are returned: one for the wait (with the tag given, and a result of -ETIME if
+ * the time was reached) and then one for the write (with the tag plus 1).
+ *
+ * @return LE_OK, LE_NO_MEMORY if the queue is full, or LE_NOT_IMPLEMENTED if the kernel can't
+ *         time writes.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueTimedWrite
+(
+    int fd,                     ///< File descriptor.
+    const void *bufPtr,         ///< Data to write.
+    size_t len,                 ///< Length of the data.
+    uint64_t timeNs,            ///< CLOCK_MONOTONIC time at which to write.
+    uint64_t tag                ///< Returned with the wait's completion (tag + 1 with the
+                                ///  write's).
+)
+{
+#ifdef IORING_TIMEOUT_ETIME_SUCCESS
+    if (!TimedWritesSupported)
+    {
+        return LE_NOT_IMPLEMENTED;
+    }
+
+    struct io_uring_sqe *timeoutPtr = Reserve(0, 2);
+    struct io_uring_sqe *writePtr = Reserve(1, 2);
+    if ((timeoutPtr == NULL) || (writePtr == NULL))
+    {
+        return LE_NO_MEMORY;
+    }
+
+    // The timeout only starts once the write before it is done, so the writes are made in order,
+    // and the write only starts once the timeout has expired.
+    PrepareTimeout(timeoutPtr, timeNs, IORING_TIMEOUT_ETIME_SUCCESS);
+    timeoutPtr->flags = IOSQE_IO_LINK;
+    timeoutPtr->user_data = tag;
+
+    writePtr->opcode = IORING_OP_WRITE;
+    writePtr->fd = fd;
+    writePtr->addr = (uint64_t)(uintptr_t)bufPtr;
+    writePtr->len = (uint32_t)len;
+    writePtr->off = 0;
+    writePtr->user_data = tag + 1;
+
+    if (ChainEndPtr != NULL)
+    {
+        ChainEndPtr->flags |= IOSQE_IO_LINK;
+    }
+    ChainEndPtr = writePtr;
+
+    Push(2);
+
+    return LE_OK;
+#else
+    return LE_NOT_IMPLEMENTED;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues the cancellation of a request that has been handed to the kernel, if it hasn't been
+ * done yet.  A write that has already been started can't be cancelled.  The cancellation's own
+ * completion has the tag URING_CANCEL_TAG.
+ *
+ * @return LE_OK, or LE_NO_MEMORY if the queue is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueCancel
+(
+    uint64_t tag                ///< Tag of the request to cancel.
+)
+{
+    struct io_uring_sqe *sqePtr = Reserve(0, 1);
+    if (sqePtr == NULL)
+    {
+        return LE_NO_MEMORY;
+    }
+
+    sqePtr->opcode = IORING_OP_ASYNC_CANCEL;
+    sqePtr->fd = -1;
+    sqePtr->addr = tag;
+    sqePtr->user_data = URING_CANCEL_TAG;
+    Push(1);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands the queued writes to the kernel, optionally waiting for some completions.
+ *
+ * @return LE_OK, or LE_FAULT if the kernel refused them.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_Submit
+(
+    uint32_t waitCount          ///< Completions to wait for (0 = don't wait).
+)
+{
+    long result;
+    do
+    {
+        result = syscall(__NR_io_uring_enter, RingFd, UnsubmittedCount, waitCount,
+                         (waitCount > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    }
+    while ((result == -1) && (errno == EINTR));
+
+    if (result == -1)
+    {
+        LE_ERROR("io_uring submission failed (%m)");
+        return LE_FAULT;
+    }
+
+    UnsubmittedCount -= (uint32_t)result;
+
+    // Links can't reach back into entries the kernel has already got.
+    if (UnsubmittedCount == 0)
+    {
+        ChainEndPtr = NULL;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Takes the oldest completion, if there is one.  Never makes a system call.
+ *
+ * @return true if there was a completion.
+ */
+//--------------------------------------------------------------------------------------------------
+bool uring_GetCompletion
+(
+    uint64_t *tagPtr,           ///< [OUT] Tag of the write.
+    int32_t *resultPtr          ///< [OUT] Bytes written, or a negative errno value.
+)
+{
+    // Only this thread moves the head, but the kernel moves the tail.
+    uint32_t head = *CqHeadPtr;
+    if (head == __atomic_load_n(CqTailPtr, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    const struct io_uring_cqe *cqePtr = &CqesPtr[head & CqMask];
+    *tagPtr = cqePtr->user_data;
+    *resultPtr = cqePtr->res;
+
+    // The entry must have been read before the kernel can reuse it.
+    __atomic_store_n(CqHeadPtr, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tears the ring down.  Anything still queued is dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+void uring_Close
+(
+    void
+)
+{
+    if (SqesPtr != MAP_FAILED)
+    {
+        munmap(SqesPtr, SqesBytes);
+        SqesPtr = MAP_FAILED;
+    }
+    if ((CqRingPtr != MAP_FAILED) && (CqRingPtr != SqRingPtr))
+    {
+        munmap(CqRingPtr, CqRingBytes);
+    }
+    CqRingPtr = MAP_FAILED;
+    if (SqRingPtr != MAP_FAILED)
+    {
+        munmap(SqRingPtr, SqRingBytes);
+        SqRingPtr = MAP_FAILED;
+    }
+    if (RingFd != -1)
+    {
+        close(RingFd);
+        RingFd = -1;
+    }
+}
+
+#else // No io_uring.
+
+le_result_t uring_Open(uint32_t numEntries)
+{
+    LE_WARN("Built without io_uring support");
+    return LE_NOT_IMPLEMENTED;
+}
+
+le_result_t uring_QueueWrite(int fd, const void *bufPtr, size_t len, uint64_t tag)
+{
+    return LE_NOT_IMPLEMENTED;
+}
+
+le_result_t uring_QueueTimedWrite(int fd, const void *bufPtr, size_t len, uint64_t timeNs,
+                                  uint64_t tag)
+{
+    return LE_NOT_IMPLEMENTED;
+}
+
+le_result_t uring_QueueCancel(uint64_t tag)
+{
+    return LE_NOT_IMPLEMENTED;
+}
+
+le_result_t uring_Submit(uint32_t waitCount)
+{
+    return LE_NOT_IMPLEMENTED;
+}
+
+bool uring_GetCompletion(uint64_t *tagPtr, int32_t *resultPtr)
+{
+    return false;
+}
+
+void uring_Close(void)
+{
+}
+
+#endif
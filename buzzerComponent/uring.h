@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file uring.h
+ *
+ * Minimal io_uring access, through the raw system calls (so liburing isn't needed).  Writes are
+ * queued in memory shared with the kernel, and handed over with a single system call that
+ * doesn't wait for them to be done, so a slow write (e.g., a sysfs attribute whose driver does an
+ * I2C transfer) doesn't hold up the caller.  Each write's result comes back as a completion, which
+ * is also read from shared memory, without a system call.
+ *
+ * Writes can also be timed: the kernel waits for an absolute CLOCK_MONOTONIC time, then makes the
+ * write, without waking the caller up.  Timed writes queued one after another form a chain: each
+ * one is only started once the one before it has been made, and if one fails or is cancelled,
+ * the rest of the chain is cancelled too.  Timed writes need a kernel that can link timeouts to
+ * the requests after them (IORING_TIMEOUT_ETIME_SUCCESS).
+ *
+ * There is a single ring, which must only be used from one thread at a time.
+ *
+ * If the kernel (or the headers the component is built with) doesn't support io_uring, or the
+ * operations used here, uring_Open() fails, so the caller can fall back to plain writes.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef URING_H_INCLUDE_GUARD
+#define URING_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+/// Most entries a ring can have.
+#define URING_MAX_ENTRIES 256
+
+/// Tag of the completions of cancellations.
+#define URING_CANCEL_TAG UINT64_MAX
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets up the ring.
+ *
+ * @return
+ *  - LE_OK if the ring can be used.
+ *  - LE_NOT_IMPLEMENTED if io_uring (or an operation used here) isn't supported.
+ *  - LE_FAULT if the ring couldn't be set up.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_Open
+(
+    uint32_t numEntries         ///< Most requests that can be queued at a time (a power of 2, at
+                                ///  most URING_MAX_ENTRIES).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues a write to the start of a file.  Nothing is handed to the kernel until uring_Submit() is
+ * called.  The buffer must stay valid until the write's completion has been read.
+ *
+ * @return LE_OK, or LE_NO_MEMORY if the queue is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueWrite
+(
+    int fd,                     ///< File descriptor.
+    const void *bufPtr,         ///< Data to write.
+    size_t len,                 ///< Length of the data.
+    uint64_t tag                ///< Returned with the write's completion.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues a write to the start of a file, to be made at a given time (or straight away, if that
+ * time has passed), after the timed write queued before it (if it hasn't been handed to the kernel
+ * yet).  Nothing is handed to the kernel until uring_Submit() is called.  The buffer must stay
+ * valid until the write's completion has been read.
+ *
+ * Two completions are returned: one for the wait (with the tag given, and a result of -ETIME if
+ * the time was reached) and then one for the write (with the tag plus 1).
+ *
+ * @return LE_OK, LE_NO_MEMORY if the queue is full, or LE_NOT_IMPLEMENTED if the kernel can't
+ *         time writes.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueTimedWrite
+(
+    int fd,                     ///< File descriptor.
+    const void *bufPtr,         ///< Data to write.
+    size_t len,                 ///< Length of the data.
+    uint64_t timeNs,            ///< CLOCK_MONOTONIC time at which to write.
+    uint64_t tag                ///< Returned with the wait's completion (tag + 1 with the
+                                ///  write's).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queues the cancellation of a request that has been handed to the kernel, if it hasn't been
+ * done yet.  A write that has already been started can't be cancelled.  The cancellation's own
+ * completion has the tag URING_CANCEL_TAG.
+ *
+ * @return LE_OK, or LE_NO_MEMORY if the queue is full.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_QueueCancel
+(
+    uint64_t tag                ///< Tag of the request to cancel.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hands the queued writes to the kernel, optionally waiting for some completions.
+ *
+ * @return LE_OK, or LE_FAULT if the kernel refused them.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uring_Submit
+(
+    uint32_t waitCount          ///< Completions to wait for (0 = don't wait).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Takes the oldest completion, if there is one.  Never makes a system call.
+ *
+ * @return true if there was a completion.
+ */
+//--------------------------------------------------------------------------------------------------
+bool uring_GetCompletion
+(
+    uint64_t *tagPtr,           ///< [OUT] Tag of the request.
+    int32_t *resultPtr          ///< [OUT] Bytes written, or a negative errno value.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tears the ring down.  Anything still queued is dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+void uring_Close
+(
+    void
+);
+
+#endif // URING_H_INCLUDE_GUARD
@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * What the benchmarks have in common (see bench.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "bench.h"
+
+/// The results file (NULL if none is being written).
+static FILE *ResultsFile = NULL;
+
+/// Number of columns of the benchmark's own.
+static size_t ExtraCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compares two samples, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareSamples
+(
+    const void *aPtr,
+    const void *bPtr
+)
+{
+    uint64_t a = *(const uint64_t *)aPtr;
+    uint64_t b = *(const uint64_t *)bPtr;
+
+    return (a > b) - (a < b);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Summarises a set of timing samples.  The samples are sorted in place.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Summarise
+(
+    uint64_t *samplesPtr,           ///< Samples, in nanoseconds.
+    size_t count,                   ///< Number of samples.
+    bench_Summary_t *summaryPtr     ///< [OUT] Summary.
+)
+{
+    memset(summaryPtr, 0, sizeof(*summaryPtr));
+    summaryPtr->count = count;
+    if (count == 0)
+    {
+        return;
+    }
+
+    qsort(samplesPtr, count, sizeof(samplesPtr[0]), CompareSamples);
+
+    uint64_t totalNs = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        totalNs += samplesPtr[i];
+    }
+
+    summaryPtr->meanNs = totalNs / count;
+    summaryPtr->p50Ns = samplesPtr[(count - 1) / 2];
+    summaryPtr->p99Ns = samplesPtr[((count - 1) * 99) / 100];
+    summaryPtr->maxNs = samplesPtr[count - 1];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the CPU time used by the calling thread.
+ *
+ * @return The time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t bench_GetThreadCpuNs
+(
+    void
+)
+{
+    struct timespec ts;
+
+    LE_ASSERT(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the results file, and prints the table heading.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Open
+(
+    const char *pathPtr,            ///< Path of the results file (NULL = don't write one).
+    const char *const *extraNamesPtr,   ///< Names of the benchmark's own columns (NULL if none).
+    size_t extraCount               ///< Number of the benchmark's own columns.
+)
+{
+    ExtraCount = extraCount;
+
+    if (pathPtr != NULL)
+    {
+        ResultsFile = fopen(pathPtr, "w");
+        if (ResultsFile == NULL)
+        {
+            LE_FATAL("Can't open results file '%s' (%m)", pathPtr);
+        }
+        fprintf(ResultsFile, "case,param,count,mean_ns,p50_ns,p99_ns,max_ns");
+        for (size_t i = 0; i < extraCount; i++)
+        {
+            fprintf(ResultsFile, ",%s", extraNamesPtr[i]);
+        }
+        fprintf(ResultsFile, "\n");
+    }
+
+    printf("%-16s %10s %8s %10s %10s %10s %10s",
+           "case", "param", "count", "mean (ns)", "p50 (ns)", "p99 (ns)", "max (ns)");
+    for (size_t i = 0; i < extraCount; i++)
+    {
+        printf(" %18s", extraNamesPtr[i]);
+    }
+    printf("\n");
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reports the summary of a case, in the table and the results file.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Report
+(
+    const char *casePtr,            ///< Case name.
+    uint64_t param,                 ///< What is varied within the case.
+    const bench_Summary_t *summaryPtr,  ///< Summary.
+    const double *extrasPtr         ///< Values of the benchmark's own columns (NULL if none).
+)
+{
+    printf("%-16s %10" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+           " %10" PRIu64, casePtr, param, summaryPtr->count, summaryPtr->meanNs,
+           summaryPtr->p50Ns, summaryPtr->p99Ns, summaryPtr->maxNs);
+    for (size_t i = 0; i < ExtraCount; i++)
+    {
+        printf(" %18.6g", extrasPtr[i]);
+    }
+    printf("\n");
+
+    if (ResultsFile != NULL)
+    {
+        fprintf(ResultsFile, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                ",%" PRIu64, casePtr, param, summaryPtr->count, summaryPtr->meanNs,
+                summaryPtr->p50Ns, summaryPtr->p99Ns, summaryPtr->maxNs);
+        for (size_t i = 0; i < ExtraCount; i++)
+        {
+            fprintf(ResultsFile, ",%.9g", extrasPtr[i]);
+        }
+        fprintf(ResultsFile, "\n");
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the results file.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Close
+(
+    void
+)
+{
+    if ((ResultsFile != NULL) && (fclose(ResultsFile) != 0))
+    {
+        LE_FATAL("Can't write results file (%m)");
+    }
+    ResultsFile = NULL;
+}
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file bench.h
+ *
+ * What the benchmarks have in common: timing samples are summarised as a mean and percentiles,
+ * printed as a table, and (if a results file is given) written as CSV with a line per case:
+ *
+ * @verbatim
+   case,param,count,mean_ns,p50_ns,p99_ns,max_ns
+   pwrite,0,20000,812,790,1204,15113
+   @endverbatim
+ *
+ * where param is whatever the benchmark varies within a case (e.g., the gap between writes, or
+ * the update rate).  A benchmark can add columns of its own figures after these.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BENCH_H_INCLUDE_GUARD
+#define BENCH_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Summary of a set of timing samples.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t count;             ///< Number of samples.
+    uint64_t meanNs;            ///< Mean.
+    uint64_t p50Ns;             ///< Median.
+    uint64_t p99Ns;             ///< 99th percentile.
+    uint64_t maxNs;             ///< Largest.
+}
+bench_Summary_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Summarises a set of timing samples.  The samples are sorted in place.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Summarise
+(
+    uint64_t *samplesPtr,           ///< Samples, in nanoseconds.
+    size_t count,                   ///< Number of samples.
+    bench_Summary_t *summaryPtr     ///< [OUT] Summary.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the CPU time used by the calling thread.
+ *
+ * @return The time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t bench_GetThreadCpuNs
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Opens the results file, and prints the table heading.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Open
+(
+    const char *pathPtr,            ///< Path of the results file (NULL = don't write one).
+    const char *const *extraNamesPtr,   ///< Names of the benchmark's own columns (NULL if none).
+    size_t extraCount               ///< Number of the benchmark's own columns.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reports the summary of a case, in the table and the results file.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Report
+(
+    const char *casePtr,            ///< Case name.
+    uint64_t param,                 ///< What is varied within the case.
+    const bench_Summary_t *summaryPtr,  ///< Summary.
+    const double *extrasPtr         ///< Values of the benchmark's own columns (NULL if none).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Closes the results file.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Close
+(
+    void
+);
+
+#endif // BENCH_H_INCLUDE_GUARD
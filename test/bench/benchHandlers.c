@@ -0,0 +1,353 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark of the settings push handlers, at increasing update rates.  The component is run on
+ * the null backend, playing a 10 ms duty cycle, while updates are pushed at each rate in turn (and
+ * then as fast as they can be), with the event loop turned in between.  The updates are pushed to
+ * each handler on its own (enable, period and percent), and then to all of them, mixed.
+ *
+ * All the cases are run twice, in a process of their own each: with the edges made on the main
+ * thread, among the updates (BUZZER_EDGE_THREAD 0), and on a dedicated thread (1), to show how
+ * much the updates hold up the edges in each case.
+ *
+ * Each case lasts for one of the component's statistics intervals (see stats.c), so that what it
+ * publishes covers that case alone.  Reports, for each case and rate:
+ *
+ *  - The CPU time taken by each push handler (the summary columns).
+ *  - loop_ns_per_update: the CPU time taken by the turns of the event loop that did something
+ *    (applying the updates, and making the duty cycle's edges), per update.
+ *  - writes_per_update: output writes made to apply the updates, per update, as published by the
+ *    component.  Updates pushed in the same turn of the event loop are applied together, and
+ *    writes that wouldn't change the output are skipped, so this can be well below 1.
+ *  - backlog_max_ns: the longest an update waited to be handled, after the time it was due, as
+ *    published by the component.  This grows when the event loop can't keep up with the rate.
+ *  - edge_thread: 1 if the edges were made on a dedicated thread, 0 if on the main thread.
+ *  - latency_p99_ns: how late the edges were, 99th percentile, as published by the component.
+ *
+ * See bench.h for the results file (param is the rate, in updates per second, 0 = as fast as
+ * possible).
+ *
+ * Usage: benchHandlers [MS_PER_CASE [RESULTS_FILE]]
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+
+#include <sys/wait.h>
+
+#include "backend.h"
+#include "host.h"
+#include "bench.h"
+
+/// Time spent on each case, if not given.
+#define DEFAULT_MS_PER_CASE 2000
+
+/// Statistics published by the component.
+#define STATS_WRITES  "stats/writes_per_update"
+#define STATS_BACKLOG "stats/update_backlog"
+#define STATS_LATENCY "stats/latency_p99"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * An update.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *pathPtr;        ///< Path of the setting.
+    const char *valuePtr;       ///< Value.
+}
+Update_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A case: updates pushed in turn.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char *namePtr;        ///< Case name.
+    const Update_t *updatesPtr; ///< Updates.
+    size_t updateCount;         ///< Number of updates.
+}
+Case_t;
+
+static const Update_t EnableUpdates[] = { { "enable", "false" }, { "enable", "true" } };
+static const Update_t PeriodUpdates[] = { { "period", "0.02" }, { "period", "0.01" } };
+static const Update_t PercentUpdates[] = { { "percent", "60" }, { "percent", "40" } };
+static const Update_t MixedUpdates[] =
+{
+    { "percent", "60" },
+    { "period", "0.02" },
+    { "enable", "false" },
+    { "percent", "40" },
+    { "enable", "true" },
+    { "period", "0.01" },
+};
+
+/// The cases.
+static const Case_t Cases[] =
+{
+    { "enable", EnableUpdates, NUM_ARRAY_MEMBERS(EnableUpdates) },
+    { "period", PeriodUpdates, NUM_ARRAY_MEMBERS(PeriodUpdates) },
+    { "percent", PercentUpdates, NUM_ARRAY_MEMBERS(PercentUpdates) },
+    { "mixed", MixedUpdates, NUM_ARRAY_MEMBERS(MixedUpdates) },
+};
+
+/// Update rates, in updates per second (0 = as fast as possible).
+static const uint64_t Rates[] = { 10, 100, 1000, 10000, 100000, 0 };
+
+/// The benchmark's own columns (see bench.h).
+static const char *const ExtraNames[] =
+{
+    "loop_ns_per_update",
+    "writes_per_update",
+    "backlog_max_ns",
+    "edge_thread",
+    "latency_p99_ns",
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the event loop once, adding its CPU time to a total if it did anything.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Turn
+(
+    int timeoutMs,                  ///< Longest time to wait.
+    uint64_t *loopNsPtr             ///< [IN/OUT] Total CPU time.
+)
+{
+    uint64_t startNs = bench_GetThreadCpuNs();
+
+    if (host_ServiceLoop(timeoutMs) > 0)
+    {
+        *loopNsPtr += bench_GetThreadCpuNs() - startNs;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the event loop until the component publishes its statistics, which ends an interval.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WaitForStats
+(
+    uint64_t *loopNsPtr             ///< [IN/OUT] Total CPU time taken by the event loop.
+)
+{
+    uint64_t count = host_GetPushCount(STATS_WRITES);
+
+    while (host_GetPushCount(STATS_WRITES) == count)
+    {
+        Turn(-1, loopNsPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets a statistic the component has published.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetStat
+(
+    const char *pathPtr             ///< Path of the input.
+)
+{
+    const char *valuePtr = host_GetPushedValue(pathPtr);
+    LE_ASSERT(valuePtr != NULL);
+
+    return strtod(valuePtr, NULL);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the time of day, as a Data Hub timestamp.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetTimestamp
+(
+    void
+)
+{
+    struct timespec now;
+
+    LE_ASSERT(clock_gettime(CLOCK_REALTIME, &now) == 0);
+
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes one of a case's updates, timing its push handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushUpdate
+(
+    const Case_t *casePtr,          ///< Case.
+    size_t index,                   ///< Index of the update (taking turns through the case's).
+    double timestamp,               ///< Data Hub timestamp (0 = now).
+    uint64_t *samplesPtr            ///< [OUT] Buffer for the samples (the index'th is set).
+)
+{
+    const Update_t *updatePtr = &casePtr->updatesPtr[index % casePtr->updateCount];
+
+    uint64_t cpuNs = bench_GetThreadCpuNs();
+    LE_ASSERT(host_PushAt(updatePtr->pathPtr, updatePtr->valuePtr, timestamp) == LE_OK);
+    samplesPtr[index] = bench_GetThreadCpuNs() - cpuNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes a case's updates at a rate, for most of a statistics interval, then waits for the end of
+ * the interval and reports what the updates cost.  Must be called at the start of an interval.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunCase
+(
+    const Case_t *casePtr,          ///< Case.
+    uint64_t rate,                  ///< Updates per second (0 = as fast as possible).
+    bool edgeThread,                ///< true if the edges are made on a dedicated thread.
+    uint64_t durationNs,            ///< Time to push updates for.
+    uint64_t *samplesPtr,           ///< Buffer for the samples.
+    size_t maxSamples               ///< Size of the buffer.
+)
+{
+    uint64_t intervalNs = (rate > 0) ? (1000000000ULL / rate) : 0;
+    uint64_t startNs = backend_GetMonotonicNs();
+    double startTimestamp = GetTimestamp();
+    uint64_t endNs = startNs + durationNs;
+    uint64_t loopNs = 0;
+    size_t count = 0;
+
+    while ((count + casePtr->updateCount) <= maxSamples)
+    {
+        // Wait for the time of the next update, turning the event loop meanwhile.
+        uint64_t dueNs = startNs + (count * intervalNs);
+        uint64_t nowNs = backend_GetMonotonicNs();
+        while ((nowNs < dueNs) && (nowNs < endNs))
+        {
+            Turn((int)((((dueNs < endNs) ? dueNs : endNs) - nowNs) / 1000000), &loopNs);
+            nowNs = backend_GetMonotonicNs();
+        }
+        if (nowNs >= endNs)
+        {
+            break;
+        }
+
+        // Each update is stamped with the time it was due, so any time it waited behind the one
+        // before counts towards the backlog.  As fast as possible, each is due when it is made.
+        double timestamp = (rate > 0) ? (startTimestamp + ((double)(dueNs - startNs) / 1e9)) : 0;
+        PushUpdate(casePtr, count, timestamp, samplesPtr);
+        count++;
+
+        Turn(0, &loopNs);
+    }
+
+    // Each case's updates end the way the component was set up (e.g., enabled), so the round
+    // that was started is finished, straight away, for the next case to start from there.
+    while ((count % casePtr->updateCount) != 0)
+    {
+        PushUpdate(casePtr, count, 0, samplesPtr);
+        count++;
+    }
+
+    WaitForStats(&loopNs);
+
+    bench_Summary_t summary;
+    bench_Summarise(samplesPtr, count, &summary);
+
+    double extras[] =
+    {
+        (count > 0) ? ((double)loopNs / (double)count) : 0,
+        GetStat(STATS_WRITES),
+        GetStat(STATS_BACKLOG) * 1e9,
+        edgeThread ? 1 : 0,
+        GetStat(STATS_LATENCY) * 1e9,
+    };
+    bench_Report(casePtr->namePtr, rate, &summary, extras);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Runs all the cases, in a child process (as the component can only be started once in a
+ * process).
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunCases
+(
+    uint64_t msPerCase,             ///< Time spent on each case.
+    bool edgeThread                 ///< true to make the edges on a dedicated thread.
+)
+{
+    // The results file is shared with the child, so nothing may be left in its buffer.
+    fflush(NULL);
+
+    pid_t pid = fork();
+    LE_ASSERT(pid >= 0);
+    if (pid > 0)
+    {
+        int status;
+        LE_ASSERT(waitpid(pid, &status, 0) == pid);
+        LE_ASSERT(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS));
+        return;
+    }
+
+    // Each case lasts for one statistics interval.  Updates are only pushed for most of it, so
+    // that the last of them have been applied before it ends.
+    char statsMs[16];
+    snprintf(statsMs, sizeof(statsMs), "%" PRIu64, msPerCase);
+    setenv("BUZZER_BACKEND", "null", 1);
+    setenv("BUZZER_STATS_MS", statsMs, 1);
+    setenv("BUZZER_EDGE_THREAD", edgeThread ? "1" : "0", 1);
+    uint64_t durationNs = (msPerCase * 1000000 * 9) / 10;
+
+    host_ComponentInit();
+    LE_ASSERT(host_Push("period", "0.01") == LE_OK);
+    LE_ASSERT(host_Push("percent", "40") == LE_OK);
+    LE_ASSERT(host_Push("enable", "true") == LE_OK);
+
+    // Enough for the fastest rate there is a limit on, and finishing its last round of updates.
+    // As fast as possible stops there.
+    size_t maxSamples = (size_t)((Rates[NUM_ARRAY_MEMBERS(Rates) - 2] * durationNs) /
+                                 1000000000ULL) + NUM_ARRAY_MEMBERS(MixedUpdates);
+    uint64_t *samplesPtr = calloc(maxSamples, sizeof(*samplesPtr));
+    LE_ASSERT(samplesPtr != NULL);
+
+    uint64_t loopNs = 0;
+    WaitForStats(&loopNs);
+
+    for (size_t c = 0; c < NUM_ARRAY_MEMBERS(Cases); c++)
+    {
+        for (size_t r = 0; r < NUM_ARRAY_MEMBERS(Rates); r++)
+        {
+            RunCase(&Cases[c], Rates[r], edgeThread, durationNs, samplesPtr, maxSamples);
+        }
+    }
+
+    // The component's threads are still running, so the process is ended straight away.
+    fflush(NULL);
+    _exit(EXIT_SUCCESS);
+}
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+{
+    uint64_t msPerCase = (argc > 1) ? strtoull(argv[1], NULL, 10) : DEFAULT_MS_PER_CASE;
+    if ((argc > 3) || (msPerCase == 0) || (msPerCase > 86400000))
+    {
+        fprintf(stderr, "Usage: %s [MS_PER_CASE [RESULTS_FILE]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_Open((argc > 2) ? argv[2] : NULL, ExtraNames, NUM_ARRAY_MEMBERS(ExtraNames));
+    RunCases(msPerCase, false);
+    RunCases(msPerCase, true);
+    bench_Close();
+
+    return EXIT_SUCCESS;
+}
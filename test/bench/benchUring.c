@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark of the io_uring CLKOUT backend against the sysfs one.  Times each call to set the
+ * frequency, on a file on a tmpfs standing in for the sysfs attribute:
+ *
+ *  - pwrite: the sysfs backend, which makes the write before returning.
+ *  - uring: the io_uring backend (see uring.h), which only queues the write, so the caller is
+ *    never held up by the driver.
+ *
+ * Each is timed with calls back to back, and with a gap between them (as between the edges of a
+ * real pattern).  After each case, the frequency is read back, to check that the writes land.
+ * See bench.h for the results file.
+ *
+ * On a tmpfs, a write costs next to nothing, so this shows what queueing a write costs.  On the
+ * target, the sysfs write takes as long as the I2C transfer to the RTC, and that is what the
+ * io_uring backend takes off the edge engine's thread.
+ *
+ * Usage: benchUring [WRITES [RESULTS_FILE]]
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+#include "bench.h"
+
+/// Number of writes timed for each case, if not given.
+#define DEFAULT_WRITES 20000
+
+/// Gaps between writes.
+static const uint64_t GapsNs[] = { 0, 200000 };
+
+/// Frequencies written, in turn.
+static const uint32_t FreqsHz[] = { 4096, 0 };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Times calls to a backend's set operation, and reports them.
+ *
+ * @return false if the backend can't be used here.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool TimeBackend
+(
+    const backend_Ops_t *opsPtr,    ///< Backend.
+    uint64_t *samplesPtr,           ///< Buffer for the samples.
+    size_t count,                   ///< Number of writes.
+    uint64_t gapNs                  ///< Gap between writes.
+)
+{
+    if (opsPtr->open() != LE_OK)
+    {
+        printf("%s: can't be opened here\n", opsPtr->namePtr);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t startNs = backend_GetMonotonicNs();
+
+        opsPtr->set(FreqsHz[i % NUM_ARRAY_MEMBERS(FreqsHz)]);
+
+        samplesPtr[i] = backend_GetMonotonicNs() - startNs;
+        if (gapNs > 0)
+        {
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)gapNs };
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    // Unlike a sysfs attribute, the file keeps the end of a longer value written before a shorter
+    // one, so the check is made with the longest value.
+    opsPtr->set(FreqsHz[0]);
+    uint32_t freqHz = opsPtr->get();
+    opsPtr->close();
+    LE_FATAL_IF(freqHz != FreqsHz[0], "%s: read back %" PRIu32 " Hz, but wrote %" PRIu32 " Hz",
+                opsPtr->namePtr, freqHz, FreqsHz[0]);
+
+    bench_Summary_t summary;
+    bench_Summarise(samplesPtr, count, &summary);
+    bench_Report((opsPtr == &backend_ClkoutSysfs) ? "pwrite" : "uring", gapNs, &summary,
+                 NULL);
+
+    return true;
+}
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_WRITES;
+    if ((argc > 3) || (count == 0))
+    {
+        fprintf(stderr, "Usage: %s [WRITES [RESULTS_FILE]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/dev/shm/benchUring.%d.clkout_freq", (int)getpid());
+    int fd = open(path, O_CREAT | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    LE_FATAL_IF(fd == -1, "Can't create '%s' (%m)", path);
+    close(fd);
+    setenv("BUZZER_CLKOUT_PATH", path, 1);
+
+    uint64_t *samplesPtr = calloc(count, sizeof(*samplesPtr));
+    LE_ASSERT(samplesPtr != NULL);
+
+    // Each case is run twice, as the first run of each pays for warming up.
+    bench_Open((argc > 2) ? argv[2] : NULL, NULL, 0);
+    for (size_t g = 0; g < NUM_ARRAY_MEMBERS(GapsNs); g++)
+    {
+        for (int round = 0; round < 2; round++)
+        {
+            TimeBackend(&backend_ClkoutSysfs, samplesPtr, count, GapsNs[g]);
+            TimeBackend(&backend_ClkoutUring, samplesPtr, count, GapsNs[g]);
+        }
+    }
+    bench_Close();
+
+    free(samplesPtr);
+    unlink(path);
+
+    return EXIT_SUCCESS;
+}
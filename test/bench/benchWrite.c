@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Micro-benchmark of the CLKOUT write path.  Times each write of the frequency to a file on a
+ * tmpfs standing in for the sysfs attribute, made two ways:
+ *
+ *  - stdio: the way the component used to do it, formatting the frequency into a stdio stream
+ *    and flushing it.
+ *  - pwrite: the sysfs backend's way (see backendClkout.c), a single pwrite() of a pre-rendered
+ *    string on a file descriptor opened once.
+ *
+ * Each is timed with writes back to back, and with a gap between them (as between the edges of
+ * a real pattern, when the caches have gone cold).  See bench.h for the results file.
+ *
+ * Usage: benchWrite [WRITES [RESULTS_FILE]]
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "backend.h"
+#include "bench.h"
+
+/// Number of writes timed for each case, if not given.
+#define DEFAULT_WRITES 20000
+
+/// Gaps between writes.
+static const uint64_t GapsNs[] = { 0, 200000 };
+
+/// Frequencies written, in turn.
+static const uint32_t FreqsHz[] = { 4096, 0 };
+
+/// File standing in for the sysfs attribute.
+static char Path[PATH_MAX];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Waits for a gap between writes.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Gap
+(
+    uint64_t gapNs
+)
+{
+    if (gapNs > 0)
+    {
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)gapNs };
+        nanosleep(&ts, NULL);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Times writes through a stdio stream, formatted and flushed each time.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimeStdio
+(
+    uint64_t *samplesPtr,           ///< [OUT] Time taken by each write.
+    size_t count,                   ///< Number of writes.
+    uint64_t gapNs                  ///< Gap between writes.
+)
+{
+    FILE *filePtr = fopen(Path, "r+");
+    LE_ASSERT(filePtr != NULL);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t startNs = backend_GetMonotonicNs();
+
+        // A sysfs attribute takes each write as a whole; the rewind keeps the file from growing.
+        rewind(filePtr);
+        LE_ASSERT(fprintf(filePtr, "%d", (int)FreqsHz[i % NUM_ARRAY_MEMBERS(FreqsHz)]) > 0);
+        LE_ASSERT(fflush(filePtr) == 0);
+
+        samplesPtr[i] = backend_GetMonotonicNs() - startNs;
+        Gap(gapNs);
+    }
+
+    fclose(filePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Times writes through the sysfs backend.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimePwrite
+(
+    uint64_t *samplesPtr,           ///< [OUT] Time taken by each write.
+    size_t count,                   ///< Number of writes.
+    uint64_t gapNs                  ///< Gap between writes.
+)
+{
+    LE_ASSERT(backend_ClkoutSysfs.open() == LE_OK);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t startNs = backend_GetMonotonicNs();
+
+        backend_ClkoutSysfs.set(FreqsHz[i % NUM_ARRAY_MEMBERS(FreqsHz)]);
+
+        samplesPtr[i] = backend_GetMonotonicNs() - startNs;
+        Gap(gapNs);
+    }
+
+    backend_ClkoutSysfs.close();
+}
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_WRITES;
+    if ((argc > 3) || (count == 0))
+    {
+        fprintf(stderr, "Usage: %s [WRITES [RESULTS_FILE]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    snprintf(Path, sizeof(Path), "/dev/shm/benchWrite.%d.clkout_freq", (int)getpid());
+    int fd = open(Path, O_CREAT | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    LE_FATAL_IF(fd == -1, "Can't create '%s' (%m)", Path);
+    close(fd);
+    setenv("BUZZER_CLKOUT_PATH", Path, 1);
+
+    uint64_t *samplesPtr = calloc(count, sizeof(*samplesPtr));
+    LE_ASSERT(samplesPtr != NULL);
+    bench_Summary_t summary;
+
+    bench_Open((argc > 2) ? argv[2] : NULL, NULL, 0);
+    for (size_t g = 0; g < NUM_ARRAY_MEMBERS(GapsNs); g++)
+    {
+        TimeStdio(samplesPtr, count, GapsNs[g]);
+        bench_Summarise(samplesPtr, count, &summary);
+        bench_Report("stdio", GapsNs[g], &summary, NULL);
+
+        TimePwrite(samplesPtr, count, GapsNs[g]);
+        bench_Summarise(samplesPtr, count, &summary);
+        bench_Report("pwrite", GapsNs[g], &summary, NULL);
+    }
+    bench_Close();
+
+    free(samplesPtr);
+    unlink(Path);
+
+    return EXIT_SUCCESS;
+}
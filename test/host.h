@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file host.h
+ *
+ * What the host stand-ins for Legato and the Data Hub (see stub/) offer the programs that run the
+ * component on a plain Linux box: starting the component, turning the event loop, pushing
+ * settings as the Data Hub would, and looking at what the component did.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef HOST_H_INCLUDE_GUARD
+#define HOST_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push handler statistics (see host_GetPushStats()).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t count;             ///< Number of pushes delivered to a handler.
+    uint64_t totalNs;           ///< CPU time spent in the handlers.
+    uint64_t maxNs;             ///< Longest CPU time spent in a single handler.
+}
+host_PushStats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The component's initialisation function (COMPONENT_INIT).  Must be called once, on the thread
+ * that then turns the event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+void host_ComponentInit
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the calling thread's event loop once: waits for any of its fd monitors (and timers) to be
+ * ready, calls their handlers, then calls the functions queued to the thread before that.
+ *
+ * @return The number of handlers and functions called.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t host_ServiceLoop
+(
+    int timeoutMs               ///< Longest time to wait (0 = don't wait, -1 = forever).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether all the threads are idle: none is part way through a turn of its event loop, and
+ * none has anything to do (no fd it monitors is ready, and nothing is queued to it).
+ */
+//--------------------------------------------------------------------------------------------------
+bool host_IsIdle
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of times the handler of the fd monitors (and timers) with a given name has
+ * been called, on any thread.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t host_GetWakeCount
+(
+    const char *namePtr         ///< Name the monitor or timer was created with.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes a value to one of the component's outputs, as the Data Hub would, calling its push
+ * handler straight away.  The value is given as text: true/false (or 1/0) for booleans, a number
+ * for numerics, and anything for JSON.
+ *
+ * @return LE_OK, LE_NOT_FOUND if the output has no handler, or LE_FORMAT_ERROR if the value
+ *         doesn't suit its type.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t host_Push
+(
+    const char *pathPtr,        ///< Path of the output.
+    const char *valuePtr        ///< Value.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes a value to one of the component's outputs, as for host_Push(), but with a given Data Hub
+ * timestamp, e.g., the time the update was due, so that the component sees how long it waited.
+ *
+ * @return LE_OK, LE_NOT_FOUND or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t host_PushAt
+(
+    const char *pathPtr,        ///< Path of the output.
+    const char *valuePtr,       ///< Value.
+    double timestamp            ///< Timestamp (seconds since the Epoch, 0 = now).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the statistics of the push handlers called through host_Push() (or host_PushAt()), since
+ * the start or the last reset.
+ */
+//--------------------------------------------------------------------------------------------------
+void host_GetPushStats
+(
+    host_PushStats_t *statsPtr, ///< [OUT] Statistics.
+    bool reset                  ///< true to start counting afresh.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of times the component has pushed a value to one of its inputs.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t host_GetPushCount
+(
+    const char *pathPtr         ///< Path of the input.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the last value the component pushed to one of its inputs, as text (as for host_Push()).
+ *
+ * @return The value, or NULL if nothing has been pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+const char *host_GetPushedValue
+(
+    const char *pathPtr         ///< Path of the input.
+);
+
+#endif // HOST_H_INCLUDE_GUARD
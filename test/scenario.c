@@ -0,0 +1,1002 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scenario driver.  Runs the component on the simulated clock (see sim.h), following a scenario
+ * file, and checks what it does.  Exits with status 0 if every expectation in the scenario is
+ * met.  See README.md for the scenario language.
+ *
+ * Usage: buzzerScenario SCENARIO_FILE
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "host.h"
+#include "sim.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/// Longest line in a scenario or trace file.
+#define MAX_LINE_BYTES 1024
+
+/// Most lines in a scenario.
+#define MAX_LINES 1024
+
+/// Most wake and push counters a scenario can look at.
+#define MAX_COUNTERS 16
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A line of the scenario, split into words.  The last word may be the rest of the line (see
+ * SplitLine()).
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int lineNum;                ///< Line number in the file.
+    char text[MAX_LINE_BYTES];  ///< The line, with its words terminated.
+    char *wordPtrs[8];          ///< Words.
+    size_t numWords;            ///< Number of words.
+}
+Line_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A counter that "expect wakes" or "expect pushes" looks at, and its value when "mark" was last
+ * run.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isPush;                ///< true for pushes to an input, false for wake-ups.
+    const char *namePtr;        ///< Name of the timer or monitor, or path of the input.
+    uint64_t markCount;         ///< Value at the mark.
+}
+Counter_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Everything since the mark.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t timeNs;            ///< Time.
+    size_t edgeIndex;           ///< Number of output changes logged.
+    uint64_t applyCount;        ///< Snapshots applied.
+    uint64_t expiryCount;       ///< Timer expiries.
+}
+Mark_t;
+
+static const char *FileNamePtr;
+static Line_t Lines[MAX_LINES];
+static size_t NumLines = 0;
+static Counter_t Counters[MAX_COUNTERS];
+static size_t NumCounters = 0;
+static Mark_t Mark;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reports a failed scenario line, and exits.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Fail
+(
+    const Line_t *linePtr,
+    const char *formatPtr,
+    ...
+)
+__attribute__((format(printf, 2, 3), noreturn));
+
+static void Fail
+(
+    const Line_t *linePtr,
+    const char *formatPtr,
+    ...
+)
+{
+    va_list args;
+
+    fprintf(stderr, "%s:%d: ", FileNamePtr, linePtr->lineNum);
+    va_start(args, formatPtr);
+    vfprintf(stderr, formatPtr, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    exit(EXIT_FAILURE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Splits a line into words.  Once maxWords - 1 words have been found, the rest of the line is
+ * the last word.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SplitLine
+(
+    Line_t *linePtr,
+    size_t maxWords
+)
+{
+    char *charPtr = linePtr->text;
+
+    linePtr->numWords = 0;
+    for (;;)
+    {
+        while (isspace((unsigned char)*charPtr))
+        {
+            charPtr++;
+        }
+        if ((*charPtr == '\0') || (*charPtr == '#'))
+        {
+            break;
+        }
+
+        linePtr->wordPtrs[linePtr->numWords++] = charPtr;
+        if (linePtr->numWords == maxWords)
+        {
+            // The rest of the line, without trailing white space.
+            char *endPtr = charPtr + strlen(charPtr);
+            while ((endPtr > charPtr) && isspace((unsigned char)endPtr[-1]))
+            {
+                endPtr--;
+            }
+            *endPtr = '\0';
+            break;
+        }
+
+        while ((*charPtr != '\0') && !isspace((unsigned char)*charPtr))
+        {
+            charPtr++;
+        }
+        if (*charPtr != '\0')
+        {
+            *charPtr++ = '\0';
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parses a duration: a whole number followed by ns, us, ms, s, min or h.
+ *
+ * @return The duration in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ParseDuration
+(
+    const Line_t *linePtr,
+    const char *wordPtr
+)
+{
+    static const struct
+    {
+        const char *suffixPtr;
+        uint64_t ns;
+    }
+    Units[] =
+    {
+        { "ns", 1 },
+        { "us", 1000 },
+        { "ms", 1000000 },
+        { "s", 1000000000ULL },
+        { "min", 60000000000ULL },
+        { "h", 3600000000000ULL },
+    };
+    char *endPtr;
+
+    errno = 0;
+    unsigned long long value = strtoull(wordPtr, &endPtr, 10);
+    if ((errno == 0) && (endPtr != wordPtr) && isdigit((unsigned char)wordPtr[0]))
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Units); i++)
+        {
+            if (strcmp(endPtr, Units[i].suffixPtr) == 0)
+            {
+                return (uint64_t)value * Units[i].ns;
+            }
+        }
+    }
+
+    Fail(linePtr, "Bad duration '%s'", wordPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parses a whole number.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ParseCount
+(
+    const Line_t *linePtr,
+    const char *wordPtr
+)
+{
+    char *endPtr;
+
+    errno = 0;
+    unsigned long long value = strtoull(wordPtr, &endPtr, 10);
+    if ((errno != 0) || (endPtr == wordPtr) || (*endPtr != '\0') ||
+        !isdigit((unsigned char)wordPtr[0]))
+    {
+        Fail(linePtr, "Bad number '%s'", wordPtr);
+    }
+
+    return (uint64_t)value;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks a comparison (==, !=, <, <=, > or >=).
+ */
+//--------------------------------------------------------------------------------------------------
+static void Check
+(
+    const Line_t *linePtr,
+    const char *whatPtr,
+    uint64_t actual,
+    const char *opPtr,
+    uint64_t expected
+)
+{
+    bool met;
+
+    if (strcmp(opPtr, "==") == 0)
+    {
+        met = (actual == expected);
+    }
+    else if (strcmp(opPtr, "!=") == 0)
+    {
+        met = (actual != expected);
+    }
+    else if (strcmp(opPtr, "<") == 0)
+    {
+        met = (actual < expected);
+    }
+    else if (strcmp(opPtr, "<=") == 0)
+    {
+        met = (actual <= expected);
+    }
+    else if (strcmp(opPtr, ">") == 0)
+    {
+        met = (actual > expected);
+    }
+    else if (strcmp(opPtr, ">=") == 0)
+    {
+        met = (actual >= expected);
+    }
+    else
+    {
+        Fail(linePtr, "Bad comparison '%s'", opPtr);
+    }
+
+    if (!met)
+    {
+        Fail(linePtr, "Expected %s %s %" PRIu64 ", but it is %" PRIu64,
+             whatPtr, opPtr, expected, actual);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds (or adds) a counter.
+ */
+//--------------------------------------------------------------------------------------------------
+static Counter_t *FindCounter
+(
+    bool isPush,
+    const char *namePtr
+)
+{
+    for (size_t i = 0; i < NumCounters; i++)
+    {
+        if ((Counters[i].isPush == isPush) && (strcmp(Counters[i].namePtr, namePtr) == 0))
+        {
+            return &Counters[i];
+        }
+    }
+
+    LE_FATAL_IF(NumCounters >= MAX_COUNTERS, "Too many counters");
+    Counters[NumCounters].isPush = isPush;
+    Counters[NumCounters].namePtr = namePtr;
+    Counters[NumCounters].markCount = 0;
+
+    return &Counters[NumCounters++];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads a counter.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ReadCounter
+(
+    const Counter_t *counterPtr
+)
+{
+    return counterPtr->isPush ? host_GetPushCount(counterPtr->namePtr) :
+                                host_GetWakeCount(counterPtr->namePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the mark: what "expect" compares with.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetMark
+(
+    void
+)
+{
+    Mark.timeNs = sim_GetTimeNs();
+    Mark.edgeIndex = sim_GetEdgeCount();
+    Mark.applyCount = sim_GetApplyCount();
+    Mark.expiryCount = sim_GetExpiryCount();
+
+    for (size_t i = 0; i < NumCounters; i++)
+    {
+        Counters[i].markCount = ReadCounter(&Counters[i]);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the frequency being output.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GetOutputFreq
+(
+    void
+)
+{
+    size_t count = sim_GetEdgeCount();
+
+    return (count == 0) ? 0 : sim_GetEdge(count - 1)->freqHz;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the text of a file in a scenario into the bytes it stands for: \xNN is the byte with that
+ * hexadecimal value, and \\ is a backslash.
+ *
+ * @return The number of bytes.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t Unescape
+(
+    const Line_t *linePtr,
+    const char *textPtr,
+    char *bufPtr                ///< [OUT] Bytes (at least as long as the text).
+)
+{
+    size_t len = 0;
+
+    while (*textPtr != '\0')
+    {
+        if (*textPtr != '\\')
+        {
+            bufPtr[len++] = *textPtr++;
+        }
+        else if (textPtr[1] == '\\')
+        {
+            bufPtr[len++] = '\\';
+            textPtr += 2;
+        }
+        else if ((textPtr[1] == 'x') && isxdigit((unsigned char)textPtr[2]) &&
+                 isxdigit((unsigned char)textPtr[3]))
+        {
+            char hex[3] = { textPtr[2], textPtr[3], '\0' };
+            bufPtr[len++] = (char)strtoul(hex, NULL, 16);
+            textPtr += 4;
+        }
+        else
+        {
+            Fail(linePtr, "Bad escape in '%s'", textPtr);
+        }
+    }
+
+    return len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns bytes into text, as they would be written in a scenario.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Escape
+(
+    const char *bytesPtr,
+    size_t len,
+    char *textPtr               ///< [OUT] Text (at least 4 * len + 1 long).
+)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char byte = (unsigned char)bytesPtr[i];
+
+        if (byte == '\\')
+        {
+            textPtr += sprintf(textPtr, "\\\\");
+        }
+        else if (isprint(byte))
+        {
+            *textPtr++ = (char)byte;
+        }
+        else
+        {
+            textPtr += sprintf(textPtr, "\\x%02x", byte);
+        }
+    }
+    *textPtr = '\0';
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Writes a file, replacing it if it exists, and creating the directories it is in if they don't.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteFile
+(
+    const Line_t *linePtr,
+    const char *pathPtr,
+    const char *textPtr         ///< What the file is to hold (see Unescape()).
+)
+{
+    char dir[PATH_MAX];
+    char bytes[MAX_LINE_BYTES];
+    size_t len = Unescape(linePtr, textPtr, bytes);
+
+    LE_FATAL_IF(le_utf8_Copy(dir, pathPtr, sizeof(dir), NULL) != LE_OK, "Path too long");
+    char *slashPtr = strchr(dir + 1, '/');
+    while (slashPtr != NULL)
+    {
+        *slashPtr = '\0';
+        if ((mkdir(dir, S_IRWXU) != 0) && (errno != EEXIST))
+        {
+            Fail(linePtr, "Can't create directory '%s' (%m)", dir);
+        }
+        *slashPtr = '/';
+        slashPtr = strchr(slashPtr + 1, '/');
+    }
+
+    FILE *filePtr = fopen(pathPtr, "w");
+    if ((filePtr == NULL) || (fwrite(bytes, 1, len, filePtr) != len) || (fclose(filePtr) != 0))
+    {
+        Fail(linePtr, "Can't write '%s' (%m)", pathPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks what a file holds.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckFile
+(
+    const Line_t *linePtr,
+    const char *pathPtr,
+    const char *textPtr         ///< What the file should hold (see Unescape()).
+)
+{
+    char expected[MAX_LINE_BYTES];
+    size_t expectedLen = Unescape(linePtr, textPtr, expected);
+
+    FILE *filePtr = fopen(pathPtr, "r");
+    if (filePtr == NULL)
+    {
+        Fail(linePtr, "Can't open '%s' (%m)", pathPtr);
+    }
+    char actual[MAX_LINE_BYTES];
+    size_t actualLen = fread(actual, 1, sizeof(actual), filePtr);
+    fclose(filePtr);
+
+    if ((actualLen != expectedLen) || (memcmp(actual, expected, actualLen) != 0))
+    {
+        char text[(4 * MAX_LINE_BYTES) + 1];
+        Escape(actual, actualLen, text);
+        Fail(linePtr, "Expected '%s' to hold '%s', but it holds '%s'", pathPtr, textPtr, text);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks that each time the output has been turned on since the mark, it was no more than a given
+ * amount off a grid, and that it was turned on at least once a period.
+ *
+ * expect grid PERIOD TOLERANCE     The grid is set by the first time it was turned on since the
+ *                                  mark.
+ * expect phase PERIOD TOLERANCE    The grid is set by the first time it was turned on at all, and
+ *                                  periods may be missed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckGrid
+(
+    const Line_t *linePtr
+)
+{
+    bool isPhase = (strcmp(linePtr->wordPtrs[1], "phase") == 0);
+    uint64_t periodNs = ParseDuration(linePtr, linePtr->wordPtrs[2]);
+    uint64_t toleranceNs = ParseDuration(linePtr, linePtr->wordPtrs[3]);
+    bool hasGrid = false;
+    uint64_t gridNs = 0;
+    uint64_t worstNs = 0;
+    uint64_t onCount = 0;
+    uint32_t prevFreqHz = 0;
+
+    for (size_t i = 0; i < sim_GetEdgeCount(); i++)
+    {
+        const backend_Record_t *edgePtr = sim_GetEdge(i);
+        bool isOn = (edgePtr->freqHz != 0) && (prevFreqHz == 0);
+
+        prevFreqHz = edgePtr->freqHz;
+        if (!isOn || ((i < Mark.edgeIndex) && (!isPhase || hasGrid)))
+        {
+            continue;
+        }
+
+        if (!hasGrid)
+        {
+            gridNs = edgePtr->timeNs;
+            hasGrid = true;
+        }
+        if (i < Mark.edgeIndex)
+        {
+            continue;
+        }
+
+        uint64_t idealNs = gridNs + (((edgePtr->timeNs - gridNs + (periodNs / 2)) / periodNs) *
+                                     periodNs);
+        uint64_t offNs = (edgePtr->timeNs > idealNs) ? (edgePtr->timeNs - idealNs) :
+                                                       (idealNs - edgePtr->timeNs);
+        if (offNs > worstNs)
+        {
+            worstNs = offNs;
+        }
+        onCount++;
+    }
+
+    if (onCount < 2)
+    {
+        Fail(linePtr, "Expected the output to be turned on repeatedly, but it was turned on %"
+             PRIu64 " times", onCount);
+    }
+    if (!isPhase)
+    {
+        uint64_t spanNs = sim_GetEdge(sim_GetEdgeCount() - 1)->timeNs - gridNs;
+        if (onCount < (spanNs / periodNs))
+        {
+            Fail(linePtr, "Expected the output to be turned on every period, but it was turned "
+                 "on %" PRIu64 " times in %" PRIu64 " periods", onCount, spanNs / periodNs);
+        }
+    }
+    if (worstNs > toleranceNs)
+    {
+        Fail(linePtr, "Expected the output to be turned on within %" PRIu64 " ns of the grid, "
+             "but it was %" PRIu64 " ns off", toleranceNs, worstNs);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Runs an expectation.
+ *
+ *  expect edges OP N           Output changes since the mark.
+ *  expect applies OP N         Snapshots applied by the engine since the mark.
+ *  expect expiries OP N        Timer expiries since the mark.
+ *  expect wakes OP N NAME      Wake-ups of a timer or fd monitor since the mark.
+ *  expect pushes OP N PATH     Pushes to an input since the mark.
+ *  expect output FREQ          Frequency being output.
+ *  expect value PATH VALUE     Last value pushed to an input.
+ *  expect spacing OP DURATION  Shortest time between output changes since the mark.
+ *  expect grid PERIOD TOL      Output turned on every period, on a grid, since the mark.
+ *  expect phase PERIOD TOL     Output turned on, since the mark, on the grid set at the start.
+ *  expect file PATH TEXT       What a file holds.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Expect
+(
+    Line_t *linePtr
+)
+{
+    const char *whatPtr = linePtr->wordPtrs[1];
+
+    if ((strcmp(whatPtr, "wakes") == 0) || (strcmp(whatPtr, "pushes") == 0))
+    {
+        Counter_t *counterPtr = FindCounter(whatPtr[0] == 'p', linePtr->wordPtrs[4]);
+        char what[MAX_LINE_BYTES];
+
+        snprintf(what, sizeof(what), "%s of '%s'", whatPtr, counterPtr->namePtr);
+        Check(linePtr, what, ReadCounter(counterPtr) - counterPtr->markCount,
+              linePtr->wordPtrs[2], ParseCount(linePtr, linePtr->wordPtrs[3]));
+    }
+    else if (strcmp(whatPtr, "edges") == 0)
+    {
+        Check(linePtr, whatPtr, sim_GetEdgeCount() - Mark.edgeIndex, linePtr->wordPtrs[2],
+              ParseCount(linePtr, linePtr->wordPtrs[3]));
+    }
+    else if (strcmp(whatPtr, "applies") == 0)
+    {
+        Check(linePtr, whatPtr, sim_GetApplyCount() - Mark.applyCount, linePtr->wordPtrs[2],
+              ParseCount(linePtr, linePtr->wordPtrs[3]));
+    }
+    else if (strcmp(whatPtr, "expiries") == 0)
+    {
+        Check(linePtr, whatPtr, sim_GetExpiryCount() - Mark.expiryCount, linePtr->wordPtrs[2],
+              ParseCount(linePtr, linePtr->wordPtrs[3]));
+    }
+    else if (strcmp(whatPtr, "output") == 0)
+    {
+        Check(linePtr, whatPtr, GetOutputFreq(), "==", ParseCount(linePtr, linePtr->wordPtrs[2]));
+    }
+    else if (strcmp(whatPtr, "value") == 0)
+    {
+        const char *valuePtr = host_GetPushedValue(linePtr->wordPtrs[2]);
+        if ((valuePtr == NULL) || (strcmp(valuePtr, linePtr->wordPtrs[3]) != 0))
+        {
+            Fail(linePtr, "Expected %s to be %s, but it is %s", linePtr->wordPtrs[2],
+                 linePtr->wordPtrs[3], (valuePtr == NULL) ? "unset" : valuePtr);
+        }
+    }
+    else if (strcmp(whatPtr, "spacing") == 0)
+    {
+        uint64_t minGapNs = UINT64_MAX;
+        for (size_t i = Mark.edgeIndex + 1; i < sim_GetEdgeCount(); i++)
+        {
+            uint64_t gapNs = sim_GetEdge(i)->timeNs - sim_GetEdge(i - 1)->timeNs;
+            if (gapNs < minGapNs)
+            {
+                minGapNs = gapNs;
+            }
+        }
+        Check(linePtr, "shortest time between output changes (ns)", minGapNs,
+              linePtr->wordPtrs[2], ParseDuration(linePtr, linePtr->wordPtrs[3]));
+    }
+    else if ((strcmp(whatPtr, "grid") == 0) || (strcmp(whatPtr, "phase") == 0))
+    {
+        CheckGrid(linePtr);
+    }
+    else if (strcmp(whatPtr, "file") == 0)
+    {
+        CheckFile(linePtr, linePtr->wordPtrs[2], linePtr->wordPtrs[3]);
+    }
+    else
+    {
+        Fail(linePtr, "Unknown expectation '%s'", whatPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes the values in a trace file, at the times given in it.  Each line of the trace is an
+ * offset from now (a duration), the path of an output, and a value.  Offsets must not decrease.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Replay
+(
+    const Line_t *linePtr
+)
+{
+    char path[PATH_MAX];
+    const char *namePtr = linePtr->wordPtrs[1];
+
+    // Trace files are found next to the scenario.
+    if (namePtr[0] != '/')
+    {
+        const char *slashPtr = strrchr(FileNamePtr, '/');
+        int dirLen = (slashPtr == NULL) ? 0 : (int)(slashPtr - FileNamePtr + 1);
+        snprintf(path, sizeof(path), "%.*s%s", dirLen, FileNamePtr, namePtr);
+        namePtr = path;
+    }
+
+    FILE *filePtr = fopen(namePtr, "r");
+    if (filePtr == NULL)
+    {
+        Fail(linePtr, "Can't open trace '%s' (%m)", namePtr);
+    }
+
+    uint64_t startNs = sim_GetTimeNs();
+    Line_t trace = { .lineNum = 0 };
+    while (fgets(trace.text, sizeof(trace.text), filePtr) != NULL)
+    {
+        trace.lineNum++;
+        SplitLine(&trace, 3);
+        if (trace.numWords == 0)
+        {
+            continue;
+        }
+        if (trace.numWords != 3)
+        {
+            Fail(linePtr, "%s:%d: Expected: OFFSET PATH VALUE", namePtr, trace.lineNum);
+        }
+
+        sim_AdvanceTo(startNs + ParseDuration(&trace, trace.wordPtrs[0]));
+        le_result_t result = host_Push(trace.wordPtrs[1], trace.wordPtrs[2]);
+        if (result != LE_OK)
+        {
+            Fail(linePtr, "%s:%d: Push failed (%s)", namePtr, trace.lineNum,
+                 LE_RESULT_TXT(result));
+        }
+    }
+
+    fclose(filePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Runs the lines of a phase of the scenario: from a line to the next restart (or the end).
+ *
+ * @return The index of the restart line, or NumLines.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t RunPhase
+(
+    size_t firstLine
+)
+{
+    size_t i;
+
+    for (i = firstLine; i < NumLines; i++)
+    {
+        Line_t *linePtr = &Lines[i];
+        const char *cmdPtr = linePtr->wordPtrs[0];
+
+        if (strcmp(cmdPtr, "restart") == 0)
+        {
+            break;
+        }
+        else if (strcmp(cmdPtr, "env") == 0)
+        {
+            // Already done.
+        }
+        else if (strcmp(cmdPtr, "start") == 0)
+        {
+            host_ComponentInit();
+            sim_Settle();
+            SetMark();
+        }
+        else if (strcmp(cmdPtr, "push") == 0)
+        {
+            le_result_t result = host_Push(linePtr->wordPtrs[1], linePtr->wordPtrs[2]);
+            if (result != LE_OK)
+            {
+                Fail(linePtr, "Push failed (%s)", LE_RESULT_TXT(result));
+            }
+        }
+        else if (strcmp(cmdPtr, "wait") == 0)
+        {
+            sim_AdvanceTo(sim_GetTimeNs() + ParseDuration(linePtr, linePtr->wordPtrs[1]));
+        }
+        else if (strcmp(cmdPtr, "latency") == 0)
+        {
+            sim_SetLatencyNs(ParseDuration(linePtr, linePtr->wordPtrs[1]));
+        }
+        else if (strcmp(cmdPtr, "replay") == 0)
+        {
+            Replay(linePtr);
+        }
+        else if (strcmp(cmdPtr, "file") == 0)
+        {
+            WriteFile(linePtr, linePtr->wordPtrs[1], linePtr->wordPtrs[2]);
+        }
+        else if (strcmp(cmdPtr, "reject") == 0)
+        {
+            le_result_t result = sim_RejectWrite(linePtr->wordPtrs[1], linePtr->wordPtrs[2]);
+            if (result != LE_OK)
+            {
+                Fail(linePtr, "Can't reject writes to '%s' (%s)", linePtr->wordPtrs[1],
+                     LE_RESULT_TXT(result));
+            }
+        }
+        else if (strcmp(cmdPtr, "mark") == 0)
+        {
+            sim_Settle();
+            SetMark();
+        }
+        else if (strcmp(cmdPtr, "expect") == 0)
+        {
+            sim_Settle();
+            Expect(linePtr);
+        }
+        else
+        {
+            Fail(linePtr, "Unknown command '%s'", cmdPtr);
+        }
+    }
+
+    return i;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of words a line should have (the last being the rest of the line).
+ *
+ * @return The number of words, or 0 if the command isn't known.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetNumWords
+(
+    const char *cmdPtr,         ///< Command.
+    const char *argPtr          ///< First argument (NULL if none).
+)
+{
+    static const struct
+    {
+        const char *cmdPtr;
+        const char *argPtr;     ///< First argument (NULL = any).
+        size_t numWords;
+    }
+    Syntax[] =
+    {
+        { "env", NULL, 3 },
+        { "start", NULL, 1 },
+        { "push", NULL, 3 },
+        { "wait", NULL, 2 },
+        { "latency", NULL, 2 },
+        { "replay", NULL, 2 },
+        { "file", NULL, 3 },
+        { "reject", NULL, 3 },
+        { "mark", NULL, 1 },
+        { "restart", NULL, 2 },
+        { "expect", "edges", 4 },
+        { "expect", "applies", 4 },
+        { "expect", "expiries", 4 },
+        { "expect", "wakes", 5 },
+        { "expect", "pushes", 5 },
+        { "expect", "output", 3 },
+        { "expect", "value", 4 },
+        { "expect", "spacing", 4 },
+        { "expect", "grid", 4 },
+        { "expect", "phase", 4 },
+        { "expect", "file", 4 },
+    };
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Syntax); i++)
+    {
+        if ((strcmp(cmdPtr, Syntax[i].cmdPtr) == 0) &&
+            ((Syntax[i].argPtr == NULL) ||
+             ((argPtr != NULL) && (strcmp(argPtr, Syntax[i].argPtr) == 0))))
+        {
+            return Syntax[i].numWords;
+        }
+    }
+
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the scenario, checking that each line has the right number of words, and setting the
+ * environment variables it sets.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadScenario
+(
+    void
+)
+{
+    Line_t line = { .lineNum = 0 };
+
+    FILE *filePtr = fopen(FileNamePtr, "r");
+    LE_FATAL_IF(filePtr == NULL, "Can't open scenario '%s' (%m)", FileNamePtr);
+
+    while (fgets(line.text, sizeof(line.text), filePtr) != NULL)
+    {
+        line.lineNum++;
+
+        // The command (and its first argument) decide how the line is split.
+        Line_t *linePtr = &Lines[NumLines];
+        *linePtr = line;
+        SplitLine(linePtr, 3);
+        if (linePtr->numWords == 0)
+        {
+            continue;
+        }
+
+        size_t numWords = GetNumWords(linePtr->wordPtrs[0],
+                                      (linePtr->numWords > 1) ? linePtr->wordPtrs[1] : NULL);
+        if (numWords == 0)
+        {
+            Fail(linePtr, "Unknown command '%s'", linePtr->text);
+        }
+
+        *linePtr = line;
+        SplitLine(linePtr, numWords);
+        if ((linePtr->numWords != numWords) &&
+            !((strcmp(linePtr->wordPtrs[0], "restart") == 0) && (linePtr->numWords == 1)))
+        {
+            Fail(linePtr, "Wrong number of arguments");
+        }
+
+        const char *cmdPtr = linePtr->wordPtrs[0];
+        if (strcmp(cmdPtr, "env") == 0)
+        {
+            setenv(linePtr->wordPtrs[1], linePtr->wordPtrs[2], 1);
+        }
+        else if ((strcmp(cmdPtr, "expect") == 0) &&
+                 ((strcmp(linePtr->wordPtrs[1], "wakes") == 0) ||
+                  (strcmp(linePtr->wordPtrs[1], "pushes") == 0)))
+        {
+            // Counters are read at every mark.
+            FindCounter(linePtr->wordPtrs[1][0] == 'p', linePtr->wordPtrs[4]);
+        }
+
+        LE_FATAL_IF(++NumLines >= MAX_LINES, "Scenario too long");
+    }
+
+    fclose(filePtr);
+}
+
+int main
+(
+    int argc,
+    char *argv[]
+)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s SCENARIO_FILE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FileNamePtr = argv[1];
+    ReadScenario();
+
+    // A state file left over from an earlier run would be resumed from.
+    const char *statePathPtr = getenv("BUZZER_STATE_FILE");
+    if (statePathPtr != NULL)
+    {
+        unlink(statePathPtr);
+    }
+
+    // Each phase runs in a process of its own, which ends without cleaning up, as if it had
+    // crashed, and the next phase carries on from the time it got to.
+    uint64_t timeNs = SIM_START_NS;
+    size_t line = 0;
+    for (;;)
+    {
+        int fds[2];
+        LE_ASSERT(pipe(fds) == 0);
+
+        pid_t pid = fork();
+        LE_ASSERT(pid != -1);
+        if (pid == 0)
+        {
+            close(fds[0]);
+            sim_SetTimeNs(timeNs);
+            RunPhase(line);
+            timeNs = sim_GetTimeNs();
+            LE_ASSERT(write(fds[1], &timeNs, sizeof(timeNs)) == sizeof(timeNs));
+            _exit(EXIT_SUCCESS);
+        }
+
+        close(fds[1]);
+        int status;
+        LE_ASSERT(waitpid(pid, &status, 0) == pid);
+        bool ok = (read(fds[0], &timeNs, sizeof(timeNs)) == sizeof(timeNs));
+        close(fds[0]);
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS) || !ok)
+        {
+            return EXIT_FAILURE;
+        }
+
+        // Find where the phase stopped.
+        while ((line < NumLines) && (strcmp(Lines[line].wordPtrs[0], "restart") != 0))
+        {
+            line++;
+        }
+        if (line >= NumLines)
+        {
+            break;
+        }
+        if (Lines[line].numWords > 1)
+        {
+            timeNs += ParseDuration(&Lines[line], Lines[line].wordPtrs[1]);
+        }
+        line++;
+    }
+
+    printf("%s: passed\n", FileNamePtr);
+    return EXIT_SUCCESS;
+}
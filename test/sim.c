@@ -0,0 +1,489 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Simulated clock, and timerfds armed on it.
+ *
+ * A simulated timerfd is an eventfd, which reads the same way (an 8-byte expiry count) and can be
+ * monitored the same way.  Expiring it adds 1 to the count, which wakes whichever thread's event
+ * loop monitors it.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "host.h"
+#include "sim.h"
+
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+/// Most simulated timerfds.
+#define MAX_TIMERS 32
+
+/// Most writes that can be rejected.
+#define MAX_REJECTS 8
+
+/// Nanoseconds per second.
+#define NS_PER_SEC 1000000000ULL
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A simulated timerfd.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int fd;                     ///< eventfd standing in for the timerfd.
+    uint64_t deadlineNs;        ///< Time of the next expiry (0 = disarmed).
+    uint64_t intervalNs;        ///< Interval between expiries (0 = expires once).
+}
+Timer_t;
+
+/// Protects the timers (which are armed by the component's threads).
+static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static Timer_t Timers[MAX_TIMERS];
+static size_t NumTimers = 0;
+
+/// Simulated time.
+static uint64_t NowNs = SIM_START_NS;
+
+/// How long after its deadline each expiry is delivered.
+static uint64_t LatencyNs = 0;
+
+/// Number of times a timer has been found to have expired.
+static uint64_t ExpiryCount = 0;
+
+/// Number of snapshots applied by the engine.
+static uint64_t ApplyCount = 0;
+
+/// Log of the null backend's records, and the number of records copied into it.
+static backend_Record_t *EdgeLog = NULL;
+static size_t EdgeLogSize = 0;
+static size_t EdgeCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A value that writes to a file are rejected with.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    dev_t dev;                  ///< Device of the file.
+    ino_t ino;                  ///< Inode of the file.
+    char value[32];             ///< Value.
+}
+Reject_t;
+
+static Reject_t Rejects[MAX_REJECTS];
+static size_t NumRejects = 0;
+
+void __real_stats_RecordApply(uint64_t writeCount);
+bool __real_backend_WriteAttr(int fd, const char *strPtr, size_t len);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Converts a timespec to nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ToNs
+(
+    const struct timespec *timePtr
+)
+{
+    return ((uint64_t)timePtr->tv_sec * NS_PER_SEC) + (uint64_t)timePtr->tv_nsec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds a simulated timerfd.
+ *
+ * @return The timer, or NULL if the fd isn't one.
+ */
+//--------------------------------------------------------------------------------------------------
+static Timer_t *FindTimer
+(
+    int fd
+)
+{
+    for (size_t i = 0; i < NumTimers; i++)
+    {
+        if (Timers[i].fd == fd)
+        {
+            return &Timers[i];
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stands in for timerfd_create().
+ *
+ * @return The fd, or -1 (with errno set) on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+int sim_TimerfdCreate
+(
+    int clockId,
+    int flags
+)
+{
+    if (clockId != CLOCK_MONOTONIC)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = eventfd(0, ((flags & TFD_NONBLOCK) ? EFD_NONBLOCK : 0) |
+                        ((flags & TFD_CLOEXEC) ? EFD_CLOEXEC : 0));
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&Mutex);
+    LE_FATAL_IF(NumTimers >= MAX_TIMERS, "Too many simulated timers");
+    Timers[NumTimers].fd = fd;
+    Timers[NumTimers].deadlineNs = 0;
+    Timers[NumTimers].intervalNs = 0;
+    NumTimers++;
+    pthread_mutex_unlock(&Mutex);
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stands in for timerfd_settime().  As with a real timerfd, any expiries that haven't been read
+ * are discarded.
+ *
+ * @return 0, or -1 (with errno set) on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+int sim_TimerfdSettime
+(
+    int fd,
+    int flags,
+    const struct itimerspec *newValuePtr,
+    struct itimerspec *oldValuePtr
+)
+{
+    LE_ASSERT(oldValuePtr == NULL);
+
+    pthread_mutex_lock(&Mutex);
+    Timer_t *timerPtr = FindTimer(fd);
+    if (timerPtr == NULL)
+    {
+        pthread_mutex_unlock(&Mutex);
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t count;
+    int fdFlags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, fdFlags | O_NONBLOCK);
+    if (read(fd, &count, sizeof(count)) < 0)
+    {
+        LE_FATAL_IF(errno != EAGAIN, "read() failed (%m)");
+    }
+    fcntl(fd, F_SETFL, fdFlags);
+
+    uint64_t valueNs = ToNs(&newValuePtr->it_value);
+    timerPtr->intervalNs = ToNs(&newValuePtr->it_interval);
+    if (valueNs == 0)
+    {
+        timerPtr->deadlineNs = 0;
+    }
+    else if (flags & TFD_TIMER_ABSTIME)
+    {
+        // A deadline that has passed expires at the next opportunity.
+        timerPtr->deadlineNs = (valueNs > NowNs) ? valueNs : NowNs;
+    }
+    else
+    {
+        timerPtr->deadlineNs = NowNs + valueNs;
+    }
+    pthread_mutex_unlock(&Mutex);
+
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the simulated clock (stands in for the real backend_GetMonotonicNs()).
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t backend_GetMonotonicNs
+(
+    void
+)
+{
+    return __atomic_load_n(&NowNs, __ATOMIC_SEQ_CST);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counts the snapshots applied by the engine, and passes them on to the statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+void __wrap_stats_RecordApply
+(
+    uint64_t writeCount
+)
+{
+    __atomic_add_fetch(&ApplyCount, 1, __ATOMIC_SEQ_CST);
+    __real_stats_RecordApply(writeCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Writes to a sysfs attribute, unless the value is one the attribute has been set to reject.
+ * When the attribute is a plain file standing in for one, the write replaces the whole file, as it
+ * would the attribute's value.
+ *
+ * @return true if the whole string was written.
+ */
+//--------------------------------------------------------------------------------------------------
+bool __wrap_backend_WriteAttr
+(
+    int fd,
+    const char *strPtr,
+    size_t len
+)
+{
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < NumRejects; i++)
+    {
+        if ((Rejects[i].dev == fileStat.st_dev) && (Rejects[i].ino == fileStat.st_ino) &&
+            (strlen(Rejects[i].value) == len) && (memcmp(Rejects[i].value, strPtr, len) == 0))
+        {
+            errno = EINVAL;
+            return false;
+        }
+    }
+
+    if (!__real_backend_WriteAttr(fd, strPtr, len))
+    {
+        return false;
+    }
+
+    if (S_ISREG(fileStat.st_mode) && (ftruncate(fd, (off_t)len) != 0))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t sim_GetTimeNs
+(
+    void
+)
+{
+    return backend_GetMonotonicNs();
+}
+
+void sim_SetTimeNs
+(
+    uint64_t timeNs
+)
+{
+    LE_FATAL_IF(timeNs < NowNs, "Simulated time can't go back");
+    __atomic_store_n(&NowNs, timeNs, __ATOMIC_SEQ_CST);
+}
+
+void sim_SetLatencyNs
+(
+    uint64_t latencyNs
+)
+{
+    LatencyNs = latencyNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copies the null backend's new records into the log.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CopyEdges
+(
+    void
+)
+{
+    uint64_t recordCount = backend_GetNullRecordCount();
+
+    // The null backend starts counting afresh when it is opened.
+    if (recordCount < EdgeCount)
+    {
+        EdgeCount = 0;
+    }
+
+    while (EdgeCount < recordCount)
+    {
+        if (EdgeCount >= EdgeLogSize)
+        {
+            EdgeLogSize = (EdgeLogSize == 0) ? 1024 : (EdgeLogSize * 2);
+            EdgeLog = realloc(EdgeLog, EdgeLogSize * sizeof(EdgeLog[0]));
+            LE_ASSERT(EdgeLog != NULL);
+        }
+
+        LE_FATAL_IF(backend_GetNullRecord(EdgeCount, &EdgeLog[EdgeCount]) != LE_OK,
+                    "Output change %zu was overwritten before it could be logged", EdgeCount);
+        EdgeCount++;
+    }
+}
+
+void sim_Settle
+(
+    void
+)
+{
+    for (;;)
+    {
+        while (host_ServiceLoop(0) > 0)
+        {
+        }
+
+        if (host_IsIdle())
+        {
+            break;
+        }
+
+        // Another thread is busy.
+        sched_yield();
+    }
+
+    CopyEdges();
+}
+
+void sim_AdvanceTo
+(
+    uint64_t timeNs
+)
+{
+    sim_Settle();
+
+    for (;;)
+    {
+        Timer_t *nextPtr = NULL;
+
+        pthread_mutex_lock(&Mutex);
+        for (size_t i = 0; i < NumTimers; i++)
+        {
+            if ((Timers[i].deadlineNs != 0) && (Timers[i].deadlineNs <= timeNs) &&
+                ((nextPtr == NULL) || (Timers[i].deadlineNs < nextPtr->deadlineNs)))
+            {
+                nextPtr = &Timers[i];
+            }
+        }
+
+        if (nextPtr == NULL)
+        {
+            pthread_mutex_unlock(&Mutex);
+            break;
+        }
+
+        uint64_t expiryNs = nextPtr->deadlineNs + LatencyNs;
+        if (expiryNs > NowNs)
+        {
+            __atomic_store_n(&NowNs, expiryNs, __ATOMIC_SEQ_CST);
+        }
+
+        // As with a real timerfd, a repeating timer that is read late reports all the expiries
+        // since it was last read at once.
+        uint64_t count = 1;
+        if (nextPtr->intervalNs == 0)
+        {
+            nextPtr->deadlineNs = 0;
+        }
+        else
+        {
+            nextPtr->deadlineNs += nextPtr->intervalNs;
+            if (nextPtr->deadlineNs <= NowNs)
+            {
+                uint64_t missed = ((NowNs - nextPtr->deadlineNs) / nextPtr->intervalNs) + 1;
+                count += missed;
+                nextPtr->deadlineNs += missed * nextPtr->intervalNs;
+            }
+        }
+        ExpiryCount++;
+
+        LE_ASSERT(write(nextPtr->fd, &count, sizeof(count)) == sizeof(count));
+        pthread_mutex_unlock(&Mutex);
+
+        sim_Settle();
+    }
+
+    if (timeNs > NowNs)
+    {
+        __atomic_store_n(&NowNs, timeNs, __ATOMIC_SEQ_CST);
+    }
+}
+
+uint64_t sim_GetExpiryCount
+(
+    void
+)
+{
+    return ExpiryCount;
+}
+
+le_result_t sim_RejectWrite
+(
+    const char *pathPtr,
+    const char *valuePtr
+)
+{
+    struct stat fileStat;
+
+    LE_FATAL_IF(NumRejects >= MAX_REJECTS, "Too many rejected writes");
+    if (stat(pathPtr, &fileStat) != 0)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    Reject_t *rejectPtr = &Rejects[NumRejects];
+    rejectPtr->dev = fileStat.st_dev;
+    rejectPtr->ino = fileStat.st_ino;
+    if (le_utf8_Copy(rejectPtr->value, valuePtr, sizeof(rejectPtr->value), NULL) != LE_OK)
+    {
+        return LE_OVERFLOW;
+    }
+    NumRejects++;
+
+    return LE_OK;
+}
+
+uint64_t sim_GetApplyCount
+(
+    void
+)
+{
+    return __atomic_load_n(&ApplyCount, __ATOMIC_SEQ_CST);
+}
+
+size_t sim_GetEdgeCount
+(
+    void
+)
+{
+    return EdgeCount;
+}
+
+const backend_Record_t *sim_GetEdge
+(
+    size_t index
+)
+{
+    LE_ASSERT(index < EdgeCount);
+    return &EdgeLog[index];
+}
@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sim.h
+ *
+ * Simulated clock for running the component on a plain Linux box (see README.md).
+ *
+ * When the component is built with BUZZER_VIRTUAL_CLOCK defined, backend_GetMonotonicNs() reads
+ * the simulated clock, and timerfds (the engine's, and those of Legato timers) are armed on it
+ * (see stub/sys/timerfd.h).  The clock stands still until the host program moves it on with
+ * sim_AdvanceTo(), which expires the timers that fall due in deadline order, letting the
+ * component's threads handle each expiry before moving on.  So a scenario of any length runs in
+ * as much time as the component takes to handle it, and runs the same way every time.
+ *
+ * What the component does is looked at through the null output backend's records (see
+ * backend_GetNullRecord()), which are copied into an unbounded log as time is advanced, and
+ * through the number of snapshots the engine has applied.
+ *
+ * Other backends can be run on plain files standing in for their sysfs attributes.  A write to
+ * one replaces the whole file, as it would an attribute's value, and particular values can be
+ * rejected, as hardware that can't take them would (see sim_RejectWrite()).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_H_INCLUDE_GUARD
+#define SIM_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "backend.h"
+
+/// Time the simulated clock starts at (well clear of 0, which some of the component treats as
+/// "never").
+#define SIM_START_NS 1000000000000ULL
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the simulated time.
+ *
+ * @return The time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t sim_GetTimeNs
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets the simulated time, without expiring any timers.  Only for use before the component is
+ * started, or to simulate the time that passes while the process isn't running.  Time can't be
+ * set back.
+ */
+//--------------------------------------------------------------------------------------------------
+void sim_SetTimeNs
+(
+    uint64_t timeNs             ///< Time in nanoseconds.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets how long after its deadline each timer expiry is handled, as if the thread handling it
+ * were held up by that long.  The clock is moved on by that much before each expiry is
+ * delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+void sim_SetLatencyNs
+(
+    uint64_t latencyNs          ///< Latency in nanoseconds (0 = none, the default).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lets the component's threads handle everything they have been sent, without moving the clock.
+ */
+//--------------------------------------------------------------------------------------------------
+void sim_Settle
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Moves the simulated clock on to a given time, expiring timers in deadline order and settling
+ * after each (see sim_Settle()).
+ */
+//--------------------------------------------------------------------------------------------------
+void sim_AdvanceTo
+(
+    uint64_t timeNs             ///< Time in nanoseconds (ignored if it has already passed).
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of timer expiries delivered so far (to the engine, and to Legato timers).  A
+ * repeating timer that expired more than once before it was read counts once, as it wakes its
+ * thread once.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t sim_GetExpiryCount
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Makes writes of a value to a sysfs attribute (or a file standing in for one) fail with EINVAL,
+ * from now on.
+ *
+ * @return LE_OK, LE_NOT_FOUND if the file doesn't exist, or LE_OVERFLOW if the value is too long.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sim_RejectWrite
+(
+    const char *pathPtr,        ///< Path of the file.
+    const char *valuePtr        ///< Value to reject.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of snapshots the engine has applied so far (each time it has been told to play,
+ * stop or change what it is playing).
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t sim_GetApplyCount
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of output changes logged so far.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t sim_GetEdgeCount
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets an output change from the log.
+ *
+ * @return The change.
+ */
+//--------------------------------------------------------------------------------------------------
+const backend_Record_t *sim_GetEdge
+(
+    size_t index                ///< Index (less than sim_GetEdgeCount()).
+);
+
+#endif // SIM_H_INCLUDE_GUARD
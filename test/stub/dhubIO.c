@@ -0,0 +1,444 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Host stand-in for the Data Hub I/O API.  Resources are kept in a table in memory.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "host.h"
+
+/// Most resources the component can create.
+#define MAX_RESOURCES 64
+
+/// Longest path or value kept (including the terminator).
+#define MAX_PATH_BYTES 64
+#define MAX_VALUE_BYTES 2048
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A resource.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char path[MAX_PATH_BYTES];                      ///< Path, relative to the app's root.
+    dhubIO_DataType_t type;                         ///< Data type.
+    bool isInput;                                   ///< true for inputs, false for outputs.
+    union
+    {
+        dhubIO_BooleanPushHandlerFunc_t boolean;
+        dhubIO_NumericPushHandlerFunc_t numeric;
+        dhubIO_JsonPushHandlerFunc_t json;
+    }
+    handler;                                        ///< Push handler (outputs only).
+    bool hasHandler;                                ///< true if a push handler has been added.
+    void *contextPtr;                               ///< Push handler's context.
+    uint64_t pushCount;                             ///< Values pushed (inputs only).
+    char value[MAX_VALUE_BYTES];                    ///< Last value pushed (or default), as text.
+}
+Resource_t;
+
+static Resource_t Resources[MAX_RESOURCES];
+static size_t NumResources = 0;
+
+/// Statistics of the push handlers called.
+static host_PushStats_t PushStats;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds a resource.
+ *
+ * @return The resource, or NULL if there is none with that path.
+ */
+//--------------------------------------------------------------------------------------------------
+static Resource_t *FindResource
+(
+    const char *path
+)
+{
+    for (size_t i = 0; i < NumResources; i++)
+    {
+        if (strcmp(Resources[i].path, path) == 0)
+        {
+            return &Resources[i];
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Creates a resource.
+ *
+ * @return LE_OK, or LE_DUPLICATE if it exists with a different type or direction.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CreateResource
+(
+    const char *path,
+    dhubIO_DataType_t type,
+    bool isInput
+)
+{
+    Resource_t *resPtr = FindResource(path);
+
+    if (resPtr != NULL)
+    {
+        return ((resPtr->type == type) && (resPtr->isInput == isInput)) ? LE_OK : LE_DUPLICATE;
+    }
+
+    LE_FATAL_IF(NumResources >= MAX_RESOURCES, "Too many resources");
+    resPtr = &Resources[NumResources++];
+    memset(resPtr, 0, sizeof(*resPtr));
+    le_utf8_Copy(resPtr->path, path, sizeof(resPtr->path), NULL);
+    resPtr->type = type;
+    resPtr->isInput = isInput;
+
+    return LE_OK;
+}
+
+le_result_t dhubIO_CreateInput
+(
+    const char *path,
+    dhubIO_DataType_t type,
+    const char *units
+)
+{
+    return CreateResource(path, type, true);
+}
+
+le_result_t dhubIO_CreateOutput
+(
+    const char *path,
+    dhubIO_DataType_t type,
+    const char *units
+)
+{
+    return CreateResource(path, type, false);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a value pushed to an input.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordPush
+(
+    const char *path,
+    dhubIO_DataType_t type,
+    const char *valuePtr
+)
+{
+    Resource_t *resPtr = FindResource(path);
+
+    LE_FATAL_IF((resPtr == NULL) || !resPtr->isInput || (resPtr->type != type),
+                "Push to '%s', which isn't an input of that type", path);
+    resPtr->pushCount++;
+    le_utf8_Copy(resPtr->value, valuePtr, sizeof(resPtr->value), NULL);
+}
+
+void dhubIO_PushTrigger
+(
+    const char *path,
+    double timestamp
+)
+{
+    RecordPush(path, DHUBIO_DATA_TYPE_TRIGGER, "");
+}
+
+void dhubIO_PushBoolean
+(
+    const char *path,
+    double timestamp,
+    bool value
+)
+{
+    RecordPush(path, DHUBIO_DATA_TYPE_BOOLEAN, value ? "true" : "false");
+}
+
+void dhubIO_PushNumeric
+(
+    const char *path,
+    double timestamp,
+    double value
+)
+{
+    char text[32];
+
+    snprintf(text, sizeof(text), "%.9g", value);
+    RecordPush(path, DHUBIO_DATA_TYPE_NUMERIC, text);
+}
+
+void dhubIO_PushJson
+(
+    const char *path,
+    double timestamp,
+    const char *value
+)
+{
+    RecordPush(path, DHUBIO_DATA_TYPE_JSON, value);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finds an output to add a push handler to.
+ *
+ * @return The output.
+ */
+//--------------------------------------------------------------------------------------------------
+static Resource_t *FindOutput
+(
+    const char *path,
+    dhubIO_DataType_t type,
+    void *contextPtr
+)
+{
+    Resource_t *resPtr = FindResource(path);
+
+    LE_FATAL_IF((resPtr == NULL) || resPtr->isInput || (resPtr->type != type),
+                "Push handler for '%s', which isn't an output of that type", path);
+    resPtr->hasHandler = true;
+    resPtr->contextPtr = contextPtr;
+
+    return resPtr;
+}
+
+dhubIO_BooleanPushHandlerRef_t dhubIO_AddBooleanPushHandler
+(
+    const char *path,
+    dhubIO_BooleanPushHandlerFunc_t callbackPtr,
+    void *contextPtr
+)
+{
+    Resource_t *resPtr = FindOutput(path, DHUBIO_DATA_TYPE_BOOLEAN, contextPtr);
+    resPtr->handler.boolean = callbackPtr;
+
+    return (dhubIO_BooleanPushHandlerRef_t)resPtr;
+}
+
+dhubIO_NumericPushHandlerRef_t dhubIO_AddNumericPushHandler
+(
+    const char *path,
+    dhubIO_NumericPushHandlerFunc_t callbackPtr,
+    void *contextPtr
+)
+{
+    Resource_t *resPtr = FindOutput(path, DHUBIO_DATA_TYPE_NUMERIC, contextPtr);
+    resPtr->handler.numeric = callbackPtr;
+
+    return (dhubIO_NumericPushHandlerRef_t)resPtr;
+}
+
+dhubIO_JsonPushHandlerRef_t dhubIO_AddJsonPushHandler
+(
+    const char *path,
+    dhubIO_JsonPushHandlerFunc_t callbackPtr,
+    void *contextPtr
+)
+{
+    Resource_t *resPtr = FindOutput(path, DHUBIO_DATA_TYPE_JSON, contextPtr);
+    resPtr->handler.json = callbackPtr;
+
+    return (dhubIO_JsonPushHandlerRef_t)resPtr;
+}
+
+void dhubIO_SetBooleanDefault
+(
+    const char *path,
+    bool value
+)
+{
+    Resource_t *resPtr = FindResource(path);
+
+    LE_ASSERT(resPtr != NULL);
+    le_utf8_Copy(resPtr->value, value ? "true" : "false", sizeof(resPtr->value), NULL);
+}
+
+void dhubIO_SetNumericDefault
+(
+    const char *path,
+    double value
+)
+{
+    Resource_t *resPtr = FindResource(path);
+
+    LE_ASSERT(resPtr != NULL);
+    snprintf(resPtr->value, sizeof(resPtr->value), "%.9g", value);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the CPU time used by the calling thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetCpuNs
+(
+    void
+)
+{
+    struct timespec now;
+
+    LE_ASSERT(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes a value to one of the component's outputs, as the Data Hub would, with a given timestamp.
+ *
+ * @return LE_OK, LE_NOT_FOUND or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t host_PushAt
+(
+    const char *pathPtr,
+    const char *valuePtr,
+    double timestamp
+)
+{
+    Resource_t *resPtr = FindResource(pathPtr);
+    bool boolean = false;
+    double numeric = 0;
+
+    if ((resPtr == NULL) || resPtr->isInput || !resPtr->hasHandler)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    switch (resPtr->type)
+    {
+        case DHUBIO_DATA_TYPE_BOOLEAN:
+            if ((strcmp(valuePtr, "true") == 0) || (strcmp(valuePtr, "1") == 0))
+            {
+                boolean = true;
+            }
+            else if ((strcmp(valuePtr, "false") != 0) && (strcmp(valuePtr, "0") != 0))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            break;
+
+        case DHUBIO_DATA_TYPE_NUMERIC:
+        {
+            char *endPtr;
+            numeric = strtod(valuePtr, &endPtr);
+            if ((endPtr == valuePtr) || (*endPtr != '\0'))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    // The Data Hub timestamps pushes with the time of day.
+    if (timestamp == 0)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        timestamp = (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+    }
+
+    uint64_t startNs = GetCpuNs();
+    switch (resPtr->type)
+    {
+        case DHUBIO_DATA_TYPE_BOOLEAN:
+            resPtr->handler.boolean(timestamp, boolean, resPtr->contextPtr);
+            break;
+
+        case DHUBIO_DATA_TYPE_NUMERIC:
+            resPtr->handler.numeric(timestamp, numeric, resPtr->contextPtr);
+            break;
+
+        default:
+            resPtr->handler.json(timestamp, valuePtr, resPtr->contextPtr);
+            break;
+    }
+    uint64_t handlerNs = GetCpuNs() - startNs;
+
+    PushStats.count++;
+    PushStats.totalNs += handlerNs;
+    if (handlerNs > PushStats.maxNs)
+    {
+        PushStats.maxNs = handlerNs;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pushes a value to one of the component's outputs, as the Data Hub would.
+ *
+ * @return LE_OK, LE_NOT_FOUND or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t host_Push
+(
+    const char *pathPtr,
+    const char *valuePtr
+)
+{
+    return host_PushAt(pathPtr, valuePtr, 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the statistics of the push handlers called through host_Push().
+ */
+//--------------------------------------------------------------------------------------------------
+void host_GetPushStats
+(
+    host_PushStats_t *statsPtr,
+    bool reset
+)
+{
+    *statsPtr = PushStats;
+    if (reset)
+    {
+        memset(&PushStats, 0, sizeof(PushStats));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of times the component has pushed a value to one of its inputs.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t host_GetPushCount
+(
+    const char *pathPtr
+)
+{
+    Resource_t *resPtr = FindResource(pathPtr);
+
+    return ((resPtr != NULL) && resPtr->isInput) ? resPtr->pushCount : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the last value the component pushed to one of its inputs.
+ *
+ * @return The value, or NULL if nothing has been pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+const char *host_GetPushedValue
+(
+    const char *pathPtr
+)
+{
+    Resource_t *resPtr = FindResource(pathPtr);
+
+    if ((resPtr == NULL) || !resPtr->isInput || (resPtr->pushCount == 0))
+    {
+        return NULL;
+    }
+
+    return resPtr->value;
+}
@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Host stand-in for i2c-dev devices (see sys/ioctl.h).  A plain file opened in place of an i2c-dev
+ * device behaves as a bus with a single device on it, which answers at any address.
+ *
+ * The file is a log of the messages written to the device: each is a register address followed by
+ * the value written to it, as a write() to an i2c-dev device sends them.  Whatever the file holds
+ * when the address is set (I2C_SLAVE or I2C_SLAVE_FORCE) is taken as the writes that gave the
+ * device's registers their first values, and the component's writes are added to the end of it.
+ * Registers are read (I2C_RDWR) by replaying the log; registers that have never been written read
+ * as 0.  So a host program can set the device up, and see exactly what was written to it, by
+ * reading and writing the file.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// The system's ioctl().
+#undef ioctl
+
+/// Number of registers the device has.
+#define NUM_REGS 256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the device's registers, by replaying the log of writes to it.
+ *
+ * @return 0, or -1 (with errno set) on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static int ReadRegs
+(
+    int fd,
+    uint8_t *regsPtr            ///< [OUT] Registers (NUM_REGS of them).
+)
+{
+    uint8_t msg[2];
+    off_t offset = 0;
+    ssize_t len;
+
+    memset(regsPtr, 0, NUM_REGS);
+    while ((len = pread(fd, msg, sizeof(msg), offset)) == sizeof(msg))
+    {
+        regsPtr[msg[0]] = msg[1];
+        offset += len;
+    }
+
+    return (len < 0) ? -1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Makes a combined transaction (I2C_RDWR).  The only reads supported are of registers, by writing
+ * the address of the first one, then reading them in turn.
+ *
+ * @return The number of messages, or -1 (with errno set) on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static int Transfer
+(
+    int fd,
+    const struct i2c_rdwr_ioctl_data *transferPtr
+)
+{
+    uint8_t regs[NUM_REGS];
+    uint8_t reg = 0;
+
+    if (ReadRegs(fd, regs) != 0)
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < transferPtr->nmsgs; i++)
+    {
+        const struct i2c_msg *msgPtr = &transferPtr->msgs[i];
+
+        if (msgPtr->flags & I2C_M_RD)
+        {
+            for (uint16_t j = 0; j < msgPtr->len; j++)
+            {
+                msgPtr->buf[j] = regs[reg++];
+            }
+        }
+        else if (msgPtr->len == 1)
+        {
+            reg = msgPtr->buf[0];
+        }
+        else
+        {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+    }
+
+    return (int)transferPtr->nmsgs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stands in for ioctl().
+ *
+ * @return As for ioctl().
+ */
+//--------------------------------------------------------------------------------------------------
+int stub_Ioctl
+(
+    int fd,
+    unsigned long request,
+    ...
+)
+{
+    va_list args;
+    va_start(args, request);
+    void *argPtr = va_arg(args, void *);
+    va_end(args);
+
+    struct stat fileStat;
+    if (((request != I2C_SLAVE) && (request != I2C_SLAVE_FORCE) && (request != I2C_RDWR)) ||
+        (fstat(fd, &fileStat) != 0) || !S_ISREG(fileStat.st_mode))
+    {
+        return ioctl(fd, request, argPtr);
+    }
+
+    if (request == I2C_RDWR)
+    {
+        return Transfer(fd, argPtr);
+    }
+
+    // Writes are added to the end of the log.
+    return (lseek(fd, 0, SEEK_END) < 0) ? -1 : 0;
+}
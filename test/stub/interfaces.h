@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file interfaces.h
+ *
+ * Host stand-in for the Data Hub I/O API (io.api), which the component binds to as dhubIO.
+ * Resources are kept in memory (see dhubIO.c): pushes to the component's inputs are recorded,
+ * and the host program pushes values to its outputs through host_Push() (see ../host.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef INTERFACES_H_INCLUDE_GUARD
+#define INTERFACES_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+/// Timestamp meaning "now".
+#define DHUBIO_NOW 0
+
+typedef enum
+{
+    DHUBIO_DATA_TYPE_TRIGGER,
+    DHUBIO_DATA_TYPE_BOOLEAN,
+    DHUBIO_DATA_TYPE_NUMERIC,
+    DHUBIO_DATA_TYPE_STRING,
+    DHUBIO_DATA_TYPE_JSON,
+}
+dhubIO_DataType_t;
+
+typedef struct dhubIO_BooleanPushHandler *dhubIO_BooleanPushHandlerRef_t;
+typedef struct dhubIO_NumericPushHandler *dhubIO_NumericPushHandlerRef_t;
+typedef struct dhubIO_JsonPushHandler *dhubIO_JsonPushHandlerRef_t;
+
+typedef void (*dhubIO_BooleanPushHandlerFunc_t)(double timestamp, bool value, void *contextPtr);
+typedef void (*dhubIO_NumericPushHandlerFunc_t)(double timestamp, double value, void *contextPtr);
+typedef void (*dhubIO_JsonPushHandlerFunc_t)(double timestamp, const char *value,
+                                             void *contextPtr);
+
+le_result_t dhubIO_CreateInput(const char *path, dhubIO_DataType_t type, const char *units);
+le_result_t dhubIO_CreateOutput(const char *path, dhubIO_DataType_t type, const char *units);
+
+void dhubIO_PushTrigger(const char *path, double timestamp);
+void dhubIO_PushBoolean(const char *path, double timestamp, bool value);
+void dhubIO_PushNumeric(const char *path, double timestamp, double value);
+void dhubIO_PushJson(const char *path, double timestamp, const char *value);
+
+dhubIO_BooleanPushHandlerRef_t dhubIO_AddBooleanPushHandler(
+    const char *path, dhubIO_BooleanPushHandlerFunc_t callbackPtr, void *contextPtr);
+dhubIO_NumericPushHandlerRef_t dhubIO_AddNumericPushHandler(
+    const char *path, dhubIO_NumericPushHandlerFunc_t callbackPtr, void *contextPtr);
+dhubIO_JsonPushHandlerRef_t dhubIO_AddJsonPushHandler(
+    const char *path, dhubIO_JsonPushHandlerFunc_t callbackPtr, void *contextPtr);
+
+void dhubIO_SetBooleanDefault(const char *path, bool value);
+void dhubIO_SetNumericDefault(const char *path, double value);
+
+#endif // INTERFACES_H_INCLUDE_GUARD
@@ -0,0 +1,1082 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Host stand-in for the Legato framework.
+ *
+ * Each thread has its own event loop: a set of fd monitors, polled together, and a queue of
+ * deferred functions, with an eventfd to wake the thread when something is queued.  Timers are
+ * timerfds monitored by the loop of the thread that created them.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "host.h"
+
+#include <stdarg.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/// Most fd monitors (and timers) a thread can have.
+#define MAX_MONITORS 32
+
+/// Most fd monitors (and timers) altogether.
+#define MAX_ALL_MONITORS 128
+
+/// Most functions that can be queued to a thread at a time.
+#define QUEUE_SIZE 4096
+
+/// Most threads.
+#define MAX_THREADS 16
+
+/// Longest name kept for threads, monitors and timers (including the terminator).
+#define MAX_NAME_BYTES 32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * An fd monitor.
+ */
+//--------------------------------------------------------------------------------------------------
+struct le_fdMonitor
+{
+    char name[MAX_NAME_BYTES];                  ///< Name, for host_GetWakeCount().
+    int fd;                                     ///< File descriptor.
+    le_fdMonitor_HandlerFunc_t handlerFunc;     ///< Handler.
+    short events;                               ///< Events to poll for.
+    uint64_t wakeCount;                         ///< Times the handler has been called.
+    le_timer_Ref_t timerRef;                    ///< Timer whose timerfd this is (or NULL).
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A function queued to a thread.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_event_DeferredFunc_t func;
+    void *param1Ptr;
+    void *param2Ptr;
+}
+Deferred_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A thread, and its event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+struct le_thread
+{
+    char name[MAX_NAME_BYTES];                  ///< Name.
+    pthread_t id;                               ///< pthread.
+    le_thread_MainFunc_t mainFunc;              ///< Main function.
+    void *contextPtr;                           ///< Main function's parameter.
+    bool joinable;                              ///< true if le_thread_Join() will be called.
+    int rtPriority;                             ///< SCHED_FIFO priority (0 = normal).
+
+    pthread_mutex_t mutex;                      ///< Protects the queue.
+    Deferred_t queue[QUEUE_SIZE];               ///< Queued functions (circular).
+    size_t queueHead;                           ///< Index of the oldest queued function.
+    size_t queueCount;                          ///< Number of queued functions.
+    int wakeFd;                                 ///< eventfd signalled when a function is queued.
+
+    le_fdMonitor_Ref_t monitors[MAX_MONITORS];  ///< The thread's fd monitors.
+    size_t numMonitors;                         ///< Number of entries in monitors[].
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A timer.
+ */
+//--------------------------------------------------------------------------------------------------
+struct le_timer
+{
+    char name[MAX_NAME_BYTES];                  ///< Name.
+    le_timer_ExpiryHandler_t handlerFunc;       ///< Expiry handler.
+    uint32_t intervalMs;                        ///< Interval.
+    uint32_t repeatCount;                       ///< Times to expire (0 = forever).
+    uint32_t remaining;                         ///< Times left to expire (if repeatCount != 0).
+    bool running;                               ///< true if started and not expired or stopped.
+    int fd;                                     ///< timerfd.
+};
+
+/// Main thread (the one that hasn't been created through le_thread_Create()).
+static struct le_thread MainThread = { .name = "main" };
+static pthread_once_t MainThreadOnce = PTHREAD_ONCE_INIT;
+
+/// The calling thread.
+static __thread le_thread_Ref_t CurrentThread = NULL;
+
+/// All the fd monitors, for host_GetWakeCount().
+static le_fdMonitor_Ref_t AllMonitors[MAX_ALL_MONITORS];
+static size_t NumAllMonitors = 0;
+static pthread_mutex_t AllMonitorsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/// All the threads (including the main thread), for host_IsIdle().
+static le_thread_Ref_t AllThreads[MAX_THREADS];
+static size_t NumAllThreads = 0;
+
+/// Number of threads part way through a turn of their event loop, and the number of turns taken.
+static int BusyCount = 0;
+static uint64_t TurnCount = 0;
+
+/// Lowest level of the messages logged (-1 until read from LE_LOG_LEVEL).
+static int LogLevel = -1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the text for a result code.
+ */
+//--------------------------------------------------------------------------------------------------
+const char *LE_RESULT_TXT
+(
+    le_result_t result
+)
+{
+    static const char *const texts[] =
+    {
+        "LE_OK", "LE_NOT_FOUND", "LE_NOT_POSSIBLE", "LE_OUT_OF_RANGE", "LE_NO_MEMORY",
+        "LE_NOT_PERMITTED", "LE_FAULT", "LE_COMM_ERROR", "LE_TIMEOUT", "LE_OVERFLOW",
+        "LE_UNDERFLOW", "LE_WOULD_BLOCK", "LE_DEADLOCK", "LE_FORMAT_ERROR", "LE_DUPLICATE",
+        "LE_BAD_PARAMETER", "LE_CLOSED", "LE_BUSY", "LE_UNSUPPORTED", "LE_IO_ERROR",
+        "LE_NOT_IMPLEMENTED", "LE_UNAVAILABLE", "LE_TERMINATED",
+    };
+
+    if ((result > 0) || ((size_t)-result >= NUM_ARRAY_MEMBERS(texts)))
+    {
+        return "(unknown)";
+    }
+
+    return texts[-result];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Logs a message to stderr.
+ */
+//--------------------------------------------------------------------------------------------------
+void host_Log
+(
+    le_log_Level_t level,
+    const char *fileNamePtr,
+    int line,
+    const char *formatPtr,
+    ...
+)
+{
+    static const char *const levelNames[] = { "DBUG", "INFO", "WARN", "ERR", "EMER" };
+    int savedErrno = errno;
+
+    if (LogLevel < 0)
+    {
+        const char *envPtr = getenv("LE_LOG_LEVEL");
+        LogLevel = LE_LOG_INFO;
+        for (int i = 0; (envPtr != NULL) && (i < (int)NUM_ARRAY_MEMBERS(levelNames)); i++)
+        {
+            if ((strcmp(envPtr, levelNames[i]) == 0) ||
+                ((i == LE_LOG_DEBUG) && (strcmp(envPtr, "DEBUG") == 0)) ||
+                ((i == LE_LOG_ERR) && (strcmp(envPtr, "ERROR") == 0)))
+            {
+                LogLevel = i;
+            }
+        }
+    }
+    if ((int)level < LogLevel)
+    {
+        return;
+    }
+
+    const char *baseNamePtr = strrchr(fileNamePtr, '/');
+    char message[512];
+    va_list args;
+
+    // %m in the format refers to errno as it was when the message was logged.
+    errno = savedErrno;
+    va_start(args, formatPtr);
+    vsnprintf(message, sizeof(message), formatPtr, args);
+    va_end(args);
+
+    fprintf(stderr, "%s | %s:%d | %s\n", levelNames[level],
+            (baseNamePtr != NULL) ? (baseNamePtr + 1) : fileNamePtr, line, message);
+    errno = savedErrno;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Memory pools.
+//--------------------------------------------------------------------------------------------------
+
+struct le_mem_Pool
+{
+    size_t objSize;
+};
+
+/// Header in front of each object.
+typedef union
+{
+    size_t refCount;
+    long double align;
+}
+ObjHeader_t;
+
+le_mem_PoolRef_t le_mem_CreatePool
+(
+    const char *namePtr,
+    size_t objSize
+)
+{
+    le_mem_PoolRef_t pool = calloc(1, sizeof(*pool));
+    LE_ASSERT(pool != NULL);
+    pool->objSize = objSize;
+
+    return pool;
+}
+
+le_mem_PoolRef_t le_mem_ExpandPool
+(
+    le_mem_PoolRef_t pool,
+    size_t numObjects
+)
+{
+    return pool;
+}
+
+void *le_mem_ForceAlloc
+(
+    le_mem_PoolRef_t pool
+)
+{
+    ObjHeader_t *headerPtr = calloc(1, sizeof(ObjHeader_t) + pool->objSize);
+    LE_ASSERT(headerPtr != NULL);
+    headerPtr->refCount = 1;
+
+    return headerPtr + 1;
+}
+
+void le_mem_AddRef
+(
+    void *objPtr
+)
+{
+    ((ObjHeader_t *)objPtr - 1)->refCount++;
+}
+
+void le_mem_Release
+(
+    void *objPtr
+)
+{
+    ObjHeader_t *headerPtr = (ObjHeader_t *)objPtr - 1;
+
+    LE_ASSERT(headerPtr->refCount > 0);
+    if (--headerPtr->refCount == 0)
+    {
+        free(headerPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Hash maps (separate chaining).
+//--------------------------------------------------------------------------------------------------
+
+typedef struct Entry
+{
+    const void *keyPtr;
+    const void *valuePtr;
+    struct Entry *nextPtr;
+}
+Entry_t;
+
+struct le_hashmap
+{
+    le_hashmap_HashFunc_t hashFunc;
+    le_hashmap_EqualsFunc_t equalsFunc;
+    size_t numBuckets;
+    size_t size;
+    Entry_t **buckets;
+};
+
+le_hashmap_Ref_t le_hashmap_Create
+(
+    const char *namePtr,
+    size_t capacity,
+    le_hashmap_HashFunc_t hashFunc,
+    le_hashmap_EqualsFunc_t equalsFunc
+)
+{
+    le_hashmap_Ref_t map = calloc(1, sizeof(*map));
+    LE_ASSERT(map != NULL);
+    map->hashFunc = hashFunc;
+    map->equalsFunc = equalsFunc;
+    map->numBuckets = (capacity * 2) + 1;
+    map->buckets = calloc(map->numBuckets, sizeof(Entry_t *));
+    LE_ASSERT(map->buckets != NULL);
+
+    return map;
+}
+
+static Entry_t **FindEntry
+(
+    le_hashmap_Ref_t map,
+    const void *keyPtr
+)
+{
+    Entry_t **entryPtrPtr = &map->buckets[map->hashFunc(keyPtr) % map->numBuckets];
+
+    while ((*entryPtrPtr != NULL) && !map->equalsFunc((*entryPtrPtr)->keyPtr, keyPtr))
+    {
+        entryPtrPtr = &(*entryPtrPtr)->nextPtr;
+    }
+
+    return entryPtrPtr;
+}
+
+void *le_hashmap_Put
+(
+    le_hashmap_Ref_t map,
+    const void *keyPtr,
+    const void *valuePtr
+)
+{
+    Entry_t **entryPtrPtr = FindEntry(map, keyPtr);
+
+    if (*entryPtrPtr != NULL)
+    {
+        void *oldValuePtr = (void *)(*entryPtrPtr)->valuePtr;
+        (*entryPtrPtr)->keyPtr = keyPtr;
+        (*entryPtrPtr)->valuePtr = valuePtr;
+        return oldValuePtr;
+    }
+
+    Entry_t *entryPtr = calloc(1, sizeof(*entryPtr));
+    LE_ASSERT(entryPtr != NULL);
+    entryPtr->keyPtr = keyPtr;
+    entryPtr->valuePtr = valuePtr;
+    *entryPtrPtr = entryPtr;
+    map->size++;
+
+    return NULL;
+}
+
+void *le_hashmap_Get
+(
+    le_hashmap_Ref_t map,
+    const void *keyPtr
+)
+{
+    Entry_t *entryPtr = *FindEntry(map, keyPtr);
+
+    return (entryPtr != NULL) ? (void *)entryPtr->valuePtr : NULL;
+}
+
+void *le_hashmap_Remove
+(
+    le_hashmap_Ref_t map,
+    const void *keyPtr
+)
+{
+    Entry_t **entryPtrPtr = FindEntry(map, keyPtr);
+    Entry_t *entryPtr = *entryPtrPtr;
+
+    if (entryPtr == NULL)
+    {
+        return NULL;
+    }
+
+    void *valuePtr = (void *)entryPtr->valuePtr;
+    *entryPtrPtr = entryPtr->nextPtr;
+    free(entryPtr);
+    map->size--;
+
+    return valuePtr;
+}
+
+size_t le_hashmap_Size
+(
+    le_hashmap_Ref_t map
+)
+{
+    return map->size;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Doubly linked lists (circular, with the list pointing at the head).
+//--------------------------------------------------------------------------------------------------
+
+void le_dls_Stack
+(
+    le_dls_List_t *listPtr,
+    le_dls_Link_t *newLinkPtr
+)
+{
+    le_dls_Link_t *headPtr = listPtr->headLinkPtr;
+
+    if (headPtr == NULL)
+    {
+        newLinkPtr->nextPtr = newLinkPtr;
+        newLinkPtr->prevPtr = newLinkPtr;
+    }
+    else
+    {
+        newLinkPtr->nextPtr = headPtr;
+        newLinkPtr->prevPtr = headPtr->prevPtr;
+        headPtr->prevPtr->nextPtr = newLinkPtr;
+        headPtr->prevPtr = newLinkPtr;
+    }
+    listPtr->headLinkPtr = newLinkPtr;
+}
+
+void le_dls_Remove
+(
+    le_dls_List_t *listPtr,
+    le_dls_Link_t *linkToRemovePtr
+)
+{
+    if (linkToRemovePtr->nextPtr == linkToRemovePtr)
+    {
+        listPtr->headLinkPtr = NULL;
+    }
+    else
+    {
+        linkToRemovePtr->prevPtr->nextPtr = linkToRemovePtr->nextPtr;
+        linkToRemovePtr->nextPtr->prevPtr = linkToRemovePtr->prevPtr;
+        if (listPtr->headLinkPtr == linkToRemovePtr)
+        {
+            listPtr->headLinkPtr = linkToRemovePtr->nextPtr;
+        }
+    }
+    linkToRemovePtr->nextPtr = NULL;
+    linkToRemovePtr->prevPtr = NULL;
+}
+
+le_dls_Link_t *le_dls_PeekTail
+(
+    const le_dls_List_t *listPtr
+)
+{
+    return (listPtr->headLinkPtr != NULL) ? listPtr->headLinkPtr->prevPtr : NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+// UTF-8 strings.
+//--------------------------------------------------------------------------------------------------
+
+le_result_t le_utf8_Copy
+(
+    char *destStr,
+    const char *srcStr,
+    size_t destSize,
+    size_t *numBytesPtr
+)
+{
+    size_t len = strlen(srcStr);
+    le_result_t result = LE_OK;
+
+    if (len >= destSize)
+    {
+        // Don't split a multi-byte character.
+        len = destSize - 1;
+        while ((len > 0) && (((unsigned char)srcStr[len] & 0xC0) == 0x80))
+        {
+            len--;
+        }
+        result = LE_OVERFLOW;
+    }
+
+    memcpy(destStr, srcStr, len);
+    destStr[len] = '\0';
+    if (numBytesPtr != NULL)
+    {
+        *numBytesPtr = len;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Threads.
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sets up a thread's event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitLoop
+(
+    le_thread_Ref_t thread
+)
+{
+    pthread_mutex_init(&thread->mutex, NULL);
+    thread->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    LE_ASSERT(thread->wakeFd != -1);
+
+    pthread_mutex_lock(&AllMonitorsMutex);
+    LE_FATAL_IF(NumAllThreads >= MAX_THREADS, "Too many threads");
+    AllThreads[NumAllThreads++] = thread;
+    pthread_mutex_unlock(&AllMonitorsMutex);
+}
+
+static void InitMainThread
+(
+    void
+)
+{
+    MainThread.id = pthread_self();
+    InitLoop(&MainThread);
+}
+
+le_thread_Ref_t le_thread_GetCurrent
+(
+    void
+)
+{
+    if (CurrentThread == NULL)
+    {
+        pthread_once(&MainThreadOnce, InitMainThread);
+        CurrentThread = &MainThread;
+    }
+
+    return CurrentThread;
+}
+
+le_thread_Ref_t le_thread_Create
+(
+    const char *namePtr,
+    le_thread_MainFunc_t mainFunc,
+    void *contextPtr
+)
+{
+    le_thread_Ref_t thread = calloc(1, sizeof(*thread));
+    LE_ASSERT(thread != NULL);
+
+    // Functions may be queued to the thread before it starts.
+    pthread_once(&MainThreadOnce, InitMainThread);
+    le_utf8_Copy(thread->name, namePtr, sizeof(thread->name), NULL);
+    thread->mainFunc = mainFunc;
+    thread->contextPtr = contextPtr;
+    InitLoop(thread);
+
+    return thread;
+}
+
+le_result_t le_thread_SetPriority
+(
+    le_thread_Ref_t thread,
+    le_thread_Priority_t priority
+)
+{
+    thread->rtPriority = (priority >= LE_THREAD_PRIORITY_RT_1) ?
+                         (int)(priority - LE_THREAD_PRIORITY_RT_1 + 1) : 0;
+    return LE_OK;
+}
+
+le_result_t le_thread_SetJoinable
+(
+    le_thread_Ref_t thread
+)
+{
+    thread->joinable = true;
+    return LE_OK;
+}
+
+static void *ThreadMain
+(
+    void *threadPtr
+)
+{
+    le_thread_Ref_t thread = threadPtr;
+
+    CurrentThread = thread;
+    return thread->mainFunc(thread->contextPtr);
+}
+
+void le_thread_Start
+(
+    le_thread_Ref_t thread
+)
+{
+    pthread_attr_t attr;
+    int result;
+
+    pthread_attr_init(&attr);
+    if (!thread->joinable)
+    {
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    }
+
+    if (thread->rtPriority > 0)
+    {
+        struct sched_param param = { .sched_priority = thread->rtPriority };
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+
+        result = pthread_create(&thread->id, &attr, ThreadMain, thread);
+        if (result != EPERM)
+        {
+            LE_FATAL_IF(result != 0, "Failed to start thread '%s' (%s)",
+                        thread->name, strerror(result));
+            pthread_attr_destroy(&attr);
+            return;
+        }
+
+        // Real-time priorities need privileges that a host build isn't normally given.
+        LE_WARN("Not permitted to give thread '%s' a real-time priority", thread->name);
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+    }
+
+    result = pthread_create(&thread->id, &attr, ThreadMain, thread);
+    LE_FATAL_IF(result != 0, "Failed to start thread '%s' (%s)", thread->name, strerror(result));
+    pthread_attr_destroy(&attr);
+}
+
+le_result_t le_thread_Join
+(
+    le_thread_Ref_t thread,
+    void **resultValuePtr
+)
+{
+    void *resultPtr;
+
+    LE_ASSERT(thread->joinable);
+    LE_ASSERT(pthread_join(thread->id, &resultPtr) == 0);
+    if (resultValuePtr != NULL)
+    {
+        *resultValuePtr = resultPtr;
+    }
+
+    return LE_OK;
+}
+
+void le_thread_Exit
+(
+    void *resultPtr
+)
+{
+    pthread_exit(resultPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Event loop.
+//--------------------------------------------------------------------------------------------------
+
+void le_event_QueueFunctionToThread
+(
+    le_thread_Ref_t thread,
+    le_event_DeferredFunc_t func,
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&thread->mutex);
+    LE_FATAL_IF(thread->queueCount >= QUEUE_SIZE, "Event queue of thread '%s' is full",
+                thread->name);
+    Deferred_t *deferredPtr = &thread->queue[(thread->queueHead + thread->queueCount) % QUEUE_SIZE];
+    deferredPtr->func = func;
+    deferredPtr->param1Ptr = param1Ptr;
+    deferredPtr->param2Ptr = param2Ptr;
+    thread->queueCount++;
+    pthread_mutex_unlock(&thread->mutex);
+
+    LE_ASSERT(write(thread->wakeFd, &one, sizeof(one)) == sizeof(one));
+}
+
+void le_event_QueueFunction
+(
+    le_event_DeferredFunc_t func,
+    void *param1Ptr,
+    void *param2Ptr
+)
+{
+    le_event_QueueFunctionToThread(le_thread_GetCurrent(), func, param1Ptr, param2Ptr);
+}
+
+le_fdMonitor_Ref_t le_fdMonitor_Create
+(
+    const char *namePtr,
+    int fd,
+    le_fdMonitor_HandlerFunc_t handlerFunc,
+    short events
+)
+{
+    le_thread_Ref_t thread = le_thread_GetCurrent();
+    le_fdMonitor_Ref_t monitor = calloc(1, sizeof(*monitor));
+
+    LE_ASSERT(monitor != NULL);
+    LE_FATAL_IF(thread->numMonitors >= MAX_MONITORS, "Too many fd monitors");
+    le_utf8_Copy(monitor->name, namePtr, sizeof(monitor->name), NULL);
+    monitor->fd = fd;
+    monitor->handlerFunc = handlerFunc;
+    monitor->events = events;
+    thread->monitors[thread->numMonitors++] = monitor;
+
+    pthread_mutex_lock(&AllMonitorsMutex);
+    LE_FATAL_IF(NumAllMonitors >= MAX_ALL_MONITORS, "Too many fd monitors");
+    AllMonitors[NumAllMonitors++] = monitor;
+    pthread_mutex_unlock(&AllMonitorsMutex);
+
+    return monitor;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turns the calling thread's event loop once.
+ *
+ * @return The number of handlers and functions called.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t host_ServiceLoop
+(
+    int timeoutMs
+)
+{
+    le_thread_Ref_t thread = le_thread_GetCurrent();
+    struct pollfd fds[MAX_MONITORS + 1];
+    size_t numMonitors = thread->numMonitors;
+    size_t count = 0;
+
+    for (size_t i = 0; i < numMonitors; i++)
+    {
+        fds[i].fd = thread->monitors[i]->fd;
+        fds[i].events = thread->monitors[i]->events;
+        fds[i].revents = 0;
+    }
+    fds[numMonitors].fd = thread->wakeFd;
+    fds[numMonitors].events = POLLIN;
+    fds[numMonitors].revents = 0;
+
+    int readyCount = poll(fds, numMonitors + 1, timeoutMs);
+    if (readyCount <= 0)
+    {
+        LE_FATAL_IF((readyCount < 0) && (errno != EINTR), "poll() failed (%m)");
+        return 0;
+    }
+
+    // Nothing has been read yet, so until the thread is marked busy, host_IsIdle() still sees
+    // what woke it.
+    __atomic_add_fetch(&BusyCount, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&TurnCount, 1, __ATOMIC_SEQ_CST);
+
+    for (size_t i = 0; i < numMonitors; i++)
+    {
+        if (fds[i].revents != 0)
+        {
+            le_fdMonitor_Ref_t monitor = thread->monitors[i];
+            __atomic_add_fetch(&monitor->wakeCount, 1, __ATOMIC_RELAXED);
+            monitor->handlerFunc(monitor->fd, fds[i].revents);
+            count++;
+        }
+    }
+
+    // Only the functions queued before this turn are called, so functions that queue themselves
+    // again don't stop the loop from turning.
+    uint64_t wakeCount;
+    if (read(thread->wakeFd, &wakeCount, sizeof(wakeCount)) < 0)
+    {
+        LE_FATAL_IF(errno != EAGAIN, "read() failed (%m)");
+    }
+    pthread_mutex_lock(&thread->mutex);
+    size_t queued = thread->queueCount;
+    pthread_mutex_unlock(&thread->mutex);
+
+    for (size_t i = 0; i < queued; i++)
+    {
+        pthread_mutex_lock(&thread->mutex);
+        Deferred_t deferred = thread->queue[thread->queueHead];
+        thread->queueHead = (thread->queueHead + 1) % QUEUE_SIZE;
+        thread->queueCount--;
+        bool more = (thread->queueCount > 0);
+        pthread_mutex_unlock(&thread->mutex);
+
+        deferred.func(deferred.param1Ptr, deferred.param2Ptr);
+        count++;
+
+        // Anything left (or queued since) is for the next turn, which mustn't wait for it.
+        if (more && (i + 1 == queued))
+        {
+            uint64_t one = 1;
+            LE_ASSERT(write(thread->wakeFd, &one, sizeof(one)) == sizeof(one));
+        }
+    }
+
+    __atomic_sub_fetch(&BusyCount, 1, __ATOMIC_SEQ_CST);
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Checks whether all the threads are idle: none is part way through a turn of its event loop, and
+ * none has anything to do (no fd it monitors is ready, and nothing is queued to it).
+ */
+//--------------------------------------------------------------------------------------------------
+bool host_IsIdle
+(
+    void
+)
+{
+    static struct pollfd fds[MAX_ALL_MONITORS + MAX_THREADS];
+    uint64_t turnCount = __atomic_load_n(&TurnCount, __ATOMIC_SEQ_CST);
+    size_t numFds = 0;
+
+    if (__atomic_load_n(&BusyCount, __ATOMIC_SEQ_CST) != 0)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&AllMonitorsMutex);
+    for (size_t i = 0; i < NumAllMonitors; i++)
+    {
+        fds[numFds].fd = AllMonitors[i]->fd;
+        fds[numFds].events = AllMonitors[i]->events;
+        fds[numFds].revents = 0;
+        numFds++;
+    }
+    for (size_t i = 0; i < NumAllThreads; i++)
+    {
+        fds[numFds].fd = AllThreads[i]->wakeFd;
+        fds[numFds].events = POLLIN;
+        fds[numFds].revents = 0;
+        numFds++;
+    }
+    pthread_mutex_unlock(&AllMonitorsMutex);
+
+    if (poll(fds, numFds, 0) != 0)
+    {
+        return false;
+    }
+
+    // A thread that took a turn meanwhile may have sent something to an fd already looked at.
+    return (__atomic_load_n(&BusyCount, __ATOMIC_SEQ_CST) == 0) &&
+           (__atomic_load_n(&TurnCount, __ATOMIC_SEQ_CST) == turnCount);
+}
+
+void le_event_RunLoop
+(
+    void
+)
+{
+    for (;;)
+    {
+        host_ServiceLoop(-1);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Gets the number of times the handler of the fd monitors (and timers) with a given name has
+ * been called, on any thread.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t host_GetWakeCount
+(
+    const char *namePtr
+)
+{
+    uint64_t count = 0;
+
+    pthread_mutex_lock(&AllMonitorsMutex);
+    for (size_t i = 0; i < NumAllMonitors; i++)
+    {
+        if (strcmp(AllMonitors[i]->name, namePtr) == 0)
+        {
+            count += __atomic_load_n(&AllMonitors[i]->wakeCount, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&AllMonitorsMutex);
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Timers.
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Arms (or disarms) a timer's timerfd.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetTimerFd
+(
+    le_timer_Ref_t timerRef,
+    uint32_t ms,
+    bool repeat
+)
+{
+    struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (long)(ms % 1000) * 1000000;
+    if ((ms != 0) && (spec.it_value.tv_sec == 0) && (spec.it_value.tv_nsec == 0))
+    {
+        spec.it_value.tv_nsec = 1;
+    }
+    if (repeat)
+    {
+        spec.it_interval = spec.it_value;
+    }
+
+    LE_FATAL_IF(timerfd_settime(timerRef->fd, 0, &spec, NULL) != 0,
+                "Failed to set timer '%s' (%m)", timerRef->name);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for a timer's timerfd.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimerFdHandler
+(
+    int fd,
+    short events
+)
+{
+    le_thread_Ref_t thread = le_thread_GetCurrent();
+    le_timer_Ref_t timerRef = NULL;
+    uint64_t expiryCount;
+
+    if (read(fd, &expiryCount, sizeof(expiryCount)) != sizeof(expiryCount))
+    {
+        return;
+    }
+
+    for (size_t i = 0; (i < thread->numMonitors) && (timerRef == NULL); i++)
+    {
+        if (thread->monitors[i]->fd == fd)
+        {
+            timerRef = thread->monitors[i]->timerRef;
+        }
+    }
+    LE_ASSERT(timerRef != NULL);
+
+    if (!timerRef->running)
+    {
+        return;
+    }
+    if (timerRef->repeatCount != 0)
+    {
+        timerRef->remaining--;
+        if (timerRef->remaining == 0)
+        {
+            SetTimerFd(timerRef, 0, false);
+            timerRef->running = false;
+        }
+    }
+
+    if (timerRef->handlerFunc != NULL)
+    {
+        timerRef->handlerFunc(timerRef);
+    }
+}
+
+le_timer_Ref_t le_timer_Create
+(
+    const char *nameStr
+)
+{
+    le_timer_Ref_t timerRef = calloc(1, sizeof(*timerRef));
+
+    LE_ASSERT(timerRef != NULL);
+    le_utf8_Copy(timerRef->name, nameStr, sizeof(timerRef->name), NULL);
+    timerRef->repeatCount = 1;
+    timerRef->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    LE_FATAL_IF(timerRef->fd == -1, "Failed to create timer '%s' (%m)", nameStr);
+
+    le_fdMonitor_Create(nameStr, timerRef->fd, TimerFdHandler, POLLIN)->timerRef = timerRef;
+
+    return timerRef;
+}
+
+le_result_t le_timer_SetHandler
+(
+    le_timer_Ref_t timerRef,
+    le_timer_ExpiryHandler_t handlerFunc
+)
+{
+    timerRef->handlerFunc = handlerFunc;
+    return LE_OK;
+}
+
+le_result_t le_timer_SetMsInterval
+(
+    le_timer_Ref_t timerRef,
+    uint32_t interval
+)
+{
+    timerRef->intervalMs = interval;
+    return LE_OK;
+}
+
+le_result_t le_timer_SetRepeat
+(
+    le_timer_Ref_t timerRef,
+    uint32_t repeatCount
+)
+{
+    timerRef->repeatCount = repeatCount;
+    return LE_OK;
+}
+
+le_result_t le_timer_Start
+(
+    le_timer_Ref_t timerRef
+)
+{
+    if (timerRef->running)
+    {
+        return LE_BUSY;
+    }
+
+    timerRef->running = true;
+    timerRef->remaining = timerRef->repeatCount;
+    SetTimerFd(timerRef, timerRef->intervalMs, (timerRef->repeatCount != 1));
+
+    return LE_OK;
+}
+
+le_result_t le_timer_Stop
+(
+    le_timer_Ref_t timerRef
+)
+{
+    if (!timerRef->running)
+    {
+        return LE_FAULT;
+    }
+
+    timerRef->running = false;
+    SetTimerFd(timerRef, 0, false);
+
+    return LE_OK;
+}
+
+bool le_timer_IsRunning
+(
+    le_timer_Ref_t timerRef
+)
+{
+    return timerRef->running;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Signals.
+//--------------------------------------------------------------------------------------------------
+
+void le_sig_Block
+(
+    int sigNum
+)
+{
+}
+
+void le_sig_SetEventHandler
+(
+    int sigNum,
+    le_sig_EventHandlerFunc_t sigEventHandler
+)
+{
+}
@@ -0,0 +1,235 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file legato.h
+ *
+ * Host stand-in for the parts of the Legato framework that the buzzer component uses, so the
+ * component can be built and run on a plain Linux box (see ../README.md).  Only what the component
+ * needs is declared, with the same names and signatures as the real framework.
+ *
+ * The event loop, timers and fd monitors are implemented on top of poll() and timerfds (see
+ * legato.c), with one event loop per thread, like the real framework.  If the component is built
+ * with BUZZER_VIRTUAL_CLOCK defined, timerfds run on the simulated clock (see sys/timerfd.h and
+ * ../sim.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LEGATO_H_INCLUDE_GUARD
+#define LEGATO_H_INCLUDE_GUARD
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+//--------------------------------------------------------------------------------------------------
+// Basics.
+//--------------------------------------------------------------------------------------------------
+
+typedef enum
+{
+    LE_OK = 0,
+    LE_NOT_FOUND = -1,
+    LE_NOT_POSSIBLE = -2,
+    LE_OUT_OF_RANGE = -3,
+    LE_NO_MEMORY = -4,
+    LE_NOT_PERMITTED = -5,
+    LE_FAULT = -6,
+    LE_COMM_ERROR = -7,
+    LE_TIMEOUT = -8,
+    LE_OVERFLOW = -9,
+    LE_UNDERFLOW = -10,
+    LE_WOULD_BLOCK = -11,
+    LE_DEADLOCK = -12,
+    LE_FORMAT_ERROR = -13,
+    LE_DUPLICATE = -14,
+    LE_BAD_PARAMETER = -15,
+    LE_CLOSED = -16,
+    LE_BUSY = -17,
+    LE_UNSUPPORTED = -18,
+    LE_IO_ERROR = -19,
+    LE_NOT_IMPLEMENTED = -20,
+    LE_UNAVAILABLE = -21,
+    LE_TERMINATED = -22,
+}
+le_result_t;
+
+const char *LE_RESULT_TXT(le_result_t result);
+
+#define NUM_ARRAY_MEMBERS(array) (sizeof(array) / sizeof((array)[0]))
+#define CONTAINER_OF(ptr, type, member) ((type *)(((char *)(ptr)) - offsetof(type, member)))
+
+/// The component's initialisation function, called by the host program (see ../host.h).
+#define COMPONENT_INIT void host_ComponentInit(void)
+
+//--------------------------------------------------------------------------------------------------
+// Logging.  Messages go to stderr, prefixed with their level.  DEBUG messages are only shown if
+// the LE_LOG_LEVEL environment variable is DEBUG, and INFO messages unless it is WARN or above.
+//--------------------------------------------------------------------------------------------------
+
+typedef enum
+{
+    LE_LOG_DEBUG,
+    LE_LOG_INFO,
+    LE_LOG_WARN,
+    LE_LOG_ERR,
+    LE_LOG_EMERG,
+}
+le_log_Level_t;
+
+void host_Log(le_log_Level_t level, const char *fileNamePtr, int line, const char *formatPtr, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define LE_DEBUG(...) host_Log(LE_LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+#define LE_INFO(...) host_Log(LE_LOG_INFO, __FILE__, __LINE__, __VA_ARGS__)
+#define LE_WARN(...) host_Log(LE_LOG_WARN, __FILE__, __LINE__, __VA_ARGS__)
+#define LE_ERROR(...) host_Log(LE_LOG_ERR, __FILE__, __LINE__, __VA_ARGS__)
+#define LE_FATAL(...) \
+    do { host_Log(LE_LOG_EMERG, __FILE__, __LINE__, __VA_ARGS__); abort(); } while (0)
+#define LE_FATAL_IF(condition, ...) \
+    do { if (condition) { LE_FATAL(__VA_ARGS__); } } while (0)
+#define LE_ASSERT(condition) \
+    do { if (!(condition)) { LE_FATAL("Assert Failed: '%s'", #condition); } } while (0)
+
+//--------------------------------------------------------------------------------------------------
+// Memory pools.  Objects are reference counted, as in the real framework, but come from malloc().
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_mem_Pool *le_mem_PoolRef_t;
+
+le_mem_PoolRef_t le_mem_CreatePool(const char *namePtr, size_t objSize);
+le_mem_PoolRef_t le_mem_ExpandPool(le_mem_PoolRef_t pool, size_t numObjects);
+void *le_mem_ForceAlloc(le_mem_PoolRef_t pool);
+void le_mem_AddRef(void *objPtr);
+void le_mem_Release(void *objPtr);
+
+//--------------------------------------------------------------------------------------------------
+// Hash maps.
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_hashmap *le_hashmap_Ref_t;
+typedef size_t (*le_hashmap_HashFunc_t)(const void *keyPtr);
+typedef bool (*le_hashmap_EqualsFunc_t)(const void *firstKeyPtr, const void *secondKeyPtr);
+
+le_hashmap_Ref_t le_hashmap_Create(const char *namePtr, size_t capacity,
+                                   le_hashmap_HashFunc_t hashFunc,
+                                   le_hashmap_EqualsFunc_t equalsFunc);
+void *le_hashmap_Put(le_hashmap_Ref_t map, const void *keyPtr, const void *valuePtr);
+void *le_hashmap_Get(le_hashmap_Ref_t map, const void *keyPtr);
+void *le_hashmap_Remove(le_hashmap_Ref_t map, const void *keyPtr);
+size_t le_hashmap_Size(le_hashmap_Ref_t map);
+
+//--------------------------------------------------------------------------------------------------
+// Doubly linked lists.
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_dls_Link
+{
+    struct le_dls_Link *nextPtr;
+    struct le_dls_Link *prevPtr;
+}
+le_dls_Link_t;
+
+typedef struct
+{
+    le_dls_Link_t *headLinkPtr;
+}
+le_dls_List_t;
+
+#define LE_DLS_LIST_INIT (le_dls_List_t){ .headLinkPtr = NULL }
+#define LE_DLS_LINK_INIT (le_dls_Link_t){ .nextPtr = NULL, .prevPtr = NULL }
+
+void le_dls_Stack(le_dls_List_t *listPtr, le_dls_Link_t *newLinkPtr);
+void le_dls_Remove(le_dls_List_t *listPtr, le_dls_Link_t *linkToRemovePtr);
+le_dls_Link_t *le_dls_PeekTail(const le_dls_List_t *listPtr);
+
+//--------------------------------------------------------------------------------------------------
+// UTF-8 strings.
+//--------------------------------------------------------------------------------------------------
+
+le_result_t le_utf8_Copy(char *destStr, const char *srcStr, size_t destSize,
+                         size_t *numBytesPtr);
+
+//--------------------------------------------------------------------------------------------------
+// Threads.
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_thread *le_thread_Ref_t;
+typedef void *(*le_thread_MainFunc_t)(void *contextPtr);
+
+typedef enum
+{
+    LE_THREAD_PRIORITY_IDLE,
+    LE_THREAD_PRIORITY_LOW,
+    LE_THREAD_PRIORITY_MEDIUM,
+    LE_THREAD_PRIORITY_HIGH,
+    LE_THREAD_PRIORITY_RT_1,
+    LE_THREAD_PRIORITY_RT_32 = LE_THREAD_PRIORITY_RT_1 + 31,
+}
+le_thread_Priority_t;
+
+le_thread_Ref_t le_thread_Create(const char *namePtr, le_thread_MainFunc_t mainFunc,
+                                 void *contextPtr);
+le_result_t le_thread_SetPriority(le_thread_Ref_t thread, le_thread_Priority_t priority);
+le_result_t le_thread_SetJoinable(le_thread_Ref_t thread);
+void le_thread_Start(le_thread_Ref_t thread);
+le_result_t le_thread_Join(le_thread_Ref_t thread, void **resultValuePtr);
+void le_thread_Exit(void *resultPtr) __attribute__((noreturn));
+le_thread_Ref_t le_thread_GetCurrent(void);
+
+//--------------------------------------------------------------------------------------------------
+// Event loop.
+//--------------------------------------------------------------------------------------------------
+
+typedef void (*le_event_DeferredFunc_t)(void *param1Ptr, void *param2Ptr);
+
+void le_event_QueueFunction(le_event_DeferredFunc_t func, void *param1Ptr, void *param2Ptr);
+void le_event_QueueFunctionToThread(le_thread_Ref_t thread, le_event_DeferredFunc_t func,
+                                    void *param1Ptr, void *param2Ptr);
+void le_event_RunLoop(void) __attribute__((noreturn));
+
+typedef struct le_fdMonitor *le_fdMonitor_Ref_t;
+typedef void (*le_fdMonitor_HandlerFunc_t)(int fd, short events);
+
+le_fdMonitor_Ref_t le_fdMonitor_Create(const char *namePtr, int fd,
+                                       le_fdMonitor_HandlerFunc_t handlerFunc, short events);
+
+//--------------------------------------------------------------------------------------------------
+// Timers.
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_timer *le_timer_Ref_t;
+typedef void (*le_timer_ExpiryHandler_t)(le_timer_Ref_t timerRef);
+
+le_timer_Ref_t le_timer_Create(const char *nameStr);
+le_result_t le_timer_SetHandler(le_timer_Ref_t timerRef, le_timer_ExpiryHandler_t handlerFunc);
+le_result_t le_timer_SetMsInterval(le_timer_Ref_t timerRef, uint32_t interval);
+le_result_t le_timer_SetRepeat(le_timer_Ref_t timerRef, uint32_t repeatCount);
+le_result_t le_timer_Start(le_timer_Ref_t timerRef);
+le_result_t le_timer_Stop(le_timer_Ref_t timerRef);
+bool le_timer_IsRunning(le_timer_Ref_t timerRef);
+
+//--------------------------------------------------------------------------------------------------
+// Signals.  Signals are only recorded: the host program decides whether to deliver them.
+//--------------------------------------------------------------------------------------------------
+
+typedef void (*le_sig_EventHandlerFunc_t)(int sigNum);
+
+void le_sig_Block(int sigNum);
+void le_sig_SetEventHandler(int sigNum, le_sig_EventHandlerFunc_t sigEventHandler);
+
+#endif // LEGATO_H_INCLUDE_GUARD
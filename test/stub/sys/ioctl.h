@@ -0,0 +1,22 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sys/ioctl.h
+ *
+ * Wraps the system's ioctl header.  ioctl() calls go through a stand-in (see ../i2cDev.c), which
+ * makes a plain file behave as an i2c-dev device, so the I2C backend can be run without the
+ * hardware.  Other ioctls, and ioctls on anything but a plain file, go straight to the system.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STUB_SYS_IOCTL_H_INCLUDE_GUARD
+#define STUB_SYS_IOCTL_H_INCLUDE_GUARD
+
+#include_next <sys/ioctl.h>
+
+int stub_Ioctl(int fd, unsigned long request, ...);
+
+#define ioctl stub_Ioctl
+
+#endif // STUB_SYS_IOCTL_H_INCLUDE_GUARD
@@ -0,0 +1,29 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sys/timerfd.h
+ *
+ * Wraps the system's timerfd header.  If the component is built with BUZZER_VIRTUAL_CLOCK
+ * defined, timerfds are created on the simulated clock instead (see ../../sim.h), so the engine's
+ * deadlines, and the Legato timers built on timerfds (see ../legato.c), expire in simulated time.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STUB_SYS_TIMERFD_H_INCLUDE_GUARD
+#define STUB_SYS_TIMERFD_H_INCLUDE_GUARD
+
+#include_next <sys/timerfd.h>
+
+#ifdef BUZZER_VIRTUAL_CLOCK
+
+int sim_TimerfdCreate(int clockId, int flags);
+int sim_TimerfdSettime(int fd, int flags, const struct itimerspec *newValuePtr,
+                       struct itimerspec *oldValuePtr);
+
+#define timerfd_create sim_TimerfdCreate
+#define timerfd_settime sim_TimerfdSettime
+
+#endif // BUZZER_VIRTUAL_CLOCK
+
+#endif // STUB_SYS_TIMERFD_H_INCLUDE_GUARD